@@ -95,9 +95,12 @@ function(add_verilator)
     target_include_directories(
         ${VTARGET}
         INTERFACE ${CMAKE_CURRENT_BINARY_DIR}/${VOBJDIR}
-        INTERFACE ${VERILATOR_INCLUDE_DIR})
+        INTERFACE ${VERILATOR_INCLUDE_DIR}
+        INTERFACE ${VERILATOR_INCLUDE_DIR}/vltstd)
+    # verilated_dpi.cpp for the models with DPI imports (svGetArrayPtr etc.)
     target_sources(${VTARGET}
-        INTERFACE ${VERILATOR_INCLUDE_DIR}/verilated.cpp)
+        INTERFACE ${VERILATOR_INCLUDE_DIR}/verilated.cpp
+        INTERFACE ${VERILATOR_INCLUDE_DIR}/verilated_dpi.cpp)
     if(ADDV_TRACE_ON)
         target_sources(${VTARGET}
             INTERFACE  ${VERILATOR_INCLUDE_DIR}/verilated_vcd_c.cpp)
@@ -0,0 +1,205 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Compares the byte lane kernels of byte_lanes.hpp with the per-lane loops which
+ * tlul_testbench used before, for W = 8 .. 64 bytes. Fails if any kernel disagrees with the
+ * loops.
+ * 
+ * usage: exe_benchmarks_byte_lanes [number of iterations]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <array>
+#include <iostream>
+#include <iomanip>
+
+#include <verilator_aux.hpp>
+#include <byte_lanes.hpp>
+
+using namespace verilator_aux;
+
+// packed representation of the data bus, as Verilator generates it
+template <std::size_t W>
+struct bus {
+    using type = std::uint32_t[W / 4];
+};
+
+template <>
+struct bus<8> {
+    using type = std::uint64_t;
+};
+
+struct sample {
+    std::uint64_t mask;
+    std::array<std::uint8_t, 64> bytes;
+};
+
+template <std::size_t W>
+constexpr std::size_t log2_of() {
+    std::size_t n = 0;
+    while ((std::size_t(1) << n) < W)
+        ++n;
+    return n;
+}
+
+// legal TL-UL masks: 2^k contiguous lanes, aligned to 2^k
+template <std::size_t W>
+std::vector<sample> make_samples(std::size_t n) {
+    std::mt19937_64 mt{1234};
+    std::vector<sample> samples(n);
+    for (auto &s: samples) {
+        std::size_t k = mt() % (log2_of<W>() + 1);
+        std::size_t sz = std::size_t(1) << k;
+        std::size_t offset = (mt() % (W / sz)) * sz;
+        s.mask = (sz == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << sz) - 1) << offset;
+        for (auto &b: s.bytes)
+            b = mt();
+    }
+    return samples;
+}
+
+template <typename F>
+double measure(F &&f, std::size_t iterations) {
+    auto t0 = std::chrono::steady_clock::now();
+    f(iterations);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+}
+
+static std::uint64_t sink = 0;
+
+template <std::size_t W>
+bool run(std::size_t iterations) {
+    using data_type = typename bus<W>::type;
+    auto samples = make_samples<W>(1024);
+    bool ok = true;
+    
+    // BEGIN the loops, as in tlul_testbench before byte_lanes
+    
+    auto gather_loop = [&](sample const &s, std::uint8_t *out) {
+        data_type d;
+        byte_lanes::store(d, s.bytes.data());
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < W; ++i) {
+            if (get_bit(s.mask, i)) {
+                out[n++] = get_lane(d, i);
+            }
+        }
+        return n;
+    };
+    
+    auto scatter_loop = [&](sample const &s, data_type &d) {
+        auto it = s.bytes.begin();
+        for (std::size_t i = 0; i < W; ++i) {
+            if (get_bit(s.mask, i)) {
+                set_lane(d, i, *it);
+                ++it;
+            }
+        }
+    };
+    
+    // END
+    
+    auto gather = [&](sample const &s, std::uint8_t *out, byte_lanes::isa isa) {
+        data_type d;
+        std::uint8_t lanes[W];
+        byte_lanes::store(d, s.bytes.data());
+        byte_lanes::load(d, lanes);
+        return byte_lanes::compact<W>(lanes, s.mask, out, isa);
+    };
+    
+    auto scatter = [&](sample const &s, data_type &d, byte_lanes::isa isa) {
+        std::uint8_t lanes[W];
+        byte_lanes::expand<W>(s.bytes.data(), s.mask, lanes, isa);
+        byte_lanes::store(d, lanes);
+    };
+    
+    std::cout << "W = " << std::setw(2) << W << " bytes\n";
+    
+    auto report = [](char const *name, double gather_ns, double scatter_ns) {
+        std::cout << "    " << std::left << std::setw(10) << name << std::right
+            << " gather: " << std::setw(8) << std::fixed << std::setprecision(2) << gather_ns
+            << " ns/op   scatter: " << std::setw(8) << scatter_ns << " ns/op\n";
+    };
+    
+    report("loop",
+        measure([&](std::size_t n) {
+            std::uint8_t out[W];
+            for (std::size_t i = 0; i < n; ++i)
+                sink += gather_loop(samples[i & 1023], out) + out[0];
+        }, iterations),
+        measure([&](std::size_t n) {
+            data_type d {};
+            for (std::size_t i = 0; i < n; ++i) {
+                scatter_loop(samples[i & 1023], d);
+                sink += word(d, 0);
+            }
+        }, iterations));
+    
+    std::pair<char const *, byte_lanes::isa> const kernels[] = {
+        {"portable", byte_lanes::isa::portable},
+        {"ssse3", byte_lanes::isa::ssse3},
+        {"bmi2", byte_lanes::isa::bmi2}
+    };
+    
+    for (auto const &k: kernels) {
+        if (!byte_lanes::supported(k.second))
+            continue;
+        
+        // compare with the loops first
+        for (auto const &s: samples) {
+            std::uint8_t expected[W], acquired[W];
+            auto n = gather_loop(s, expected);
+            if (gather(s, acquired, k.second) != n ||
+                !std::equal(expected, expected + n, acquired)) {
+                std::cerr << k.first << ": gather mismatch\n";
+                ok = false;
+            }
+            
+            data_type d1 {}, d2 {};
+            scatter_loop(s, d1);
+            scatter(s, d2, k.second);
+            for (std::size_t i = 0; i < W; ++i) {
+                if (get_bit(s.mask, i) && get_lane(d1, i) != get_lane(d2, i)) {
+                    std::cerr << k.first << ": scatter mismatch\n";
+                    ok = false;
+                }
+            }
+        }
+        
+        report(k.first,
+            measure([&](std::size_t n) {
+                std::uint8_t out[W];
+                for (std::size_t i = 0; i < n; ++i)
+                    sink += gather(samples[i & 1023], out, k.second) + out[0];
+            }, iterations),
+            measure([&](std::size_t n) {
+                data_type d {};
+                for (std::size_t i = 0; i < n; ++i) {
+                    scatter(samples[i & 1023], d, k.second);
+                    sink += word(d, 0);
+                }
+            }, iterations));
+    }
+    
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    
+    bool ok = true;
+    ok &= run<8>(iterations);
+    ok &= run<16>(iterations);
+    ok &= run<32>(iterations);
+    ok &= run<64>(iterations);
+    
+    std::cout << "selected kernel: " << int(byte_lanes::detect()) << " (checksum " << sink << ")"
+        << std::endl;
+    
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
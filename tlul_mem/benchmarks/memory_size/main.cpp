@@ -0,0 +1,110 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Simulation speed of tlul_slave_memory against RAM_SIZE, 256 B to 16 MiB: the same
+ * constrained-random traffic (tlul_traffic.hpp) over the whole of each memory, every response
+ * checked against a shadow memory. At the end, the whole RAM is compared with the shadow
+ * through the backdoor, and dumped to an image file and loaded back from it, timed. Fails on
+ * any mismatch.
+ * 
+ * usage: exe_benchmarks_memory_size [number of operations] [seed]
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <hdl_benchmarks_memory_size_256.h>
+#include <hdl_benchmarks_memory_size_4096.h>
+#include <hdl_benchmarks_memory_size_65536.h>
+#include <hdl_benchmarks_memory_size_1048576.h>
+#include <hdl_benchmarks_memory_size_16777216.h>
+
+#include "tlul_testbench.hpp"
+#include "tlul_traffic.hpp"
+#include "memory_backdoor.hpp"
+
+double main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+template <typename HDL>
+bool measure(std::uint64_t n_ops, std::uint64_t seed) {
+    using testbench = tlul_testbench<HDL>;
+    
+    auto top = std::make_unique<HDL>();
+    verilator_aux::memory_backdoor backdoor{top.get()};
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<HDL> driver{top.get()};
+    tb.attach(driver);
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<std::uint8_t> initial(backdoor.size());
+    std::iota(initial.begin(), initial.end(), 0);
+    
+    verilator_aux::tlul_traffic<testbench> traffic{&tb, initial, seed};
+    traffic.start(n_ops);
+    
+    auto t0 = std::chrono::steady_clock::now();
+    bool finished = driver.run_until(
+        [&] { return traffic.done() || traffic.mismatches() != 0 || Verilated::gotFinish(); },
+        100 * n_ops);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+        .count();
+    
+    std::vector<std::uint8_t> contents(backdoor.size());
+    backdoor.read(0, contents);
+    bool same = contents == traffic.memory();
+    
+    // the RAM through an image file, back to where it was
+    auto path = "memory_size_" + std::to_string(backdoor.size()) + ".bin";
+    auto t1 = std::chrono::steady_clock::now();
+    backdoor.dump_image(path);
+    auto t2 = std::chrono::steady_clock::now();
+    backdoor.load_image(path);
+    auto t3 = std::chrono::steady_clock::now();
+    std::remove(path.c_str());
+    
+    backdoor.read(0, contents);
+    same = same && contents == traffic.memory();
+    
+    std::cout << "RAM_SIZE " << backdoor.size() << ":\n";
+    std::cout << "    cycles:              " << driver.cycle() << "\n";
+    std::cout << "    [cycles/s]:          " << driver.cycle() / seconds << "\n";
+    std::cout << "    [operations/s]:      " << traffic.operations() / seconds << "\n";
+    std::cout << "    mismatches:          " << traffic.mismatches() << "\n";
+    std::cout << "    image dump [ms]:     "
+        << 1e3 * std::chrono::duration<double>(t2 - t1).count() << "\n";
+    std::cout << "    image load [ms]:     "
+        << 1e3 * std::chrono::duration<double>(t3 - t2).count() << "\n";
+    std::cout << "    backdoor agrees:     " << (same ? "yes" : "no") << std::endl;
+    
+    top->final();
+    
+    return finished && traffic.done() && traffic.mismatches() == 0 && same;
+}
+
+int main(int argc, char **argv) {
+    std::uint64_t n_ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    std::cout << "operations:              " << n_ops << "\n";
+    std::cout << "seed:                    " << seed << "\n";
+    bool ok = measure<hdl_benchmarks_memory_size_256>(n_ops, seed);
+    ok = measure<hdl_benchmarks_memory_size_4096>(n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_memory_size_65536>(n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_memory_size_1048576>(n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_memory_size_16777216>(n_ops, seed) && ok;
+    
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
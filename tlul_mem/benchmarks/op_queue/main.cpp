@@ -0,0 +1,132 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Measures the host cost of the tlul_testbench operation queue and counts the heap
+ * allocations done while enqueuing and dispatching operations in the steady state.
+ * 
+ * usage: exe_benchmarks_op_queue [number of operations]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <chrono>
+#include <iostream>
+
+#include <hdl_benchmarks_op_queue.h>
+
+#include "tlul_testbench.hpp"
+
+// BEGIN allocation counting
+
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t n) {
+    ++allocations;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// END
+
+double main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+using testbench = tlul_testbench<hdl_benchmarks_op_queue>;
+
+int main(int argc, char **argv) {
+    std::size_t n_ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto top = std::make_unique<hdl_benchmarks_op_queue>();
+    testbench tb{top.get()};
+    
+    std::size_t issued = 0;
+    std::size_t completed = 0;
+    std::uint64_t checksum = 0;
+    
+    // every completed operation enqueues a new one, like a long regression does
+    struct {
+        testbench *tb;
+        std::size_t *issued;
+        std::size_t *completed;
+        std::uint64_t *checksum;
+        std::size_t limit;
+        
+        void operator()() const {
+            if (*issued == limit)
+                return;
+            
+            testbench::address_type address = (*issued * 8) % 256;
+            
+            if (*issued % 2 == 0) {
+                std::uint8_t data[8] = {
+                    std::uint8_t(*issued), 1, 2, 3, 4, 5, 6, std::uint8_t(*issued >> 8) };
+                auto self = *this;
+                tb->put_full_data([self] { ++*self.completed; self(); }, address, 3, 0xff, data);
+            }
+            else {
+                auto self = *this;
+                tb->get([self](testbench::bytes v) {
+                        *self.checksum += v[0];
+                        ++*self.completed;
+                        self();
+                    }, address, 3, 0xff);
+            }
+            ++*issued;
+        }
+    } next{&tb, &issued, &completed, &checksum, n_ops};
+    
+    // keep the bus busy
+    for (std::size_t i = 0; i < testbench::max_outstanding && i < n_ops; ++i)
+        next();
+    
+    auto run = [&](std::size_t until) {
+        while (completed < until && !Verilated::gotFinish()) {
+            ++main_time;
+            top->CLK = !top->CLK;
+            tb.eval();
+        }
+    };
+    
+    // warm up, the queue reaches its final size here
+    std::size_t warm_up = n_ops / 10;
+    run(warm_up);
+    
+    auto allocations_before = allocations;
+    auto t0 = std::chrono::steady_clock::now();
+    
+    run(n_ops);
+    
+    auto t1 = std::chrono::steady_clock::now();
+    auto steady_allocations = allocations - allocations_before;
+    
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+    std::size_t measured = completed - warm_up;
+    
+    std::cout << "operations:          " << measured << "\n";
+    std::cout << "cycles:              " << main_time / 2 << "\n";
+    std::cout << "host time [s]:       " << seconds << "\n";
+    std::cout << "operations/s:        " << measured / seconds << "\n";
+    std::cout << "bytes/cycle:         " << tb.stats().bytes_per_cycle() << "\n";
+    std::cout << "heap allocations:    " << steady_allocations << "\n";
+    std::cout << "checksum:            " << checksum << std::endl;
+    
+    top->final();
+    
+    return steady_allocations == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,130 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Beats per cycle of tlul_slave_memory_pipelined against tlul_slave_memory, driven by
+ * tlul_testbench with constrained-random traffic (tlul_traffic.hpp, 32 operations pending), every
+ * response checked against a shadow memory. Channel D is ready on every cycle, then on a random
+ * half of the cycles, then on one cycle in four.
+ * 
+ * Fails on any mismatch, or unless the pipelined memory sustains nearly one beat per cycle
+ * with d_ready high.
+ * 
+ * usage: exe_benchmarks_pipelined [number of operations] [seed]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include <hdl_benchmarks_pipelined.h>
+#include <hdl_benchmarks_pipelined_baseline.h>
+
+#include "tlul_testbench.hpp"
+#include "tlul_traffic.hpp"
+
+double main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+// RAM_SIZE of both memories
+constexpr std::size_t memory_size = 256;
+
+enum class back_pressure { none, half, three_quarters };
+
+struct result {
+    bool ok;
+    double beats_per_cycle;
+    double cycles_per_second;
+};
+
+template <typename HDL>
+result run(back_pressure bp, std::uint64_t n_ops, std::uint64_t seed) {
+    using testbench = tlul_testbench<HDL>;
+    
+    auto top = std::make_unique<HDL>();
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<HDL> driver{top.get()};
+    tb.attach(driver);
+    
+    std::mt19937_64 rng{seed + 1};
+    std::uint64_t cycle = 0;
+    switch (bp) {
+    case back_pressure::none:
+        break;
+    case back_pressure::half:
+        tb.set_d_ready([&rng] { return (rng() & 1) != 0; });
+        break;
+    case back_pressure::three_quarters:
+        tb.set_d_ready([&cycle] { return ++cycle % 4 == 0; });
+        break;
+    }
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<std::uint8_t> initial(memory_size);
+    std::iota(initial.begin(), initial.end(), 0);
+    
+    verilator_aux::tlul_traffic<testbench> traffic{&tb, initial, seed};
+    traffic.start(n_ops);
+    
+    auto t0 = std::chrono::steady_clock::now();
+    bool finished = driver.run_until(
+        [&] { return traffic.done() || traffic.mismatches() != 0 || Verilated::gotFinish(); },
+        100 * n_ops);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+        .count();
+    
+    top->final();
+    
+    return result{
+        finished && traffic.done() && traffic.mismatches() == 0,
+        double(traffic.operations()) / driver.cycle(),
+        driver.cycle() / seconds };
+}
+
+void print(char const *name, result const &r) {
+    std::cout << "    " << name << r.beats_per_cycle << " beats/cycle, " << r.cycles_per_second
+        << " cycles/s" << (r.ok ? "" : " (FAILED)") << "\n";
+}
+
+int main(int argc, char **argv) {
+    std::uint64_t n_ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    std::cout << "operations:              " << n_ops << "\n";
+    std::cout << "seed:                    " << seed << "\n";
+    
+    bool ok = true;
+    struct {
+        char const *name;
+        back_pressure bp;
+    } const cases[] = {
+        {"d_ready always:", back_pressure::none},
+        {"d_ready 1/2 (random):", back_pressure::half},
+        {"d_ready 1/4:", back_pressure::three_quarters}
+    };
+    
+    for (auto const &c: cases) {
+        std::cout << c.name << "\n";
+        auto baseline = run<hdl_benchmarks_pipelined_baseline>(c.bp, n_ops, seed);
+        print("tlul_slave_memory:           ", baseline);
+        ok = ok && baseline.ok;
+        
+        auto pipelined = run<hdl_benchmarks_pipelined>(c.bp, n_ops, seed);
+        print("tlul_slave_memory_pipelined: ", pipelined);
+        std::cout << std::flush;
+        
+        ok = ok && pipelined.ok;
+        if (c.bp == back_pressure::none && pipelined.beats_per_cycle < 0.95)
+            ok = false;
+    }
+    
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,69 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Soak test and load source for tlul_slave_memory: constrained-random Get, PutFullData
+ * and PutPartialData operations, every response checked against a shadow memory. Reports the
+ * throughput; fails on the first mismatch.
+ * 
+ * usage: exe_benchmarks_traffic [number of operations] [seed]
+ *     the seed is drawn from the clock if not given, it is printed to reproduce a failure
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <chrono>
+#include <iostream>
+
+#include <hdl_benchmarks_traffic.h>
+
+#include "tlul_testbench.hpp"
+#include "tlul_traffic.hpp"
+
+double main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+using testbench = tlul_testbench<hdl_benchmarks_traffic>;
+
+// RAM_SIZE of tlul_slave_memory
+constexpr std::size_t memory_size = 256;
+
+int main(int argc, char **argv) {
+    std::uint64_t n_ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::uint64_t seed = argc > 2 ?
+        std::strtoull(argv[2], nullptr, 10) :
+        std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto top = std::make_unique<hdl_benchmarks_traffic>();
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<hdl_benchmarks_traffic> driver{top.get()};
+    tb.attach(driver);
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<std::uint8_t> initial(memory_size);
+    std::iota(initial.begin(), initial.end(), 0);
+    
+    verilator_aux::tlul_traffic<testbench> traffic{&tb, initial, seed};
+    traffic.start(n_ops);
+    
+    // stops at the first mismatch
+    bool finished = driver.run_until(
+        [&] { return traffic.done() || traffic.mismatches() != 0 || Verilated::gotFinish(); },
+        100 * n_ops);
+    
+    std::cout << "seed:                " << seed << "\n";
+    std::cout << "cycles:              " << driver.cycle() << "\n";
+    traffic.report(std::cout);
+    std::cout << "operations/cycle:    " << double(traffic.operations()) / driver.cycle() << "\n";
+    std::cout << "bytes/cycle:         " << tb.stats().bytes_per_cycle() << std::endl;
+    
+    top->final();
+    
+    return finished && traffic.done() && traffic.mismatches() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,155 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Aggregate throughput of tlul_xbar against the number of masters and memories
+ * (xbar_memories.sv, tlul_slave_memory_pipelined behind the crossbar). Every master runs
+ * constrained-random traffic (tlul_traffic.hpp) on a window of its own, master m in memory
+ * m % S, so as many masters as memories never contend, and more masters take turns. Every
+ * response is checked against a shadow memory.
+ * 
+ * Single beats give operations per cycle, then the same with bursts gives bytes per cycle.
+ * Fails on any mismatch, or unless single beats reach nearly one operation per cycle per
+ * memory in use.
+ * 
+ * usage: exe_benchmarks_xbar [number of operations per master] [seed]
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+#include <hdl_benchmarks_xbar_1x1.h>
+#include <hdl_benchmarks_xbar_2x2.h>
+#include <hdl_benchmarks_xbar_4x4.h>
+#include <hdl_benchmarks_xbar_8x8.h>
+#include <hdl_benchmarks_xbar_4x1.h>
+#include <hdl_benchmarks_xbar_8x2.h>
+
+#include "tlul_testbench.hpp"
+#include "tlul_traffic.hpp"
+#include "xbar_port.hpp"
+
+double main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+// RAM_SIZE of each memory, memory s is at s * memory_size
+constexpr std::size_t memory_size = 1024;
+
+struct result {
+    bool ok;
+    double operations_per_cycle;
+    double bytes_per_cycle;
+    double cycles_per_second;
+};
+
+template <typename HDL>
+result run(std::size_t n_masters, std::size_t n_memories, bool bursts, std::uint64_t n_ops,
+        std::uint64_t seed) {
+    using masters = xbar_masters<HDL>;
+    using traffic_type = verilator_aux::tlul_traffic<typename masters::testbench>;
+    
+    masters soc{n_masters};
+    
+    // the masters in a memory, rounded up to a power of 2
+    std::size_t slots = 1;
+    while (slots * n_memories < n_masters)
+        slots *= 2;
+    std::size_t window = memory_size / slots;
+    
+    typename traffic_type::mix weights;
+    if (bursts) {
+        weights.get_burst = 1;
+        weights.put_burst = 1;
+    }
+    
+    std::vector<std::unique_ptr<traffic_type>> traffic;
+    for (std::size_t m = 0; m < n_masters; ++m) {
+        std::size_t base = m % n_memories * memory_size + m / n_memories * window;
+        
+        // see the initial block of tlul_slave_memory_pipelined
+        std::vector<std::uint8_t> initial(window);
+        for (std::size_t i = 0; i < window; ++i)
+            initial[i] = std::uint8_t((base + i) % memory_size);
+        
+        traffic.push_back(std::make_unique<traffic_type>(
+            &soc[m], initial, seed + m, masters::testbench::max_outstanding, weights,
+            typename traffic_type::address_type(base)));
+    }
+    
+    // all done, or a mismatch
+    auto done = [&] {
+        bool all = true;
+        for (auto const &t: traffic) {
+            if (t->mismatches() != 0)
+                return true;
+            all = all && t->done();
+        }
+        return all;
+    };
+    
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto &t: traffic)
+        t->start(n_ops);
+    bool finished = soc.driver.run_until(done, 100 * n_ops * n_masters);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+        .count();
+    
+    bool ok = finished;
+    std::uint64_t operations = 0;
+    std::uint64_t bytes = 0;
+    for (auto const &t: traffic) {
+        ok = ok && t->done() && t->mismatches() == 0;
+        operations += t->operations();
+        bytes += t->bytes_moved();
+        if (!t->first_mismatch().empty())
+            std::cout << "    first mismatch:      " << t->first_mismatch() << "\n";
+    }
+    
+    soc.top->final();
+    
+    double cycles = double(soc.driver.cycle());
+    return result{ok, operations / cycles, bytes / cycles, cycles / seconds};
+}
+
+template <typename HDL>
+bool measure(std::size_t n_masters, std::size_t n_memories, std::uint64_t n_ops,
+        std::uint64_t seed) {
+    auto beats = run<HDL>(n_masters, n_memories, false, n_ops, seed);
+    auto bursts = run<HDL>(n_masters, n_memories, true, n_ops, seed);
+    
+    std::cout << n_masters << " masters, " << n_memories << " memories:"
+        << (beats.ok && bursts.ok ? "" : " (FAILED)") << "\n";
+    std::cout << "    [operations/cycle]:  " << beats.operations_per_cycle << "\n";
+    std::cout << "    [bytes/cycle]:       " << bursts.bytes_per_cycle << " (with bursts)\n";
+    std::cout << "    [cycles/s]:          " << beats.cycles_per_second << std::endl;
+    
+    // a memory takes an operation per cycle
+    auto in_use = std::min(n_masters, n_memories);
+    return beats.ok && bursts.ok && beats.operations_per_cycle >= 0.95 * in_use;
+}
+
+int main(int argc, char **argv) {
+    std::uint64_t n_ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    std::cout << "operations per master: " << n_ops << "\n";
+    std::cout << "seed:                  " << seed << "\n";
+    
+    bool ok = measure<hdl_benchmarks_xbar_1x1>(1, 1, n_ops, seed);
+    ok = measure<hdl_benchmarks_xbar_2x2>(2, 2, n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_xbar_4x4>(4, 4, n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_xbar_8x8>(8, 8, n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_xbar_4x1>(4, 1, n_ops, seed) && ok;
+    ok = measure<hdl_benchmarks_xbar_8x2>(8, 2, n_ops, seed) && ok;
+    
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,383 @@
+/**
+ * @author Canberk Sönmez
+ * @file clock_driver.hpp
+ * @brief Drives the CLK of a Verilator model, both edges of a cycle at once, and calls the hooks
+ * of the components only on the edges they are registered for.
+ * 
+ *     clock_driver<hdl_tlul_uart> driver{top.get()};
+ *     uart_receiver.attach(driver);   // before_posedge, samples tx
+ *     tb.attach(driver);              // before_posedge (sample) and after_posedge (drive)
+ *     driver.run_until([&] { return tb.idle(); });
+ * 
+ * A cycle is: CLK = 1, before_posedge hooks, eval(), after_posedge hooks, then CLK = 0,
+ * before_negedge hooks, eval(), after_negedge hooks. A cycle with no hooks on an edge costs
+ * just the eval() of that edge.
+ * 
+ * Fast-forward (set_fast_forward): components which only count in the coming cycles (e.g. a
+ * UART in the middle of a bit, an idle testbench) report it through on_quiet(). When all of
+ * them are quiet for long enough, the model is clocked without their hooks, and then they
+ * skip() the counted cycles at once. The model is still evaluated on every edge, only the host
+ * side work is removed; the result is the same as stepping cycle by cycle.
+ * 
+ * Timers (add_timer, schedule): a component which knows in which cycles it has work (e.g. the
+ * sample points of a UART byte) schedules itself for those cycles only. Timers are kept on a
+ * timing wheel, a cycle without a due timer costs a compare per edge. A fast-forwarded window
+ * ends before the next due timer.
+ */
+
+#ifndef CLOCK_DRIVER_HPP_INCLUDED
+#define CLOCK_DRIVER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace verilator_aux {
+
+enum class edge_hook {
+    before_posedge,
+    after_posedge,
+    before_negedge,
+    after_negedge
+};
+
+/**
+ * @brief Reported by a component: its hooks change nothing but its own counters in the next
+ * cycles, as long as *signal == level (if signal is given). The signal is checked before each
+ * rising edge.
+ */
+struct quiescence {
+    static constexpr std::uint64_t forever = std::numeric_limits<std::uint64_t>::max();
+    
+    std::uint64_t cycles {0};
+    std::uint8_t const *signal {nullptr};
+    std::uint8_t level {0};
+};
+
+template <typename HDL>
+struct clock_driver {
+    explicit clock_driver(HDL *hdl):
+        hdl{hdl} {
+        hdl->CLK = 0;
+    }
+    
+    /**
+     * @brief Registers a hook, hooks of the same edge are called in the order of registration.
+     * @param skippable the hook belongs to a component registered with on_quiet(), it is not
+     * called in the fast-forwarded cycles. Other hooks are called on every cycle.
+     */
+    template <typename F>
+    void on(edge_hook when, F &&f, bool skippable = false) {
+        hooks[static_cast<std::size_t>(when)].push_back(hook{own<void ()>(std::forward<F>(f)), skippable});
+    }
+    
+    /**
+     * @brief Registers a component for fast-forwarding.
+     * @param quiet returns the quiescence of the component
+     * @param skip called with n, after n cycles are run without the skippable hooks
+     */
+    template <typename Quiet, typename Skip>
+    void on_quiet(Quiet &&quiet, Skip &&skip) {
+        quiets.push_back(own<quiescence ()>(std::forward<Quiet>(quiet)));
+        skips.push_back(own<void (std::uint64_t)>(std::forward<Skip>(skip)));
+    }
+    
+    /**
+     * @brief Registers a timer, which is called on the given edge of the cycles it is scheduled
+     * for, after the hooks of that edge.
+     * @returns the id of the timer, for schedule().
+     */
+    template <typename F>
+    std::size_t add_timer(edge_hook when, F &&f) {
+        timers.push_back(timer{own<void ()>(std::forward<F>(f)), when});
+        wheel.resize(4 * wheel_size);
+        return timers.size() - 1;
+    }
+    
+    /**
+     * @brief Schedules a timer for the cycle at (as returned by cycle() during that cycle). A
+     * timer may be scheduled more than once; at must not be in the past.
+     */
+    void schedule(std::size_t id, std::uint64_t at) {
+        auto when = static_cast<std::size_t>(timers[id].when);
+        wheel[when * wheel_size + (at & wheel_mask)].push_back(timer_event{at, id});
+        ++pending[when];
+    }
+    
+    /**
+     * @brief Enables fast-forwarding of windows of at least min_window cycles, 0 disables it.
+     */
+    void set_fast_forward(std::uint64_t min_window) {
+        fast_forward_window = min_window;
+    }
+    
+    /**
+     * @returns number of cycles run without the skippable hooks.
+     */
+    std::uint64_t skipped_cycles() const {
+        return skipped;
+    }
+    
+    /**
+     * @brief Runs a single clock cycle.
+     */
+    void step() {
+        hdl->CLK = 1;
+        call(edge_hook::before_posedge);
+        fire(edge_hook::before_posedge);
+        hdl->eval();
+        call(edge_hook::after_posedge);
+        fire(edge_hook::after_posedge);
+        
+        hdl->CLK = 0;
+        call(edge_hook::before_negedge);
+        fire(edge_hook::before_negedge);
+        hdl->eval();
+        call(edge_hook::after_negedge);
+        fire(edge_hook::after_negedge);
+        
+        ++cycles;
+    }
+    
+    /**
+     * @brief Runs n clock cycles.
+     */
+    void run_cycles(std::uint64_t n) {
+        for (std::uint64_t done = 0; done < n; )
+            done += advance(n - done);
+    }
+    
+    /**
+     * @brief Runs until the predicate returns true, at most max_cycles cycles. The predicate is
+     * checked before each cycle, or before and after a fast-forwarded window: it must not depend
+     * on what changes in the window, other than through the hooks which are still called.
+     * @returns true if the predicate returned true.
+     */
+    template <typename Predicate>
+    bool run_until(Predicate &&pred,
+            std::uint64_t max_cycles = std::numeric_limits<std::uint64_t>::max()) {
+        for (std::uint64_t done = 0; done < max_cycles; ) {
+            if (pred())
+                return true;
+            done += advance(max_cycles - done);
+        }
+        return pred();
+    }
+    
+    /**
+     * @returns number of cycles run so far.
+     */
+    std::uint64_t cycle() const {
+        return cycles;
+    }
+    
+    HDL *model() const {
+        return hdl;
+    }
+private:
+    // a plain function pointer per callable, which calls it directly
+    template <typename Signature>
+    struct thunk;
+    
+    template <typename R, typename ...Args>
+    struct thunk<R (Args...)> {
+        R operator()(Args ...args) const {
+            return fn(callable, args...);
+        }
+        
+        R (*fn)(void *, Args...);
+        void *callable;
+    };
+    
+    struct hook {
+        thunk<void ()> f;
+        bool skippable;
+    };
+    
+    struct timer {
+        thunk<void ()> f;
+        edge_hook when;
+    };
+    
+    struct timer_event {
+        std::uint64_t at;
+        std::size_t id;
+    };
+    
+    // a bucket holds the events of the cycles which are equal modulo the size of the wheel
+    static constexpr std::size_t wheel_size = 1024;
+    static constexpr std::uint64_t wheel_mask = wheel_size - 1;
+    
+    struct holder_base {
+        virtual ~holder_base() = default;
+    };
+    
+    template <typename F>
+    struct holder: holder_base {
+        template <typename G>
+        explicit holder(G &&g):
+            f{std::forward<G>(g)} {
+        }
+        
+        F f;
+    };
+    
+    template <typename F, typename R, typename ...Args>
+    static R invoke(void *callable, Args ...args) {
+        return (*static_cast<F *>(callable))(args...);
+    }
+    
+    template <typename Signature, typename F>
+    thunk<Signature> own(F &&f) {
+        using D = std::decay_t<F>;
+        auto h = std::make_unique<holder<D>>(std::forward<F>(f));
+        auto t = make_thunk<D>(&h->f, static_cast<Signature *>(nullptr));
+        callables.push_back(std::move(h));
+        return t;
+    }
+    
+    template <typename D, typename R, typename ...Args>
+    static thunk<R (Args...)> make_thunk(D *callable, R (*)(Args...)) {
+        return {&invoke<D, R, Args...>, callable};
+    }
+    
+    void call(edge_hook when) {
+        for (auto const &h: hooks[static_cast<std::size_t>(when)])
+            h.f();
+    }
+    
+    // calls the timers due in this cycle, a timer may schedule again (also for this cycle)
+    void fire(edge_hook when) {
+        auto w = static_cast<std::size_t>(when);
+        if (pending[w] == 0)
+            return;
+        
+        auto &bucket = wheel[w * wheel_size + (cycles & wheel_mask)];
+        for (std::size_t i = 0; i < bucket.size(); ) {
+            if (bucket[i].at != cycles) {
+                ++i;
+                continue;
+            }
+            auto id = bucket[i].id;
+            bucket[i] = bucket.back();
+            bucket.pop_back();
+            --pending[w];
+            timers[id].f();
+        }
+    }
+    
+    /**
+     * @returns number of cycles until the first due timer, at most limit (and the size of the
+     * wheel).
+     */
+    std::uint64_t until_timer(std::uint64_t limit) const {
+        if (pending[0] + pending[1] + pending[2] + pending[3] == 0)
+            return limit;
+        
+        limit = std::min(limit, std::uint64_t(wheel_size));
+        for (std::uint64_t d = 0; d < limit; ++d) {
+            for (std::size_t w = 0; w < 4; ++w) {
+                for (auto const &e: wheel[w * wheel_size + ((cycles + d) & wheel_mask)])
+                    if (e.at == cycles + d)
+                        return d;
+            }
+        }
+        return limit;
+    }
+    
+    void call_unskippable(edge_hook when) {
+        for (auto const &h: hooks[static_cast<std::size_t>(when)])
+            if (!h.skippable)
+                h.f();
+    }
+    
+    /**
+     * @brief Runs a fast-forwarded window or a single cycle, at most limit cycles.
+     * @returns number of cycles run.
+     */
+    std::uint64_t advance(std::uint64_t limit) {
+        if (fast_forward_window == 0 || quiets.empty()) {
+            step();
+            return 1;
+        }
+        
+        // the window is the shortest quiescence, watched signals are collected
+        std::uint64_t window = limit;
+        watches.clear();
+        for (auto const &q: quiets) {
+            quiescence r = q();
+            window = std::min(window, r.cycles);
+            if (r.signal)
+                watches.push_back(r);
+        }
+        
+        if (window >= fast_forward_window)
+            window = until_timer(window);
+        
+        if (window < fast_forward_window) {
+            step();
+            return 1;
+        }
+        
+        std::uint64_t n = 0;
+        for (; n < window && watches_hold(); ++n) {
+            hdl->CLK = 1;
+            call_unskippable(edge_hook::before_posedge);
+            hdl->eval();
+            call_unskippable(edge_hook::after_posedge);
+            
+            hdl->CLK = 0;
+            call_unskippable(edge_hook::before_negedge);
+            hdl->eval();
+            call_unskippable(edge_hook::after_negedge);
+        }
+        
+        for (auto const &s: skips)
+            s(n);
+        cycles += n;
+        skipped += n;
+        
+        // a watched signal changed, this cycle is run with all the hooks
+        if (n == 0) {
+            step();
+            return 1;
+        }
+        return n;
+    }
+    
+    bool watches_hold() const {
+        for (auto const &w: watches)
+            if (*w.signal != w.level)
+                return false;
+        return true;
+    }
+    
+    HDL *hdl;
+    std::uint64_t cycles {0};
+    std::array<std::vector<hook>, 4> hooks;
+    
+    // fast-forward
+    std::uint64_t fast_forward_window {0};
+    std::uint64_t skipped {0};
+    std::vector<thunk<quiescence ()>> quiets;
+    std::vector<thunk<void (std::uint64_t)>> skips;
+    std::vector<quiescence> watches;
+    
+    // timers
+    std::vector<timer> timers;
+    std::vector<std::vector<timer_event>> wheel;    // 4 edges * wheel_size buckets
+    std::array<std::size_t, 4> pending {};
+    
+    // owns the callables
+    std::vector<std::unique_ptr<holder_base>> callables;
+};
+
+};
+
+#endif // CLOCK_DRIVER_HPP_INCLUDED
@@ -0,0 +1,123 @@
+/**
+ * @author Canberk Sönmez
+ * @file inplace_function.hpp
+ * @brief A std::function replacement which never allocates. The callable is stored inside the
+ * object, so it must fit into Capacity bytes.
+ */
+
+#ifndef INPLACE_FUNCTION_HPP_INCLUDED
+#define INPLACE_FUNCTION_HPP_INCLUDED
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+
+namespace verilator_aux {
+
+template <typename Signature, std::size_t Capacity = 6 * sizeof(void *)>
+struct inplace_function;
+
+template <typename R, typename ...Args, std::size_t Capacity>
+struct inplace_function<R (Args...), Capacity> {
+    static constexpr auto capacity = Capacity;
+    
+    inplace_function() noexcept = default;
+    
+    inplace_function(std::nullptr_t) noexcept {
+    }
+    
+    template <
+        typename F,
+        typename D = std::decay_t<F>,
+        typename = std::enable_if_t<!std::is_same<D, inplace_function>::value>>
+    inplace_function(F &&f) {
+        static_assert(
+            sizeof(D) <= Capacity,
+            "inplace_function: the callable is too large, capture less (or by reference).");
+        static_assert(
+            alignof(D) <= alignof(std::max_align_t),
+            "inplace_function: the callable is over-aligned.");
+        
+        ::new (static_cast<void *>(&storage)) D(std::forward<F>(f));
+        invoker = [](void *p, Args ...args) -> R {
+            return (*static_cast<D *>(p))(std::forward<Args>(args)...);
+        };
+        manager = [](void *dst, void *src) {
+            // dst == nullptr: destroy src, otherwise move src into dst and destroy src
+            if (dst)
+                ::new (dst) D(std::move(*static_cast<D *>(src)));
+            static_cast<D *>(src)->~D();
+        };
+    }
+    
+    inplace_function(inplace_function &&other) noexcept {
+        take(other);
+    }
+    
+    inplace_function &operator=(inplace_function &&other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+    
+    inplace_function &operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+    
+    inplace_function(inplace_function const &) = delete;
+    inplace_function &operator=(inplace_function const &) = delete;
+    
+    ~inplace_function() {
+        reset();
+    }
+    
+    R operator()(Args ...args) const {
+        if (!invoker)
+            throw std::bad_function_call();
+        return invoker(const_cast<void *>(static_cast<void const *>(&storage)),
+            std::forward<Args>(args)...);
+    }
+    
+    explicit operator bool() const noexcept {
+        return invoker != nullptr;
+    }
+    
+    friend bool operator==(inplace_function const &f, std::nullptr_t) noexcept {
+        return !f;
+    }
+    
+    friend bool operator!=(inplace_function const &f, std::nullptr_t) noexcept {
+        return !!f;
+    }
+private:
+    void reset() noexcept {
+        if (manager)
+            manager(nullptr, &storage);
+        invoker = nullptr;
+        manager = nullptr;
+    }
+    
+    void take(inplace_function &other) noexcept {
+        if (other.manager) {
+            other.manager(&storage, &other.storage);
+            invoker = other.invoker;
+            manager = other.manager;
+            other.invoker = nullptr;
+            other.manager = nullptr;
+        }
+    }
+    
+    std::aligned_storage_t<Capacity, alignof(std::max_align_t)> storage;
+    R (*invoker)(void *, Args...) {nullptr};
+    void (*manager)(void *, void *) {nullptr};
+};
+
+};
+
+#endif // INPLACE_FUNCTION_HPP_INCLUDED
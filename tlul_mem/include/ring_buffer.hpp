@@ -0,0 +1,130 @@
+/**
+ * @author Canberk Sönmez
+ * @file ring_buffer.hpp
+ * @brief A FIFO on a power-of-two ring. The storage is allocated once; push() grows it only if
+ * the ring is full, try_push() never does.
+ */
+
+#ifndef RING_BUFFER_HPP_INCLUDED
+#define RING_BUFFER_HPP_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace verilator_aux {
+
+template <typename T>
+struct ring_buffer {
+    explicit ring_buffer(std::size_t capacity = 16) {
+        reserve(capacity);
+    }
+    
+    ring_buffer(ring_buffer const &) = delete;
+    ring_buffer &operator=(ring_buffer const &) = delete;
+    
+    ring_buffer(ring_buffer &&other) noexcept:
+        storage{std::move(other.storage)},
+        mask{other.mask},
+        head{other.head},
+        count{other.count} {
+        other.mask = 0;
+        other.head = 0;
+        other.count = 0;
+    }
+    
+    ~ring_buffer() {
+        clear();
+    }
+    
+    std::size_t size() const { return count; }
+    std::size_t capacity() const { return storage ? mask + 1 : 0; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == capacity(); }
+    
+    T &front() { return *at(0); }
+    T const &front() const { return *at(0); }
+    T &back() { return *at(count - 1); }
+    T &operator[](std::size_t i) { return *at(i); }
+    T const &operator[](std::size_t i) const { return *at(i); }
+    
+    /**
+     * @brief Makes room for at least n elements. Existing elements are kept.
+     */
+    void reserve(std::size_t n) {
+        std::size_t cap = 1;
+        while (cap < n)
+            cap <<= 1;
+        if (storage && cap <= capacity())
+            return;
+        
+        std::unique_ptr<slot[]> s{new slot[cap]};
+        for (std::size_t i = 0; i < count; ++i) {
+            ::new (static_cast<void *>(&s[i])) T(std::move(*at(i)));
+            at(i)->~T();
+        }
+        storage = std::move(s);
+        mask = cap - 1;
+        head = 0;
+    }
+    
+    /**
+     * @returns false if the buffer is full.
+     */
+    template <typename ...Args>
+    bool try_emplace(Args && ...args) {
+        if (full())
+            return false;
+        ::new (static_cast<void *>(at(count))) T(std::forward<Args>(args)...);
+        ++count;
+        return true;
+    }
+    
+    bool try_push(T &&t) {
+        return try_emplace(std::move(t));
+    }
+    
+    template <typename ...Args>
+    T &emplace(Args && ...args) {
+        if (full())
+            reserve(capacity() * 2);
+        try_emplace(std::forward<Args>(args)...);
+        return back();
+    }
+    
+    void push(T &&t) {
+        emplace(std::move(t));
+    }
+    
+    void push(T const &t) {
+        emplace(t);
+    }
+    
+    void pop() {
+        at(0)->~T();
+        head = (head + 1) & mask;
+        --count;
+    }
+    
+    void clear() {
+        while (!empty())
+            pop();
+    }
+private:
+    using slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+    
+    T *at(std::size_t i) const {
+        return reinterpret_cast<T *>(&storage[(head + i) & mask]);
+    }
+    
+    std::unique_ptr<slot[]> storage;
+    std::size_t mask {0};
+    std::size_t head {0};
+    std::size_t count {0};
+};
+
+};
+
+#endif // RING_BUFFER_HPP_INCLUDED
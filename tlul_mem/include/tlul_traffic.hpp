@@ -0,0 +1,324 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_traffic.hpp
+ * @brief Constrained-random TL-UL traffic for tlul_testbench, checked against a shadow memory.
+ * 
+ * Every operation is drawn from the legal combinations of the testbench:
+ *     Get, PutFullData:  size 2^s <= bus width, naturally aligned address, the mask selects the
+ *                        2^s lanes of the address (check_correct_mask accepts it),
+ *     PutPartialData:    as above, the mask is a random non-empty subset of those lanes,
+ *     bursts:            Get and PutFullData of 2^s > bus width, up to Testbench::max_burst,
+ *                        naturally aligned, all lanes; only if weighted in, see mix.
+ * 
+ * The memories keep whole words of a bus width, and an operation touches only the word (or,
+ * for a burst, the words) of its own bytes, so any operation may end at the end of the memory.
+ * 
+ * The memory may sit at a base address on the bus (e.g. behind tlul_xbar), the addresses of
+ * the operations are offset by it.
+ * 
+ * Puts are applied to the shadow memory when generated, the slave executes operations in
+ * order; every AccessAckData is compared with the shadow at the time of its Get. A fixed number
+ * of operations is kept pending, a new one is generated from the callback of a completed one.
+ * The same seed gives the same operations. Nothing allocates in the steady state.
+ */
+
+#ifndef TLUL_TRAFFIC_HPP_INCLUDED
+#define TLUL_TRAFFIC_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <array>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <sstream>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "verilator_aux.hpp"
+
+namespace verilator_aux {
+
+template <typename Testbench>
+struct tlul_traffic {
+    using address_type      = typename Testbench::address_type;
+    using size_type         = typename Testbench::size_type;
+    using mask_type         = typename Testbench::mask_type;
+    using bytes             = typename Testbench::bytes;
+    
+    static constexpr std::size_t bus_width = Testbench::bus_width;
+    
+    static constexpr std::size_t max_burst = Testbench::max_burst;
+    
+    /**
+     * @brief Relative frequencies of the operations, all zero is not allowed. Bursts are off by
+     * default, the slave must support them.
+     */
+    struct mix {
+        unsigned get {1};
+        unsigned put_full_data {1};
+        unsigned put_partial_data {1};
+        unsigned get_burst {0};
+        unsigned put_burst {0};
+        
+        unsigned sum() const {
+            return get + put_full_data + put_partial_data + get_burst + put_burst;
+        }
+    };
+    
+    /**
+     * @param tb the testbench, it must not be used by anything else while the traffic runs,
+     * except by other traffic on memories of their own (the depths add up)
+     * @param memory initial content of the slave memory
+     * @param seed of the random operations
+     * @param depth number of operations kept pending (queued or in flight)
+     * @param base the bus address of memory[0], aligned to max_burst
+     */
+    tlul_traffic(
+            Testbench *tb, std::vector<std::uint8_t> memory, std::uint64_t seed,
+            std::size_t depth = Testbench::max_outstanding, mix weights = {},
+            address_type base = 0):
+        tb{tb},
+        shadow{std::move(memory)},
+        rng{seed},
+        depth{depth},
+        weights{weights},
+        base{base},
+        gets(depth) {
+        if (tb == nullptr || depth == 0)
+            throw std::invalid_argument("tlul_traffic: invalid testbench or depth");
+        if (shadow.size() < bus_width)
+            throw std::invalid_argument("tlul_traffic: memory is narrower than the bus");
+        if (weights.sum() == 0)
+            throw std::invalid_argument("tlul_traffic: all weights are zero");
+        if (base % max_burst != 0)
+            throw std::invalid_argument("tlul_traffic: base is not aligned");
+        
+        while ((std::size_t(2) << burst_log2) <= std::min(std::size_t(max_burst), shadow.size()))
+            ++burst_log2;
+        if (weights.get_burst + weights.put_burst != 0 && burst_log2 <= max_size_log2())
+            throw std::invalid_argument("tlul_traffic: no room for bursts");
+        
+        free_gets.reserve(depth);
+        for (std::size_t i = 0; i < depth; ++i)
+            free_gets.push_back(depth - 1 - i);
+        tb->reserve(depth);
+    }
+    
+    tlul_traffic(tlul_traffic const &) = delete;
+    tlul_traffic &operator=(tlul_traffic const &) = delete;
+    
+    /**
+     * @brief Enqueues the first operations, n operations are generated in total. The traffic
+     * must not move afterwards.
+     */
+    void start(std::uint64_t n) {
+        total = n;
+        started = std::chrono::steady_clock::now();
+        finished = started;
+        while (issued < total && issued - completed < depth)
+            next();
+    }
+    
+    /**
+     * @returns true if all operations are acknowledged.
+     */
+    bool done() const {
+        return completed == total;
+    }
+    
+    std::uint64_t operations() const { return completed; }
+    std::uint64_t checked() const { return checked_gets; }
+    std::uint64_t mismatches() const { return mismatch_count; }
+    std::uint64_t bytes_moved() const { return moved; }
+    
+    /**
+     * @returns a description of the first mismatch, empty if there is none.
+     */
+    std::string const &first_mismatch() const {
+        return first;
+    }
+    
+    /**
+     * @returns the expected content of the slave memory, after all operations.
+     */
+    std::vector<std::uint8_t> const &memory() const {
+        return shadow;
+    }
+    
+    /**
+     * @returns host time from start() until the last acknowledgement (or now, if not done).
+     */
+    double seconds() const {
+        auto end = done() ? finished : std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - started).count();
+    }
+    
+    void report(std::ostream &os) const {
+        double s = seconds();
+        os << "operations:          " << completed << "\n";
+        os << "checked gets:        " << checked_gets << "\n";
+        os << "mismatches:          " << mismatch_count << "\n";
+        os << "bytes moved:         " << moved << "\n";
+        os << "host time [s]:       " << s << "\n";
+        os << "operations/s:        " << (s > 0 ? completed / s : 0) << "\n";
+        os << "bytes/s:             " << (s > 0 ? moved / s : 0) << "\n";
+        if (!first.empty())
+            os << "first mismatch:      " << first << "\n";
+    }
+private:
+    // a Get waiting for its response
+    struct pending_get {
+        address_type address;
+        std::size_t size;
+        std::array<std::uint8_t, max_burst> expected;
+    };
+    
+    static constexpr std::size_t max_size_log2() {
+        std::size_t n = 0;
+        while ((std::size_t(1) << (n + 1)) <= bus_width)
+            ++n;
+        return n;
+    }
+    
+    static constexpr mask_type lanes(std::size_t first, std::size_t count) {
+        return mask_type(
+            (count >= sizeof(std::uintmax_t) * CHAR_BIT ?
+                ~std::uintmax_t(0) : (std::uintmax_t(1) << count) - 1) << first);
+    }
+    
+    std::uint64_t draw(std::uint64_t bound) {
+        return std::uniform_int_distribution<std::uint64_t>{0, bound - 1}(rng);
+    }
+    
+    // a naturally aligned address of 2^s bytes in the memory
+    address_type draw_address(std::size_t sz) {
+        return address_type(draw((shadow.size() - sz) / sz + 1) * sz);
+    }
+    
+    void next() {
+        ++issued;
+        
+        std::size_t s = draw(max_size_log2() + 1);
+        std::uint64_t pick = draw(weights.sum());
+        
+        // a burst is drawn as a Get or a PutFullData of more than a bus width
+        auto singles = weights.get + weights.put_full_data + weights.put_partial_data;
+        if (pick >= singles) {
+            s = max_size_log2() + 1 + draw(burst_log2 - max_size_log2());
+            pick = pick - singles < weights.get_burst ? 0 : weights.get;
+        }
+        
+        std::size_t sz = std::size_t(1) << s;
+        std::size_t width = std::min(sz, std::size_t(bus_width));
+        std::array<std::uint8_t, max_burst> data;
+        
+        if (pick < weights.get) {
+            auto address = draw_address(sz);
+            
+            std::size_t slot = free_gets.back();
+            free_gets.pop_back();
+            auto &g = gets[slot];
+            g.address = address;
+            g.size = sz;
+            std::copy_n(shadow.begin() + address, sz, g.expected.begin());
+            
+            tb->get([this, slot](bytes v) {
+                    check(slot, v);
+                    complete();
+                }, base + address, size_type(s), lanes(address % bus_width, width));
+        }
+        else if (pick < weights.get + weights.put_full_data) {
+            auto address = draw_address(sz);
+            
+            for (std::size_t i = 0; i < sz; ++i)
+                shadow[address + i] = data[i] = std::uint8_t(rng());
+            moved += sz;
+            
+            tb->put_full_data([this] { complete(); }, base + address, size_type(s),
+                lanes(address % bus_width, width), bytes{data.data(), sz});
+        }
+        else {
+            auto address = draw_address(sz);
+            std::size_t offset = address % bus_width;
+            std::size_t aligned = address - offset;
+            
+            mask_type mask;
+            do {
+                mask = mask_type(rng()) & lanes(offset, sz);
+            } while (mask == 0);
+            
+            std::size_t n = 0;
+            for (std::size_t lane = offset; lane < offset + sz; ++lane) {
+                if (mask >> lane & 1)
+                    shadow[aligned + lane] = data[n++] = std::uint8_t(rng());
+            }
+            moved += n;
+            
+            tb->put_partial_data([this] { complete(); }, base + address, size_type(s), mask,
+                bytes{data.data(), n});
+        }
+    }
+    
+    void check(std::size_t slot, bytes v) {
+        auto &g = gets[slot];
+        ++checked_gets;
+        moved += g.size;
+        
+        if (v.size() != g.size || !std::equal(v.begin(), v.end(), g.expected.begin())) {
+            if (mismatch_count++ == 0) {
+                std::ostringstream ss;
+                ss << "Get #" << checked_gets << " of " << g.size << " bytes at "
+                    << base + g.address << ": expected";
+                for (std::size_t i = 0; i < g.size; ++i)
+                    ss << " " << unsigned(g.expected[i]);
+                ss << ", got";
+                for (auto b: v)
+                    ss << " " << unsigned(b);
+                first = ss.str();
+            }
+        }
+        
+        free_gets.push_back(slot);
+    }
+    
+    void complete() {
+        ++completed;
+        if (issued < total)
+            next();
+        else if (done())
+            finished = std::chrono::steady_clock::now();
+    }
+    
+    Testbench *tb;
+    std::vector<std::uint8_t> shadow;
+    std::mt19937_64 rng;
+    std::size_t depth;
+    mix weights;
+    address_type base;
+    
+    // log2 of the largest burst, which fits max_burst and the memory
+    std::size_t burst_log2 {0};
+    
+    // Gets in flight, indexed by the slots captured by their callbacks
+    std::vector<pending_get> gets;
+    std::vector<std::size_t> free_gets;
+    
+    std::uint64_t total {0};
+    std::uint64_t issued {0};
+    std::uint64_t completed {0};
+    std::uint64_t checked_gets {0};
+    std::uint64_t mismatch_count {0};
+    std::uint64_t moved {0};
+    std::string first;
+    
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point finished;
+};
+
+}
+
+#endif // TLUL_TRAFFIC_HPP_INCLUDED
@@ -18,22 +18,33 @@
 #include <memory>
 #include <bitset>
 #include <algorithm>
+#include <numeric>
 
 #include <random>
 #include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <array>
 
 #include <verilator_aux.hpp>
 #include <hdl_tests_tlul_slave_memory.h>
+#include <hdl_tests_tlul_slave_memory_16bytes.h>
+#include <hdl_tests_tlul_slave_memory_32bytes.h>
+#include <hdl_tests_tlul_slave_memory_pipelined.h>
 #include <verilated_vcd_c.h>
 
 #include <type_traits>
 
 #include "tlul_testbench.hpp"
+#include "tlul_traffic.hpp"
+#include "memory_backdoor.hpp"
 
 namespace utf   = boost::unit_test::framework;
 
-using memory_traits = verilator_aux::packed_traits<decltype(hdl_tests_tlul_slave_memory::DATA)>;
-constexpr auto memory_size = memory_traits::size;
+// RAM_SIZE of tlul_slave_memory
+constexpr std::size_t memory_size = 256;
 
 std::size_t main_time = 0;
 
@@ -64,30 +75,22 @@ BOOST_AUTO_TEST_CASE(tlul_slave_memory) {
         std::mt19937 mt{seed};
         std::uniform_int_distribution<uint8_t> dist{0, 0xFF};
         
-        for (decltype(tb)::address_type address = 0; address < memory_size; address += 8) {
-            std::vector<uint8_t> data;
-            data.reserve(8);
-            for (int i = 0; i < 8; ++i) {
-                auto d = dist(mt);
-                data.push_back(d);
-                generated.push_back(d);
-            }
-            
-            tb.put_full_data([]{  }, address, 3, 0xff, std::move(data));
+        generated.resize(memory_size);
+        for (auto &d: generated) {
+            d = dist(mt);
         }
+        
+        tb.write_block([]{  }, 0, generated);
     };
     
     auto continuous_reads1 = [&] {
-        for (decltype(tb)::address_type address = 0; address < memory_size; address += 8) {
-            tb.get([&](const std::vector<uint8_t> &v) {
-                    std::copy(v.begin(), v.end(), std::back_inserter(acquired));
-                }, address, 3, 0xff);
-        }
+        acquired.resize(memory_size);
+        tb.read_block([]{  }, 0, acquired);
     };
     
     auto continuous_reads2 = [&] {
         for (decltype(tb)::address_type address = 0; address < memory_size; address += 4) {
-            tb.get([&](const std::vector<uint8_t> &v) {
+            tb.get([&](decltype(tb)::bytes v) {
                     std::copy(v.begin(), v.end(), std::back_inserter(acquired));
                 }, address, 2, /* 0b11110000 */ 0b00001111);
         }
@@ -118,3 +121,595 @@ BOOST_AUTO_TEST_CASE(tlul_slave_memory) {
     top->final();
     tfp->close();
 }
+
+// the pipelined memory takes an operation per cycle, so several are in flight at once
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_outstanding) {
+    using hdl = hdl_tests_tlul_slave_memory_pipelined;
+    
+    auto top = std::make_unique<hdl>();
+    
+    tlul_testbench<hdl> tb{top.get()};
+    
+    std::vector<uint8_t> generated;
+    std::vector<uint8_t> acquired(memory_size);
+    std::size_t max_outstanding = 0;
+    
+    auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::mt19937 mt(seed);
+    std::uniform_int_distribution<int> dist{0, 0xFF};
+    
+    // everything is enqueued at once, the testbench keeps as many requests in flight
+    // as the slave accepts
+    for (decltype(tb)::address_type address = 0; address < memory_size; address += 8) {
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 8; ++i) {
+            data.push_back(dist(mt));
+        }
+        generated.insert(generated.end(), data.begin(), data.end());
+        
+        tb.put_full_data([]{  }, address, 3, 0xff, std::move(data));
+    }
+    
+    for (decltype(tb)::address_type address = 0; address < memory_size; address += 8) {
+        // responses are matched by d_source, store them by address
+        tb.get([&, address](decltype(tb)::bytes v) {
+                std::copy(v.begin(), v.end(), acquired.begin() + address);
+            }, address, 3, 0xff);
+    }
+    
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    tb.attach(driver);
+    driver.on(verilator_aux::edge_hook::after_posedge, [&] {
+        max_outstanding = std::max(max_outstanding, tb.outstanding());
+    });
+    
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    auto cycles = driver.cycle();
+    
+    BOOST_TEST(acquired == generated);
+    BOOST_TEST(max_outstanding > 1u);
+
+#ifdef FORCE_PRINT
+    std::cout << "cycles: " << cycles << " ; max outstanding: " << max_outstanding << std::endl;
+#endif
+    
+    top->final();
+}
+
+/**
+ * A slave with the ports of tlul_slave_memory (W = 8, whole words only) which holds up to 8
+ * operations and answers them in a random order, one per cycle once 4 of them are held.
+ */
+struct reordering_slave {
+    std::uint8_t CLK {0};
+    
+    std::uint8_t a_opcode {0};
+    std::uint8_t a_param {0};
+    std::uint8_t a_size {0};
+    std::uint8_t a_source {0};
+    std::uint32_t a_address {0};
+    std::uint8_t a_mask {0};
+    std::uint64_t a_data {0};
+    std::uint8_t a_valid {0};
+    std::uint8_t a_ready {1};
+    
+    std::uint8_t d_opcode {0};
+    std::uint8_t d_param {0};
+    std::uint8_t d_size {0};
+    std::uint8_t d_source {0};
+    std::uint8_t d_sink {0};
+    std::uint64_t d_data {0};
+    std::uint8_t d_error {0};
+    std::uint8_t d_valid {0};
+    std::uint8_t d_ready {0};
+    
+    void eval() {
+        if (CLK && !last_clk)
+            posedge();
+        last_clk = CLK;
+    }
+    
+    void final() {  }
+    
+    struct pending {
+        std::uint8_t opcode;
+        std::uint8_t source;
+        std::uint64_t data;
+    };
+    
+    std::array<std::uint64_t, memory_size / 8> words {};
+    std::vector<pending> held;
+    std::mt19937 rng {7};
+    std::uint8_t last_clk {0};
+    
+private:
+    void posedge() {
+        if (d_valid && d_ready)
+            d_valid = 0;
+        
+        if (a_valid && a_ready) {
+            auto &word = words[a_address / 8 % words.size()];
+            if (a_opcode == 4) {
+                held.push_back(pending{1, a_source, word});
+            }
+            else {
+                word = a_data;
+                held.push_back(pending{0, a_source, 0});
+            }
+        }
+        
+        // lets a few operations gather, to pick from
+        if (!d_valid && (held.size() >= 4 || (!a_valid && !held.empty()))) {
+            auto i = std::uniform_int_distribution<std::size_t>{0, held.size() - 1}(rng);
+            d_opcode = held[i].opcode;
+            d_size = 3;
+            d_source = held[i].source;
+            d_data = held[i].data;
+            d_valid = 1;
+            held.erase(held.begin() + i);
+        }
+        
+        a_ready = held.size() < 8;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(tlul_testbench_out_of_order) {
+    reordering_slave slave;
+    tlul_testbench<reordering_slave> tb{&slave};
+    verilator_aux::clock_driver<reordering_slave> driver{&slave};
+    tb.attach(driver);
+    
+    constexpr std::size_t n = memory_size / 8;
+    std::vector<uint8_t> generated(memory_size);
+    std::iota(generated.begin(), generated.end(), 0x5a);
+    for (std::size_t i = 0; i < n; ++i)
+        std::memcpy(&slave.words[i], generated.data() + 8 * i, 8);
+    
+    // the index of every completed Get, in the order of the callbacks
+    std::vector<std::size_t> order;
+    std::vector<uint8_t> acquired(memory_size);
+    for (std::size_t i = 0; i < n; ++i) {
+        tb.get([&, i](decltype(tb)::bytes v) {
+                std::copy(v.begin(), v.end(), acquired.begin() + 8 * i);
+                order.push_back(i);
+            }, std::uint32_t(8 * i), 3, 0xff);
+    }
+    
+    std::size_t max_outstanding = 0;
+    driver.on(verilator_aux::edge_hook::after_posedge, [&] {
+        max_outstanding = std::max(max_outstanding, tb.outstanding());
+    });
+    
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    
+    BOOST_TEST(order.size() == n);
+    BOOST_TEST(!std::is_sorted(order.begin(), order.end()));
+    BOOST_TEST(acquired == generated);
+    BOOST_TEST(max_outstanding > 1u);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_stats) {
+    auto top = std::make_unique<hdl_tests_tlul_slave_memory>();
+    
+    tlul_testbench<hdl_tests_tlul_slave_memory> tb{top.get()};
+    
+    for (decltype(tb)::address_type address = 0; address < 64; address += 8) {
+        tb.put_full_data([]{  }, address, 3, 0xff, std::vector<uint8_t>(8, address));
+        tb.get([](decltype(tb)::bytes) {  }, address + 4, 1, 0b0011'0000);
+    }
+    tb.put_partial_data([]{  }, 0, 3, 0b0000'0110, std::vector<uint8_t>{1, 2});
+    
+    std::size_t cycles = 0;
+    top->CLK = 1;
+    
+    while (!tb.idle()) {
+        top->CLK = !top->CLK;
+        tb.eval();
+        cycles += top->CLK;
+        
+        BOOST_REQUIRE(cycles < 100000);
+    }
+    
+    auto const &stats = tb.stats();
+    auto const &gets = stats.ops[verilator_aux::tlul_stats::Get];
+    auto const &puts = stats.ops[verilator_aux::tlul_stats::PutFullData];
+    auto const &partials = stats.ops[verilator_aux::tlul_stats::PutPartialData];
+    
+    BOOST_TEST(stats.cycles == cycles);
+    BOOST_TEST(gets.count == 8u);
+    BOOST_TEST(gets.bytes == 16u);
+    BOOST_TEST(puts.count == 8u);
+    BOOST_TEST(puts.bytes == 64u);
+    BOOST_TEST(partials.count == 1u);
+    BOOST_TEST(partials.bytes == 2u);
+    BOOST_TEST(stats.bytes_per_cycle() == 82.0 / cycles);
+    
+    // a_valid is held for at least a cycle, and every histogram counts every operation
+    for (auto const &s: stats.ops) {
+        BOOST_TEST(s.wait_ready.min >= 1u);
+        BOOST_TEST(s.total.min >= s.wait_ready.min);
+        BOOST_TEST(s.total.max <= cycles);
+        for (auto const *h: {&s.wait_ready, &s.wait_ack, &s.total}) {
+            BOOST_TEST(std::accumulate(h->buckets.begin(), h->buckets.end(), 0u) == s.count);
+        }
+    }
+    
+    // header, 3 rows per opcode and 3 rows for all of them
+    std::ostringstream csv;
+    stats.write_csv(csv);
+    auto csv_text = csv.str();
+    BOOST_TEST(std::count(csv_text.begin(), csv_text.end(), '\n') == 13);
+    
+    std::ostringstream json;
+    stats.write_json(json);
+    BOOST_TEST(json.str().find("\"PutPartialData\": {") != std::string::npos);
+
+#ifdef FORCE_PRINT
+    std::cout << csv_text << json.str();
+#endif
+    
+    tb.reset_stats();
+    BOOST_TEST(tb.stats().cycles == 0u);
+    BOOST_TEST(tb.stats().all().count == 0u);
+    
+    top->final();
+}
+
+// with bursts of up to block_burst bytes (0, single beats), returns the cycles taken
+template <typename HDL>
+std::size_t test_blocks(std::size_t block_burst = 0) {
+    auto top = std::make_unique<HDL>();
+    
+    tlul_testbench<HDL> tb{top.get()};
+    if (block_burst != 0) {
+        tb.set_block_burst(block_burst);
+    }
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<uint8_t> shadow(memory_size);
+    for (std::size_t i = 0; i < memory_size; ++i) {
+        shadow[i] = i;
+    }
+    
+    std::mt19937 mt{42};
+    std::uniform_int_distribution<int> dist{0, 0xFF};
+    
+    std::vector<std::vector<uint8_t>> blocks;
+    std::size_t callbacks = 0;
+    
+    // unaligned heads and tails, blocks narrower than the bus and blocks inside a single beat
+    std::pair<std::size_t, std::size_t> const ranges[] = {
+        {0, 256}, {3, 1}, {5, 2}, {9, 13}, {17, 7}, {31, 66}, {100, 4}, {130, 3}, {250, 6}
+    };
+    
+    blocks.reserve(std::end(ranges) - std::begin(ranges));
+    
+    for (auto const &r: ranges) {
+        blocks.emplace_back(r.second);
+        for (auto &d: blocks.back()) {
+            d = dist(mt);
+        }
+        std::copy(blocks.back().begin(), blocks.back().end(), shadow.begin() + r.first);
+        
+        tb.write_block([&]{ ++callbacks; }, r.first, blocks.back());
+    }
+    
+    std::vector<uint8_t> acquired(memory_size);
+    std::vector<uint8_t> unaligned(77);
+    
+    tb.read_block([&]{ ++callbacks; }, 0, acquired);
+    tb.read_block([&]{ ++callbacks; }, 123, unaligned);
+    
+    std::size_t cycles = 0;
+    top->CLK = 1;
+    
+    while (!tb.idle()) {
+        top->CLK = !top->CLK;
+        tb.eval();
+        cycles += top->CLK;
+        
+        BOOST_REQUIRE(cycles < 100000);
+    }
+    
+    BOOST_TEST(callbacks == blocks.size() + 2);
+    BOOST_TEST(acquired == shadow);
+    BOOST_TEST(unaligned == std::vector<uint8_t>(shadow.begin() + 123, shadow.begin() + 200));
+    
+    top->final();
+    
+    return cycles;
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_blocks) {
+    test_blocks<hdl_tests_tlul_slave_memory>();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_blocks_16bytes) {
+    test_blocks<hdl_tests_tlul_slave_memory_16bytes>();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_blocks_32bytes) {
+    test_blocks<hdl_tests_tlul_slave_memory_32bytes>();
+}
+
+// the largest bursts, fewer handshakes than single beats
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_blocks_burst) {
+    using hdl = hdl_tests_tlul_slave_memory;
+    BOOST_TEST(test_blocks<hdl>(tlul_testbench<hdl>::max_burst) < test_blocks<hdl>());
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_blocks_burst_16bytes) {
+    using hdl = hdl_tests_tlul_slave_memory_16bytes;
+    BOOST_TEST(test_blocks<hdl>(tlul_testbench<hdl>::max_burst) < test_blocks<hdl>());
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_blocks_burst_32bytes) {
+    using hdl = hdl_tests_tlul_slave_memory_32bytes;
+    BOOST_TEST(test_blocks<hdl>(tlul_testbench<hdl>::max_burst) < test_blocks<hdl>());
+}
+
+// a beat per cycle either way, no slower with bursts
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_pipelined_blocks_burst) {
+    using hdl = hdl_tests_tlul_slave_memory_pipelined;
+    BOOST_TEST(test_blocks<hdl>(tlul_testbench<hdl>::max_burst) <= test_blocks<hdl>());
+}
+
+template <typename HDL>
+void test_random_traffic(
+        std::uint64_t seed, std::uint64_t n_ops,
+        typename verilator_aux::tlul_traffic<tlul_testbench<HDL>>::mix weights = {}) {
+    auto top = std::make_unique<HDL>();
+    
+    tlul_testbench<HDL> tb{top.get()};
+    verilator_aux::clock_driver<HDL> driver{top.get()};
+    tb.attach(driver);
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<uint8_t> initial(memory_size);
+    std::iota(initial.begin(), initial.end(), 0);
+    
+    verilator_aux::tlul_traffic<tlul_testbench<HDL>> traffic{
+        &tb, initial, seed, tlul_testbench<HDL>::max_outstanding, weights};
+    traffic.start(n_ops);
+    
+    BOOST_REQUIRE(driver.run_until([&] { return traffic.done(); }, 100 * n_ops));
+    BOOST_TEST(traffic.mismatches() == 0u, traffic.first_mismatch());
+    BOOST_TEST(traffic.checked() > 0u);
+    
+    // the whole memory agrees with the shadow at the end
+    std::vector<uint8_t> acquired(memory_size);
+    tb.read_block([]{  }, 0, acquired);
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    BOOST_TEST(acquired == traffic.memory());
+
+#ifdef FORCE_PRINT
+    std::cout << "seed: " << seed << " ; cycles: " << driver.cycle() << "\n";
+    traffic.report(std::cout);
+#endif
+    
+    top->final();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_random) {
+    test_random_traffic<hdl_tests_tlul_slave_memory>(42, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_random_16bytes) {
+    test_random_traffic<hdl_tests_tlul_slave_memory_16bytes>(43, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_random_32bytes) {
+    test_random_traffic<hdl_tests_tlul_slave_memory_32bytes>(44, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_pipelined_random) {
+    test_random_traffic<hdl_tests_tlul_slave_memory_pipelined>(45, 20000);
+}
+
+// bursts among single beats
+template <typename HDL>
+void test_random_bursts(std::uint64_t seed, std::uint64_t n_ops) {
+    typename verilator_aux::tlul_traffic<tlul_testbench<HDL>>::mix weights;
+    weights.get_burst = 1;
+    weights.put_burst = 1;
+    test_random_traffic<HDL>(seed, n_ops, weights);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_random_bursts) {
+    test_random_bursts<hdl_tests_tlul_slave_memory>(47, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_random_bursts_16bytes) {
+    test_random_bursts<hdl_tests_tlul_slave_memory_16bytes>(48, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_random_bursts_32bytes) {
+    test_random_bursts<hdl_tests_tlul_slave_memory_32bytes>(49, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_pipelined_random_bursts) {
+    test_random_bursts<hdl_tests_tlul_slave_memory_pipelined>(50, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_back_pressure) {
+    using hdl = hdl_tests_tlul_slave_memory;
+    
+    auto top = std::make_unique<hdl>();
+    tlul_testbench<hdl> tb{top.get()};
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    tb.attach(driver);
+    
+    // channel D stalls on random cycles, a_ready must stay low while a response waits
+    std::mt19937 mt{53};
+    tb.set_d_ready([&mt] { return (mt() & 1) != 0; });
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<uint8_t> initial(memory_size);
+    std::iota(initial.begin(), initial.end(), 0);
+    
+    verilator_aux::tlul_traffic<tlul_testbench<hdl>>::mix weights;
+    weights.get_burst = 1;
+    weights.put_burst = 1;
+    
+    verilator_aux::tlul_traffic<tlul_testbench<hdl>> traffic{
+        &tb, initial, 53, tlul_testbench<hdl>::max_outstanding, weights};
+    traffic.start(20000);
+    
+    BOOST_REQUIRE(driver.run_until([&] { return traffic.done(); }, 100 * 20000));
+    BOOST_TEST(traffic.mismatches() == 0u, traffic.first_mismatch());
+    BOOST_TEST(traffic.checked() > 0u);
+    
+    top->final();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_pipelined_back_pressure) {
+    using hdl = hdl_tests_tlul_slave_memory_pipelined;
+    
+    auto top = std::make_unique<hdl>();
+    tlul_testbench<hdl> tb{top.get()};
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    tb.attach(driver);
+    
+    // channel D stalls on random cycles, responses wait in the skid buffer
+    std::mt19937 mt{46};
+    tb.set_d_ready([&mt] { return mt() % 3 == 0; });
+    
+    std::size_t max_outstanding = 0;
+    driver.on(verilator_aux::edge_hook::after_posedge, [&] {
+        max_outstanding = std::max(max_outstanding, tb.outstanding());
+    });
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<uint8_t> initial(memory_size);
+    std::iota(initial.begin(), initial.end(), 0);
+    
+    verilator_aux::tlul_traffic<tlul_testbench<hdl>> traffic{&tb, initial, 46};
+    traffic.start(20000);
+    
+    BOOST_REQUIRE(driver.run_until([&] { return traffic.done(); }, 100 * 20000));
+    BOOST_TEST(traffic.mismatches() == 0u, traffic.first_mismatch());
+    BOOST_TEST(max_outstanding >= 2u);
+    
+    // one response in three cycles, the operations keep up with it
+    BOOST_TEST(double(traffic.operations()) / driver.cycle() > 0.3);
+    
+    top->final();
+}
+
+template <typename HDL>
+void test_backdoor() {
+    auto top = std::make_unique<HDL>();
+    
+    // before the testbench evaluates the model
+    verilator_aux::memory_backdoor backdoor{top.get()};
+    tlul_testbench<HDL> tb{top.get()};
+    verilator_aux::clock_driver<HDL> driver{top.get()};
+    tb.attach(driver);
+    
+    BOOST_REQUIRE(backdoor.size() == memory_size);
+    
+    // see the initial block of tlul_slave_memory
+    for (std::size_t i = 0; i < memory_size; ++i) {
+        BOOST_REQUIRE(backdoor.read(i) == uint8_t(i));
+    }
+    
+    std::mt19937 mt{7};
+    std::uniform_int_distribution<int> dist{0, 0xFF};
+    
+    // written through the backdoor, read over TL-UL
+    std::vector<uint8_t> written(memory_size);
+    for (auto &d: written) {
+        d = dist(mt);
+    }
+    backdoor.write(0, written);
+    
+    std::vector<uint8_t> acquired(memory_size);
+    tb.read_block([]{  }, 0, acquired);
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    BOOST_TEST(acquired == written);
+    
+    // written over TL-UL, read through the backdoor
+    std::vector<uint8_t> block(77);
+    for (auto &d: block) {
+        d = dist(mt);
+    }
+    tb.write_block([]{  }, 123, block);
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    
+    std::vector<uint8_t> read(block.size());
+    backdoor.read(123, read);
+    BOOST_TEST(read == block);
+    BOOST_TEST(backdoor.read(122) == written[122]);
+    BOOST_TEST(backdoor.read(200) == written[200]);
+    
+    BOOST_CHECK_THROW(backdoor.read(memory_size), std::out_of_range);
+    BOOST_CHECK_THROW(backdoor.write(memory_size - 4, written), std::out_of_range);
+    
+    top->final();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_backdoor) {
+    test_backdoor<hdl_tests_tlul_slave_memory>();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_backdoor_16bytes) {
+    test_backdoor<hdl_tests_tlul_slave_memory_16bytes>();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_backdoor_32bytes) {
+    test_backdoor<hdl_tests_tlul_slave_memory_32bytes>();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_image) {
+    using hdl = hdl_tests_tlul_slave_memory;
+    
+    auto top = std::make_unique<hdl>();
+    verilator_aux::memory_backdoor backdoor{top.get()};
+    tlul_testbench<hdl> tb{top.get()};
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    tb.attach(driver);
+    
+    // see the initial block of tlul_slave_memory
+    std::vector<uint8_t> expected(memory_size);
+    std::iota(expected.begin(), expected.end(), 0);
+    
+    std::mt19937 mt{11};
+    std::uniform_int_distribution<int> dist{0, 0xFF};
+    
+    std::vector<uint8_t> image(200);
+    for (auto &d: image) {
+        d = dist(mt);
+    }
+    {
+        std::ofstream out{"tlul_slave_memory_image.bin", std::ios::binary};
+        out.write(reinterpret_cast<char const *>(image.data()), image.size());
+    }
+    
+    // loaded at time 0, seen over TL-UL
+    BOOST_TEST(backdoor.load_image("tlul_slave_memory_image.bin", 13) == image.size());
+    std::copy(image.begin(), image.end(), expected.begin() + 13);
+    
+    std::vector<uint8_t> acquired(memory_size);
+    tb.read_block([]{  }, 0, acquired);
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    BOOST_TEST(acquired == expected);
+    
+    // written over TL-UL, seen in the dump
+    std::vector<uint8_t> block(40, 0xA5);
+    tb.write_block([]{  }, 100, block);
+    BOOST_REQUIRE(driver.run_until([&] { return tb.idle(); }, 100000));
+    std::copy(block.begin(), block.end(), expected.begin() + 100);
+    
+    backdoor.dump_image("tlul_slave_memory_dump.bin");
+    std::ifstream in{"tlul_slave_memory_dump.bin", std::ios::binary};
+    std::vector<uint8_t> dumped{std::istreambuf_iterator<char>{in}, {}};
+    BOOST_TEST(dumped == expected);
+    
+    backdoor.dump_image("tlul_slave_memory_dump.bin", 96, 0);
+    BOOST_TEST(backdoor.load_image("tlul_slave_memory_dump.bin", memory_size) == 0u);
+    
+    BOOST_CHECK_THROW(backdoor.load_image("tlul_slave_memory_image.bin", 100), std::out_of_range);
+    BOOST_CHECK_THROW(backdoor.load_image("no/such/image.bin"), std::runtime_error);
+    
+    top->final();
+}
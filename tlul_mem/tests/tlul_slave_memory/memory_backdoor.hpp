@@ -0,0 +1,185 @@
+/**
+ * @author Canberk Sönmez
+ * @file memory_backdoor.hpp
+ * @brief Backdoor access to the RAM of tlul_slave_memory: the bytes are read and written in
+ * place from C++, no TL-UL operations, no simulated cycles.
+ * 
+ * The model must be built with MEMORY_BACKDOOR defined. At time 0 it passes its array of words
+ * to the DPI import tlul_slave_memory_register() defined here; Verilator keeps the words of an
+ * unpacked array contiguous, in the byte order of the host, so on a little-endian host they are
+ * the bytes of the RAM in address order. This header defines the import, include it in exactly
+ * one translation unit of the executable.
+ * 
+ * Binary images are loaded into the RAM and dumped out of it through mmap() (POSIX), a copy at
+ * memory speed instead of a PutFullData per bus word.
+ */
+
+#ifndef MEMORY_BACKDOOR_HPP_INCLUDED
+#define MEMORY_BACKDOOR_HPP_INCLUDED
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <svdpi.h>
+
+#include "verilator_aux.hpp"
+
+namespace verilator_aux {
+
+class memory_backdoor {
+public:
+    memory_backdoor() = default;
+    
+    /**
+     * @brief Evaluates the model once, so that it registers its RAM. Must be done before the
+     * model is evaluated for the first time (by a testbench or a clock_driver).
+     */
+    template <typename HDL>
+    explicit memory_backdoor(HDL *hdl) {
+        last_registered() = memory_backdoor{};
+        hdl->eval();
+        *this = last_registered();
+        
+        if (first == nullptr)
+            throw std::runtime_error(
+                "memory_backdoor: no RAM registered, is MEMORY_BACKDOOR defined for the model?");
+    }
+    
+    std::uint8_t *data() const { return first; }
+    std::size_t size() const { return length; }
+    
+    std::uint8_t read(std::size_t address) const {
+        check(address, 1);
+        return first[address];
+    }
+    
+    void write(std::size_t address, std::uint8_t byte) const {
+        check(address, 1);
+        first[address] = byte;
+    }
+    
+    void read(std::size_t address, span<std::uint8_t> out) const {
+        check(address, out.size());
+        std::memcpy(out.data(), first + address, out.size());
+    }
+    
+    void write(std::size_t address, span<std::uint8_t const> in) const {
+        check(address, in.size());
+        std::memcpy(first + address, in.data(), in.size());
+    }
+    
+    /**
+     * @brief Copies the whole of a binary image file into the RAM, from the given address on.
+     * @returns the size of the image.
+     */
+    std::size_t load_image(std::string const &path, std::size_t address = 0) const {
+        mapped_file image{path, O_RDONLY, 0};
+        write(address, span<std::uint8_t const>{image.data, image.size});
+        return image.size;
+    }
+    
+    /**
+     * @brief Writes size bytes of the RAM from the given address on into a file, which is
+     * created or truncated.
+     */
+    void dump_image(std::string const &path, std::size_t address, std::size_t size) const {
+        check(address, size);
+        mapped_file image{path, O_RDWR | O_CREAT | O_TRUNC, size};
+        std::memcpy(image.data, first + address, size);
+    }
+    
+    void dump_image(std::string const &path) const {
+        dump_image(path, 0, length);
+    }
+    
+    // for tlul_slave_memory_register()
+    static memory_backdoor &last_registered() {
+        static memory_backdoor m;
+        return m;
+    }
+    
+    memory_backdoor(std::uint8_t *data, std::size_t size):
+        first{data},
+        length{size} {
+    }
+private:
+    // a file mapped whole, of the given size if it is created (size != 0 otherwise)
+    struct mapped_file {
+        mapped_file(std::string const &path, int flags, std::size_t new_size) {
+            fd = ::open(path.c_str(), flags, 0644);
+            if (fd < 0)
+                fail("open", path);
+            
+            if (flags & O_CREAT) {
+                size = new_size;
+                if (::ftruncate(fd, off_t(size)) != 0)
+                    fail("ftruncate", path);
+            }
+            else {
+                struct stat st;
+                if (::fstat(fd, &st) != 0)
+                    fail("fstat", path);
+                size = std::size_t(st.st_size);
+            }
+            
+            // mmap() takes no empty mappings
+            if (size == 0)
+                return;
+            
+            int prot = (flags & O_CREAT) ? PROT_READ | PROT_WRITE : PROT_READ;
+            void *p = ::mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED)
+                fail("mmap", path);
+            data = static_cast<std::uint8_t *>(p);
+        }
+        
+        mapped_file(mapped_file const &) = delete;
+        mapped_file &operator=(mapped_file const &) = delete;
+        
+        ~mapped_file() {
+            if (data != nullptr)
+                ::munmap(data, size);
+            if (fd >= 0)
+                ::close(fd);
+        }
+        
+        [[noreturn]] void fail(char const *what, std::string const &path) {
+            std::string message = std::string("memory_backdoor: ") + what + " " + path + ": " +
+                std::strerror(errno);
+            // the destructor does not run, nothing is mapped yet
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error(message);
+        }
+        
+        int fd {-1};
+        std::uint8_t *data {nullptr};
+        std::size_t size {0};
+    };
+    
+    void check(std::size_t address, std::size_t n) const {
+        if (address > length || n > length - address)
+            throw std::out_of_range("memory_backdoor: out of range");
+    }
+    
+    std::uint8_t *first {nullptr};
+    std::size_t length {0};
+};
+
+}
+
+// called from the initial block of tlul_slave_memory
+extern "C" void tlul_slave_memory_register(const svOpenArrayHandle words, int size) {
+    verilator_aux::memory_backdoor::last_registered() = verilator_aux::memory_backdoor{
+        static_cast<std::uint8_t *>(svGetArrayPtr(words)), std::size_t(size) };
+}
+
+#endif // MEMORY_BACKDOOR_HPP_INCLUDED
@@ -3,6 +3,16 @@
  * @file tlul_slave_memory.sv
  * @brief Implements TileLink-UL protocol as slave agent.
  * 
+ * The RAM is an unpacked array of W-byte words, so an access costs the same whatever RAM_SIZE
+ * is (a power of 2, at least W; addresses wrap around it). Byte i of the RAM is byte lane
+ * i % W of word i / W.
+ * 
+ * Built with MEMORY_BACKDOOR defined, the words are handed to the C++ side at time 0, see
+ * memory_backdoor.hpp, which must then be linked in.
+ * 
+ * An operation of 2^a_size > W bytes is a burst over whole words, aligned to its size: a Get
+ * is answered by one AccessAckData beat per word, a Put takes one beat per word on channel A
+ * and is answered by a single AccessAck after the last one.
  */
 
 // tlul_slave_memory module
@@ -27,10 +37,6 @@ module tlul_slave_memory
         // the reset signal
         RESET,
         
-        // the data contained in the RAM
-        // only for debugging purposes
-        DATA,
-        
         // Channel A ports
         a_opcode,
         a_param,
@@ -54,8 +60,6 @@ module tlul_slave_memory
         d_ready
         
         // END
-        
-        , DATA_DBG
     );
     
     // BEGIN Port Definitions
@@ -63,10 +67,6 @@ module tlul_slave_memory
     input CLK;
     input RESET;
     
-    output reg [8*RAM_SIZE-1:0] DATA;
-    
-    output wire [63:0] DATA_DBG = DATA[63:0];
-    
     // Channel A definitions (for SLAVE interface)
     input [2:0]             a_opcode;
     input [2:0]             a_param;
@@ -101,20 +101,56 @@ module tlul_slave_memory
     
     parameter st_IDLE = 0;
     parameter st_WRDY = 1;
+    parameter st_GET_BURST = 2;
+    parameter st_PUT_BURST = 3;
     
     reg [3:0] state = st_IDLE;
     
+    // BEGIN the RAM
+    localparam WORDS = RAM_SIZE / W;
+    localparam WORD_BITS = $clog2(W);
+    localparam INDEX_BITS = WORDS > 1 ? $clog2(WORDS) : 1;
+    
+    reg [8*W-1:0] mem [0:WORDS-1];
+    
+`ifdef MEMORY_BACKDOOR
+    import "DPI-C" function void tlul_slave_memory_register(
+        input logic [8*W-1:0] words [], input int size);
+`endif
+    
     // for debugging purposes
     integer i;
+    integer k;
     integer tmp;
     
     initial begin
-        for (i = 0; i < RAM_SIZE; i = i + 1) begin: test
-            tmp = i ; // *8;
-            DATA[i*8 +: 8] = tmp[7:0];
+        for (i = 0; i < WORDS; i = i + 1) begin: test
+            for (k = 0; k < W; k = k + 1) begin
+                tmp = i * W + k;
+                mem[i][k*8 +: 8] = tmp[7:0];
+            end
         end
+`ifdef MEMORY_BACKDOOR
+        tlul_slave_memory_register(mem, RAM_SIZE);
+`endif
     end
     
+    // the word holding a_address, and the offset of a_address in it in bits
+    wire [INDEX_BITS-1:0] word_index = a_address[WORD_BITS +: INDEX_BITS];
+    wire [8*W-1:0] word = mem[word_index];
+    wire [A-1:0] word_offset = (a_address & (W-1)) * 8;
+    // END
+    
+    // BEGIN bursts, the words after the first one
+    wire burst = a_size > WORD_BITS;
+    wire [A-1:0] burst_beats = 1 << (a_size - WORD_BITS);
+    
+    reg [INDEX_BITS-1:0] burst_index;
+    reg [A-1:0] burst_left;
+    // the first beat of a Put burst is written in st_IDLE, accepted in st_PUT_BURST
+    reg burst_first;
+    // END
+    
     parameter ROWBITS = 4;
     reg [ROWBITS-1:0] temp;
     
@@ -123,7 +159,7 @@ module tlul_slave_memory
         #( .W(W), .BYTE_BIT(8), .A(A) )
         m2l(
             .MASK_IN(a_mask),
-            .MEM(DATA[a_address * 8 +: W*8]),
+            .MEM(word >> word_offset),
             .DATA(masked_d_data));
     
     wire [8*W-1:0] masked_memory;
@@ -143,6 +179,18 @@ module tlul_slave_memory
         #( .W(W), .Z(Z), .BYTE_BIT(8) )
         mbs( .SIZE(a_size), .MASK(mask_size) );
     
+    // for PutPartialData, byte lane i corresponds to the address
+    // (a_address & ~(W-1)) + i, that is lane i of the word, and only
+    // the lanes selected by a_mask are written
+    wire [8*W-1:0] mask_lanes;
+    generate
+        genvar j;
+        
+        for (j = 0; j < W; j = j + 1) begin: lanes
+            assign mask_lanes[j*8 +: 8] = {8{a_mask[j]}};
+        end
+    endgenerate
+    
     always @(posedge CLK) begin
         case (state)
         st_IDLE: begin
@@ -156,12 +204,36 @@ module tlul_slave_memory
                     d_valid <= 1'b1;
                     d_source <= a_source;
                     d_sink <= 0;
-                    d_data <= masked_d_data;
                     d_error <= 0;
                     
-                    state <= st_WRDY;
+                    if (burst) begin
+                        d_data <= word;
+                        burst_index <= word_index + 1;
+                        burst_left <= burst_beats - 1;
+                        
+                        state <= st_GET_BURST;
+                    end
+                    else begin
+                        d_data <= masked_d_data;
+                        
+                        state <= st_WRDY;
+                    end
+                end
+                OP_PutFullData, OP_PutPartialData: if (burst) begin
+                    // the first beat, acknowledged after the last one
+                    a_ready <= 1'b1;
+                    
+                    mem[word_index] <=
+                        (a_data & mask_lanes) |
+                        (word & (~mask_lanes));
+                    
+                    burst_index <= word_index + 1;
+                    burst_left <= burst_beats - 1;
+                    burst_first <= 1'b1;
+                    
+                    state <= st_PUT_BURST;
                 end
-                OP_PutFullData: begin
+                else if (a_opcode == OP_PutFullData) begin
                     a_ready <= 1'b1;
                     d_opcode <= OP_AccessAck;
                     d_param <= 0;
@@ -172,9 +244,26 @@ module tlul_slave_memory
                     d_data <= 0;
                     d_error <= 0;
                     
-                    DATA[a_address*8 +: W*8] <=
-                        (intermediate_memory & mask_size) |
-                        (DATA[a_address*8 +: W*8] & (~mask_size));
+                    mem[word_index] <=
+                        ((intermediate_memory & mask_size) << word_offset) |
+                        (word & (~(mask_size << word_offset)));
+                    
+                    state <= st_WRDY;
+                end
+                else begin
+                    a_ready <= 1'b1;
+                    d_opcode <= OP_AccessAck;
+                    d_param <= 0;
+                    d_size <= a_size;
+                    d_valid <= 1'b1;
+                    d_source <= a_source;
+                    d_sink <= 0;
+                    d_data <= 0;
+                    d_error <= 0;
+                    
+                    mem[word_index] <=
+                        (a_data & mask_lanes) |
+                        (word & (~mask_lanes));
                     
                     state <= st_WRDY;
                 end
@@ -186,13 +275,59 @@ module tlul_slave_memory
             end
         end
         st_WRDY: begin
+            // the operation is accepted, a_ready stays low until the
+            // response is taken: the next one waits in st_IDLE
+            a_ready <= 1'b0;
+            
             if (d_ready == 1'b1) begin
                 d_valid <= 1'b0;
-                a_ready <= 1'b0;
                 
                 state <= st_IDLE;
             end
         end
+        st_GET_BURST: begin
+            // the Get is accepted
+            a_ready <= 1'b0;
+            
+            if (d_ready == 1'b1) begin
+                if (burst_left == 0) begin
+                    d_valid <= 1'b0;
+                    
+                    state <= st_IDLE;
+                end
+                else begin
+                    d_data <= mem[burst_index];
+                    burst_index <= burst_index + 1;
+                    burst_left <= burst_left - 1;
+                end
+            end
+        end
+        st_PUT_BURST: begin
+            if (burst_first == 1'b1) begin
+                burst_first <= 1'b0;
+            end
+            else if (a_valid == 1'b1) begin
+                mem[burst_index] <=
+                    (a_data & mask_lanes) |
+                    (mem[burst_index] & (~mask_lanes));
+                burst_index <= burst_index + 1;
+                burst_left <= burst_left - 1;
+                
+                if (burst_left == 1) begin
+                    a_ready <= 1'b0;
+                    d_opcode <= OP_AccessAck;
+                    d_param <= 0;
+                    d_size <= a_size;
+                    d_valid <= 1'b1;
+                    d_source <= a_source;
+                    d_sink <= 0;
+                    d_data <= 0;
+                    d_error <= 0;
+                    
+                    state <= st_WRDY;
+                end
+            end
+        end
         endcase
     end
 endmodule
@@ -0,0 +1,298 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_slave_memory_pipelined.sv
+ * @brief TileLink-UL slave memory which accepts an operation every cycle.
+ * 
+ * The RAM and the backdoor are as in tlul_slave_memory. An operation is carried out in the
+ * cycle it is accepted (a Put writes the RAM, a Get reads it) and its response goes to the
+ * channel D register, or, while channel D is stalled, to a skid buffer of one response.
+ * a_ready is low only while the skid buffer is full, so with d_ready high a Get or a Put is
+ * accepted and acknowledged every cycle, one cycle later. Responses are in order.
+ * 
+ * Bursts (2^a_size > W bytes, aligned to their size) move a word per cycle as well: the beats
+ * of a Put are written as they are accepted and acknowledged once, after the last one; a Get
+ * takes one cycle on channel A, then a_ready stays low while its words go out on channel D.
+ */
+
+// tlul_slave_memory_pipelined module
+module tlul_slave_memory_pipelined
+    #(
+        // BEGIN Parameters
+        parameter
+        RAM_SIZE = 256, // bytes
+        W = 8,
+        A = 32,
+        Z = 4,
+        O = 5,
+        I = 5
+        // END
+    )
+    (
+        // BEGIN Port Declarations
+        
+        // the clock signal
+        CLK,
+        
+        // the reset signal
+        RESET,
+        
+        // Channel A ports
+        a_opcode,
+        a_param,
+        a_size,
+        a_source,
+        a_address,
+        a_mask,
+        a_data,
+        a_valid,
+        a_ready,
+        
+        // Channel D ports
+        d_opcode,
+        d_param,
+        d_size,
+        d_source,
+        d_sink,
+        d_data,
+        d_error,
+        d_valid,
+        d_ready
+        
+        // END
+    );
+    
+    // BEGIN Port Definitions
+    
+    input CLK;
+    input RESET;
+    
+    // Channel A definitions (for SLAVE interface)
+    input [2:0]             a_opcode;
+    input [2:0]             a_param;
+    input [Z-1:0]           a_size;
+    input [O-1:0]           a_source;
+    input [A-1:0]           a_address;
+    input [W-1:0]           a_mask;
+    input [8*W-1:0]         a_data;
+    input                   a_valid;
+    output wire             a_ready;
+    
+    // Channel D definitions (for SLAVE interface)
+    output reg [2:0]        d_opcode;
+    output reg [1:0]        d_param;
+    output reg [Z-1:0]      d_size;
+    output reg [O-1:0]      d_source;
+    output reg [I-1:0]      d_sink;
+    output reg [8*W-1:0]    d_data;
+    output reg              d_error;
+    output reg              d_valid = 1'b0;
+    input                   d_ready;
+    
+    // END
+    
+    // BEGIN opcodes for TL-UL
+    parameter OP_Get                = 3'd4;
+    parameter OP_AccessAckData      = 3'd1;
+    parameter OP_PutFullData        = 3'd0;
+    parameter OP_PutPartialData     = 3'd1;
+    parameter OP_AccessAck          = 3'd0;
+    // END
+    
+    // BEGIN the RAM, as in tlul_slave_memory
+    localparam WORDS = RAM_SIZE / W;
+    localparam WORD_BITS = $clog2(W);
+    localparam INDEX_BITS = WORDS > 1 ? $clog2(WORDS) : 1;
+    
+    reg [8*W-1:0] mem [0:WORDS-1];
+
+`ifdef MEMORY_BACKDOOR
+    import "DPI-C" function void tlul_slave_memory_register(
+        input logic [8*W-1:0] words [], input int size);
+`endif
+    
+    // for debugging purposes
+    integer i;
+    integer k;
+    integer tmp;
+    
+    initial begin
+        for (i = 0; i < WORDS; i = i + 1) begin: test
+            for (k = 0; k < W; k = k + 1) begin
+                tmp = i * W + k;
+                mem[i][k*8 +: 8] = tmp[7:0];
+            end
+        end
+`ifdef MEMORY_BACKDOOR
+        tlul_slave_memory_register(mem, RAM_SIZE);
+`endif
+    end
+    
+    // the word holding a_address, and the offset of a_address in it in bits
+    wire [INDEX_BITS-1:0] word_index = a_address[WORD_BITS +: INDEX_BITS];
+    wire [8*W-1:0] word = mem[word_index];
+    wire [A-1:0] word_offset = (a_address & (W-1)) * 8;
+    // END
+    
+    // BEGIN bursts
+    wire burst = a_size > WORD_BITS;
+    wire [A-1:0] burst_beats = 1 << (a_size - WORD_BITS);
+    
+    // the beats of a Put burst still to come, and the word of the next one
+    reg [A-1:0]             put_left = 0;
+    reg [INDEX_BITS-1:0]    put_index;
+    
+    // the words of a Get burst still to be sent, the next one, and the response
+    reg [A-1:0]             get_left = 0;
+    reg [INDEX_BITS-1:0]    get_index;
+    reg [Z-1:0]             get_size;
+    reg [O-1:0]             get_source;
+    
+    // a_data is a beat of a Put burst, written whole (under a_mask) into put_word
+    wire put_beat = put_left != 0 || (a_opcode != OP_Get && burst);
+    wire [INDEX_BITS-1:0] put_word = put_left != 0 ? put_index : word_index;
+    // END
+    
+    wire [8*W-1:0] masked_d_data;
+    masked_m2l_connector
+        #( .W(W), .BYTE_BIT(8), .A(A) )
+        m2l(
+            .MASK_IN(a_mask),
+            .MEM(word >> word_offset),
+            .DATA(masked_d_data));
+    
+    reg [8*W-1:0] intermediate_memory;
+    masked_l2m_connector
+        #( .W(W), .BYTE_BIT(8), .A(A) )
+        l2m(
+            .MASK_IN(a_mask),
+            .MEM(intermediate_memory),
+            .DATA(a_data));
+    
+    reg [8*W-1:0] mask_size;
+    mask_by_size
+        #( .W(W), .Z(Z), .BYTE_BIT(8) )
+        mbs( .SIZE(a_size), .MASK(mask_size) );
+    
+    // for PutPartialData, byte lane i is lane i of the word
+    wire [8*W-1:0] mask_lanes;
+    generate
+        genvar j;
+        
+        for (j = 0; j < W; j = j + 1) begin: lanes
+            assign mask_lanes[j*8 +: 8] = {8{a_mask[j]}};
+        end
+    endgenerate
+    
+    // BEGIN the response to the operation on channel A, or the next word of a Get burst
+    wire is_get = a_opcode == OP_Get;
+    
+    // a Put burst is acknowledged after its last beat
+    wire a_response = put_left != 0 ? put_left == 1 : ~put_beat;
+    
+    wire            get_beat = get_left != 0;
+    wire [2:0]      r_opcode = get_beat | is_get ? OP_AccessAckData : OP_AccessAck;
+    wire [Z-1:0]    r_size = get_beat ? get_size : a_size;
+    wire [O-1:0]    r_source = get_beat ? get_source : a_source;
+    wire [8*W-1:0]  r_data = get_beat ? mem[get_index] : is_get ? masked_d_data : 0;
+    // END
+    
+    // BEGIN the skid buffer, holds a response while channel D is stalled
+    reg             s_valid = 1'b0;
+    reg [2:0]       s_opcode;
+    reg [Z-1:0]     s_size;
+    reg [O-1:0]     s_source;
+    reg [8*W-1:0]   s_data;
+    // END
+    
+    assign a_ready = ~s_valid & ~get_beat;
+    
+    wire a_fire = a_valid & a_ready;
+    
+    // a response goes to channel D or to the skid buffer
+    wire r_fire = (a_fire & a_response) | (get_beat & ~s_valid);
+    
+    // channel D takes a new response
+    wire d_free = ~d_valid | d_ready;
+    
+    always @(posedge CLK) begin
+        if (a_fire & put_beat) begin
+            mem[put_word] <=
+                (a_data & mask_lanes) |
+                (mem[put_word] & (~mask_lanes));
+            
+            if (put_left != 0) begin
+                put_index <= put_index + 1;
+                put_left <= put_left - 1;
+            end
+            else begin
+                put_index <= word_index + 1;
+                put_left <= burst_beats - 1;
+            end
+        end
+        else if (a_fire) begin
+            case (a_opcode)
+            OP_Get: begin
+                // read above, into r_data
+                if (burst) begin
+                    get_index <= word_index + 1;
+                    get_left <= burst_beats - 1;
+                    get_size <= a_size;
+                    get_source <= a_source;
+                end
+            end
+            OP_PutFullData: begin
+                mem[word_index] <=
+                    ((intermediate_memory & mask_size) << word_offset) |
+                    (word & (~(mask_size << word_offset)));
+            end
+            OP_PutPartialData: begin
+                mem[word_index] <=
+                    (a_data & mask_lanes) |
+                    (word & (~mask_lanes));
+            end
+            default: begin
+                $error("sv-error: not implemented");
+                $finish;
+            end
+            endcase
+        end
+        
+        if (get_beat & ~s_valid) begin
+            get_index <= get_index + 1;
+            get_left <= get_left - 1;
+        end
+        
+        if (d_free) begin
+            d_param <= 0;
+            d_sink <= 0;
+            d_error <= 0;
+            
+            if (s_valid) begin
+                // the skid buffer first, a_ready was low
+                d_opcode <= s_opcode;
+                d_size <= s_size;
+                d_source <= s_source;
+                d_data <= s_data;
+                d_valid <= 1'b1;
+                s_valid <= 1'b0;
+            end
+            else if (r_fire) begin
+                d_opcode <= r_opcode;
+                d_size <= r_size;
+                d_source <= r_source;
+                d_data <= r_data;
+                d_valid <= 1'b1;
+            end
+            else begin
+                d_valid <= 1'b0;
+            end
+        end
+        else if (r_fire) begin
+            s_opcode <= r_opcode;
+            s_size <= r_size;
+            s_source <= r_source;
+            s_data <= r_data;
+            s_valid <= 1'b1;
+        end
+    end
+endmodule
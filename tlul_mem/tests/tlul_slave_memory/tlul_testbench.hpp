@@ -7,8 +7,11 @@
 #ifndef TLUL_TESTBENCH_INCLUDED
 #define TLUL_TESTBENCH_INCLUDED
 
-#include <queue>
-#include <functional>
+#include <array>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <initializer_list>
 #include <stdexcept>
 #include <algorithm>
 #include <bitset>
@@ -16,12 +19,38 @@
 #include <boost/variant.hpp>
 
 #include "verilator_aux.hpp"
+#include "byte_lanes.hpp"
+#include "inplace_function.hpp"
+#include "ring_buffer.hpp"
+#include "tlul_stats.hpp"
+#include "clock_driver.hpp"
 
 /**
- * At first I will not consider the case with multiple
- * operations at the same time. Next operation is dispatched
- * iff the previous operation returned an ACK.
+ * Channels A and D are handled independently. An operation is put on
+ * channel A as soon as channel A is free and a source ID is available.
+ * Each operation in flight is tagged with a unique a_source, and
+ * responses are matched by d_source, so callbacks may fire out of order.
  * 
+ * At most 2^O operations can be in flight at the same time, O being the
+ * width of a_source (as in the SV modules). set_max_outstanding(1) gives
+ * the old behaviour: next operation is dispatched iff the previous
+ * operation returned an ACK.
+ * 
+ * Enqueuing and dispatching do not allocate in the steady state: the
+ * queue is a ring buffer, payloads are stored inline (up to the width of
+ * a_data) and callbacks are inplace_functions. A Get callback receives a
+ * span which is valid only during the call.
+ * 
+ * The latency of every acknowledged operation (cycles waiting for a_ready,
+ * then for the response) and the bytes moved are collected in a tlul_stats,
+ * see stats().
+ * 
+ * Bursts: a Get or a PutFullData of 2^size bytes wider than the bus (up to
+ * B beats) takes all the lanes on every beat. The beats of a PutFullData
+ * follow each other on channel A, the Get is a single beat on channel A and
+ * its AccessAckData comes in 2^size / W beats on channel D; the beats of a
+ * message are never interleaved with another message. The address is that
+ * of the first byte on every beat.
  */
 
 namespace detail {
@@ -64,37 +93,113 @@ bool check_correct_mask(std::bitset<N> bs) {
     return bs.none();
 }
 
-template <typename HDLSlaveMemory>
-struct tlul_testbench: boost::static_visitor<bool> {
+template <typename HDLSlaveMemory, unsigned O = 5, std::size_t B = 8>
+struct tlul_testbench {
     
-    tlul_testbench(HDLSlaveMemory *hdlslavememory):
-        hdl {hdlslavememory} {
+    tlul_testbench(HDLSlaveMemory *hdlslavememory, std::size_t queue_capacity = 64):
+        hdl {hdlslavememory},
+        op_queue {queue_capacity} {
+        for (std::size_t i = 0; i < max_outstanding; ++i)
+            free_sources[i] = max_outstanding - 1 - i;
     }
     
     using address_traits    = packed_traits<decltype(HDLSlaveMemory::a_address)>;
     using size_traits       = packed_traits<decltype(HDLSlaveMemory::a_size)>;
+    using source_traits     = packed_traits<decltype(HDLSlaveMemory::a_source)>;
     using mask_traits       = packed_traits<decltype(HDLSlaveMemory::a_mask)>;
     using data_traits       = packed_traits<decltype(HDLSlaveMemory::a_data)>;
     
     using address_type      = typename address_traits::element_type;
     using size_type         = typename size_traits::element_type;
+    using source_type       = typename source_traits::element_type;
     using mask_type         = typename mask_traits::element_type;
     using data_type         = typename data_traits::element_type;
     
+    // a_data/d_data may be wide (WData [N] or VlWide<N>), they are accessed
+    // word at a time through verilator_aux::{get,set}_lane
     static_assert(
         address_traits::length == 1 &&
         size_traits::length == 1 &&
-        mask_traits::length == 1 &&
-        data_traits::length == 1,
-        "Unfortunately, the given HDL code uses a lot of bits (>= 65). "
-        " The code is not written for such cases."
+        source_traits::length == 1 &&
+        mask_traits::length == 1,
+        "Unfortunately, the given HDL code uses a lot of bits (>= 65) for a control signal. "
+        " The code is only written for wide data (W <= 64)."
     );
     
+    static_assert(
+        O <= source_traits::size_in_bits,
+        "a_source is narrower than O bits.");
+    
+    /**
+     * @brief Maximum number of operations in flight, 2^O.
+     */
+    static constexpr std::size_t max_outstanding = std::size_t(1) << O;
+    
+    /**
+     * @brief Width of the data bus in bytes (W in the SV modules).
+     */
+    static constexpr std::size_t bus_width = data_traits::size;
+    
+    static_assert(
+        bus_width && !(bus_width & (bus_width - 1)),
+        "The width of a_data must be a power of 2 bytes.");
+    
+    static_assert(
+        B && !(B & (B - 1)),
+        "The number of beats of a burst must be a power of 2.");
+    
+    /**
+     * @brief Largest Get or PutFullData in bytes, B beats.
+     */
+    static constexpr std::size_t max_burst = bus_width * B;
+    
+    using bytes             = span<std::uint8_t const>;
+    using get_callback_type = inplace_function<void (bytes)>;
+    using callback_type     = inplace_function<void ()>;
+    
+    /**
+     * @brief Data of an operation, up to a burst, stored inline. Constructible from any
+     * container of bytes.
+     */
+    struct payload {
+        static constexpr std::size_t capacity = max_burst;
+        
+        payload() = default;
+        
+        payload(std::initializer_list<std::uint8_t> il) {
+            assign(il.begin(), il.end());
+        }
+        
+        template <
+            typename Range,
+            typename = std::enable_if_t<!std::is_same<std::decay_t<Range>, payload>::value>>
+        payload(Range const &r) {
+            assign(std::begin(r), std::end(r));
+        }
+        
+        template <typename It>
+        void assign(It first, It last) {
+            length = 0;
+            for (; first != last; ++first) {
+                if (length == capacity)
+                    throw std::length_error("tlul_testbench: payload is larger than a burst");
+                bytes[length++] = *first;
+            }
+        }
+        
+        std::uint8_t const *begin() const { return bytes.data(); }
+        std::uint8_t const *end() const { return bytes.data() + length; }
+        std::size_t size() const { return length; }
+        
+        std::array<std::uint8_t, capacity>                  bytes;
+        std::size_t                                         length {0};
+    };
+    
     /**
      * @brief TL-UL Get operation.
      */
     struct get_op {
-        std::function<void (std::vector<std::uint8_t> const &)> callback;
+        get_callback_type                                   callback;
         address_type                                        address;
         size_type                                           size;
         mask_type                                           mask;
@@ -104,33 +209,34 @@ struct tlul_testbench: boost::static_visitor<bool> {
      * @brief TL-UL PutFullData operation.
      */
     struct put_full_data_op {
-        std::function<void ()>                              callback;
+        callback_type                                       callback;
         address_type                                        address;
         size_type                                           size;
         mask_type                                           mask;
-        std::vector<std::uint8_t>                           data;
+        payload                                             data;
     };
     
     /**
      * @brief TL-UL PutPartialData operation.
      */
     struct put_partial_data_op {
-        std::function<void ()>                              callback;
+        callback_type                                       callback;
         address_type                                        address;
         size_type                                           size;
         mask_type                                           mask;
-        std::vector<std::uint8_t>                           data;
+        payload                                             data;
     };
     
     /**
-     * @brief Wait operation. Pauses the testbench.
+     * @brief Wait operation. Keeps channel A idle for the given number of beats.
      */
     struct wait_op {
-        std::function<void ()>                              callback;
+        callback_type                                       callback;
         std::size_t                                         beats;
     };
     
-    using op = boost::variant<get_op, put_full_data_op, put_partial_data_op>;
+    // the order of the operations matches tlul_stats::opcode
+    using op = boost::variant<get_op, put_full_data_op, put_partial_data_op, wait_op>;
     
     /**
      * @brief Enqueues a Get operation. Please look at the get_op struct for the order and the
@@ -140,7 +246,7 @@ struct tlul_testbench: boost::static_visitor<bool> {
      */
     template <typename ...Args>
     void get(Args && ...args) {
-        op_queue.push(get_op{std::forward<Args>(args)...});
+        op_queue.emplace(get_op{std::forward<Args>(args)...});
     }
     
     /**
@@ -151,315 +257,673 @@ struct tlul_testbench: boost::static_visitor<bool> {
      */
     template <typename ...Args>
     void put_full_data(Args && ...args) {
-        op_queue.push(put_full_data_op{std::forward<Args>(args)...});
+        op_queue.emplace(put_full_data_op{std::forward<Args>(args)...});
     }
     
     /**
-     * @brief Enqueues a PutPartialData operation. Please look at the put_full_data_op struct for 
+     * @brief Enqueues a PutPartialData operation. Please look at the put_full_data_op struct for
      * theorder and the explanation of the parameters.
      * 
      * @param args Perfectly-forwarded to the constructor.
      */
     template <typename ...Args>
     void put_partial_data(Args && ...args) {
-        op_queue.push(put_partial_data_op{std::forward<Args>(args)...});
+        op_queue.emplace(put_partial_data_op{std::forward<Args>(args)...});
     }
     
     /**
-     * @brief Enqueues a wait_op. Waits for the specified number of beats.
+     * @brief Enqueues a wait_op. Waits for the specified number of beats, the callback of a wait
+     * of 0 beats is called as soon as the wait_op is reached.
      * 
      * @param args Perfectly-forwarded to the constructor.
      */
     template <typename ...Args>
     void wait(Args && ...args) {
-        op_queue.push(wait_op{std::forward<Args>(args)...});
+        op_queue.emplace(wait_op{std::forward<Args>(args)...});
+    }
+    
+    /**
+     * @brief Writes a block of memory, starting from the given address. The block is split into
+     * the largest naturally aligned beats (or bursts, see set_block_burst()), the unaligned head
+     * and tail are written with PutPartialData.
+     * 
+     * @param callback called once, after the whole block is acknowledged
+     * @param data not copied, must stay valid until the callback is called
+     */
+    template <typename Callback>
+    void write_block(Callback &&callback, address_type address, span<std::uint8_t const> data) {
+        if (data.empty()) {
+            callback_type{std::forward<Callback>(callback)}();
+            return ;
+        }
+        
+        auto id = open_block(std::forward<Callback>(callback));
+        
+        for (std::size_t done = 0; done < data.size(); ) {
+            std::size_t offset = address % bus_width;
+            std::size_t chunk = std::min(data.size() - done, bus_width - offset);
+            while (chunk >= bus_width && chunk * 2 <= std::min(data.size() - done, block_burst) &&
+                    address % (chunk * 2) == 0)
+                chunk *= 2;
+            auto part = data.subspan(done, chunk);
+            auto beat = [this, id] { close_beat(id); };
+            
+            if (chunk > bus_width) {
+                put_full_data(beat, address, size_type(log2(chunk)), lanes(0, bus_width), part);
+            }
+            else if (!(chunk & (chunk - 1)) && address % chunk == 0) {
+                put_full_data(beat, address, size_type(log2(chunk)), lanes(offset, chunk), part);
+            }
+            else {
+                put_partial_data(
+                    beat, address_type(address - offset), size_type(log2(bus_width)),
+                    lanes(offset, chunk), part);
+            }
+            
+            ++blocks[id].remaining;
+            done += chunk;
+            address += chunk;
+        }
+    }
+    
+    /**
+     * @brief Reads a block of memory into the given buffer, starting from the given address. The
+     * block is split into the largest naturally aligned Get operations (bursts too, see
+     * set_block_burst()).
+     * 
+     * @param callback called once, after the whole block is read
+     * @param data not copied, must stay valid until the callback is called
+     */
+    template <typename Callback>
+    void read_block(Callback &&callback, address_type address, span<std::uint8_t> data) {
+        if (data.empty()) {
+            callback_type{std::forward<Callback>(callback)}();
+            return ;
+        }
+        
+        auto id = open_block(std::forward<Callback>(callback));
+        
+        for (std::size_t done = 0; done < data.size(); ) {
+            std::size_t offset = address % bus_width;
+            std::size_t chunk = block_burst;
+            while (chunk > data.size() - done || address % chunk != 0)
+                chunk >>= 1;
+            
+            auto first = data.data() + done;
+            get([this, id, first](bytes v) {
+                    std::copy(v.begin(), v.end(), first);
+                    close_beat(id);
+                }, address, size_type(log2(chunk)),
+                lanes(offset, std::min(chunk, std::size_t(bus_width))));
+            
+            ++blocks[id].remaining;
+            done += chunk;
+            address += chunk;
+        }
+    }
+    
+    /**
+     * @brief Allows write_block() and read_block() to use bursts of up to the given number of
+     * bytes, for slaves which support them. bus_width (the default) gives single beats only.
+     * 
+     * @param bytes a power of 2, bus_width .. max_burst
+     */
+    void set_block_burst(std::size_t bytes) {
+        if (bytes < bus_width || bytes > max_burst || (bytes & (bytes - 1)))
+            throw std::invalid_argument("tlul_testbench: invalid burst size");
+        block_burst = bytes;
+    }
+    
+    /**
+     * @brief Makes room for n queued operations, so that enqueuing them does not allocate.
+     */
+    void reserve(std::size_t n) {
+        op_queue.reserve(n);
+    }
+    
+    /**
+     * @brief Limits the number of operations in flight.
+     * 
+     * @param n 1 .. max_outstanding. 1 issues the next operation only after the previous one is
+     * acknowledged.
+     */
+    void set_max_outstanding(std::size_t n) {
+        if (n == 0 || n > max_outstanding)
+            throw std::invalid_argument("tlul_testbench: invalid number of outstanding operations");
+        outstanding_limit = n;
+    }
+    
+    /**
+     * @brief Back-pressure on channel D: while something is in flight, d_ready is asserted on
+     * the cycles for which the predicate returns true (called once per cycle). Without a
+     * predicate, d_ready is asserted whenever something is in flight.
+     */
+    template <typename Predicate>
+    void set_d_ready(Predicate &&predicate) {
+        d_ready_predicate = std::forward<Predicate>(predicate);
+    }
+    
+    /**
+     * @returns number of operations put on channel A and not yet acknowledged.
+     */
+    std::size_t outstanding() const {
+        return max_outstanding - free_count;
+    }
+    
+    /**
+     * @returns true if there is no queued or in-flight operation.
+     */
+    bool idle() const {
+        return op_queue.empty() && outstanding() == 0 && wait_beats == 0;
+    }
+    
+    /**
+     * @returns statistics of the operations acknowledged so far.
+     */
+    tlul_stats const &stats() const {
+        return statistics;
+    }
+    
+    /**
+     * @brief Clears the statistics. Operations in flight are recorded when acknowledged.
+     */
+    void reset_stats() {
+        statistics.reset();
     }
     
     /**
      * @brief Wraps the eval of the managed HDL object.
      */
     void eval() {
-        if (op_queue.empty()) {
-            hdl->eval();
+        // only for the rising edge
+        if (hdl->CLK) {
+            // READs here
+            sample();
         }
-        else {
-            if (boost::apply_visitor(*this, op_queue.front()))
-                op_queue.pop();
+        
+        hdl->eval();
+        
+        if (hdl->CLK) {
+            // WRITEs here
+            drive();
         }
     }
     
+    /**
+     * @brief Registers the halves of eval() on a clock_driver, channels are sampled before and
+     * driven after the rising edge. Do not call eval() then. The testbench must not move
+     * afterwards.
+     */
+    template <typename Driver>
+    void attach(Driver &driver) {
+        driver.on(edge_hook::before_posedge, [this] { sample(); }, true);
+        driver.on(edge_hook::after_posedge, [this] { drive(); }, true);
+        driver.on_quiet([this] { return quiet(); }, [this](std::uint64_t n) { skip(n); });
+    }
+    
+    /**
+     * @returns quiescence::forever if there is nothing to do and channels A and D are released.
+     */
+    quiescence quiet() const {
+        if (idle() && !hdl->a_valid && !hdl->d_ready)
+            return {quiescence::forever};
+        return {};
+    }
+    
+    /**
+     * @brief Counts n quiet rising edges.
+     */
+    void skip(std::uint64_t n) {
+        cycle += n;
+        statistics.cycles += n;
+    }
 
 #define TLUL_TESTBENCH_ENSURE_OR_THROW(x) \
     if (!(x)) throw std::logic_error(std::string("Expected: ") + #x)
+
+private:
+    // opcodes for several messages
+    enum opcodes {
+        op_Get                = 4,
+        op_AccessAckData      = 1,
+        op_PutFullData        = 0,
+        op_PutPartialData     = 1,
+        op_AccessAck          = 0
+    };
     
     /**
-     * @brief executed when the current operation is a Get operation
-     * @returns true if next operation is to be handled
-     * @warning do not call by hand.
+     * @brief Puts an operation on channel A.
+     * @returns true if the operation occupies a source ID (i.e. expects a response).
+     */
+    struct issue_visitor: boost::static_visitor<bool> {
+        issue_visitor(tlul_testbench *tb, source_type source):
+            tb{tb},
+            source{source} {
+        }
+        
+        tlul_testbench *tb;
+        source_type source;
+        
+        bool operator()(get_op &op) const {
+            auto hdl = tb->hdl;
+            
+            /* check if, */
+            // non zero bits in mask matches size
+            std::bitset<mask_traits::size_in_bits> bs{op.mask};
+            std::size_t sz = std::size_t(1) << op.size;
+            if (sz > bus_width) {
+                tb->check_burst(op.address, sz, op.mask);
+            }
+            else {
+                TLUL_TESTBENCH_ENSURE_OR_THROW(bs.count() == sz);
+                TLUL_TESTBENCH_ENSURE_OR_THROW(check_correct_mask(bs));
+            }
+            // what is natural alignment? IDK, not very well defined
+            // TLUL_TESTBENCH_ENSURE_OR_THROW(
+            //     check_contiguous(std::bitset<mask_traits::size_in_bits>(op.mask)));
+            
+            /* start writing */
+            hdl->a_valid = 1;
+            hdl->a_opcode = op_Get;
+            hdl->a_param = 0;
+            hdl->a_size = op.size;
+            hdl->a_source = source;
+            hdl->a_address = op.address;
+            hdl->a_mask = op.mask;
+            
+            clear_packed(hdl->a_data);
+            
+            // the response is a burst
+            tb->a_beats = 1;
+            tb->issued_beats = std::max<std::size_t>(1, sz / bus_width);
+            tb->issued_bytes = sz;
+            
+            return true;
+        }
+        
+        bool operator()(put_full_data_op &op) const {
+            auto hdl = tb->hdl;
+            
+            std::bitset<mask_traits::size_in_bits> bs{op.mask};
+            std::size_t sz = std::size_t(1) << op.size;
+            TLUL_TESTBENCH_ENSURE_OR_THROW(op.data.size() == sz);
+            if (sz > bus_width) {
+                tb->check_burst(op.address, sz, op.mask);
+            }
+            else {
+                TLUL_TESTBENCH_ENSURE_OR_THROW(bs.count() == sz);
+                TLUL_TESTBENCH_ENSURE_OR_THROW(check_correct_mask(bs));
+            }
+            
+            hdl->a_valid = 1;
+            hdl->a_opcode = op_PutFullData;
+            hdl->a_param = 0;
+            hdl->a_size = op.size;
+            hdl->a_source = source;
+            hdl->a_address = op.address;
+            hdl->a_mask = op.mask;
+            
+            // the first beat of a burst, the rest follow once it is accepted
+            tb->a_beats = std::max<std::size_t>(1, sz / bus_width);
+            tb->issued_beats = 1;
+            tb->issued_bytes = sz;
+            tb->store_beat(op, 0);
+            
+            return true;
+        }
+        
+        bool operator()(put_partial_data_op &op) const {
+            auto hdl = tb->hdl;
+            
+            // the mask may be any non-empty subset of the lanes covered by the naturally
+            // aligned 2^size bytes at the address
+            std::bitset<mask_traits::size_in_bits> bs{op.mask};
+            std::size_t sz = 1u << op.size;
+            TLUL_TESTBENCH_ENSURE_OR_THROW(sz <= bus_width);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(op.address % sz == 0);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(bs.any());
+            TLUL_TESTBENCH_ENSURE_OR_THROW(
+                (op.mask & ~lanes(op.address % bus_width, sz)) == 0);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(op.data.size() == bs.count());
+            
+            hdl->a_valid = 1;
+            hdl->a_opcode = op_PutPartialData;
+            hdl->a_param = 0;
+            hdl->a_size = op.size;
+            hdl->a_source = source;
+            hdl->a_address = op.address;
+            hdl->a_mask = op.mask;
+            
+            tb->a_beats = 1;
+            tb->issued_beats = 1;
+            tb->issued_bytes = bs.count();
+            
+            // copy the payload, considering the MASK
+            {
+                std::array<std::uint8_t, bus_width> buf;
+                byte_lanes::expand<bus_width>(op.data.bytes.data(), op.mask, buf.data());
+                byte_lanes::store(hdl->a_data, buf.data());
+            }
+            
+            return true;
+        }
+        
+        bool operator()(wait_op &op) const {
+            // nothing to wait for, done right away
+            if (op.beats == 0) {
+                auto cb = std::move(op.callback);
+                if (cb)
+                    cb();
+                return false;
+            }
+            
+            tb->wait_beats = op.beats;
+            tb->wait_callback = std::move(op.callback);
+            return false;
+        }
+    };
+    
+    /**
+     * @brief Checks the response on channel D and calls the callback.
      */
-    bool operator()(get_op &op) {
-        bool next_state = false;
+    struct response_visitor: boost::static_visitor<void> {
+        response_visitor(tlul_testbench *tb):
+            tb{tb} {
+        }
         
-        // only for the rising edge
-        if (hdl->CLK) {
-            // READs here
-            switch (opstate) {
-                case opst_none: {
-                    next_state = true;
-                    break;
-                }
-                case opst_wrdy: {
-                    if (hdl->a_ready) {
-                        next_state = true;
-                    }
-                    break;
-                }
-                case opst_wack: {
-                    if (hdl->d_valid) {
-                        next_state = true;
-                        
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_opcode == op_AccessAckData);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_param == 0);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_size == op.size);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_source == 0);
-                        // no restriction on d_sink
-                        // we do not consider the error
-                        
-                        // we have a strong guarantee that hdl->d_data is POD
-                        // make this case better by using unpacked arrays in SV
-                        
-                        // here, the mask is GUARANTEED to be contiguous
-                        std::bitset<mask_traits::size_in_bits> bs(op.mask);
-                        typename mask_traits::element_type mask_mask = 1;
-                        
-                        // each set bit in the mask corresponds to a byte
-                        std::uintmax_t mask2 = 0xff; // select a byte
-                        
-                        std::vector<std::uint8_t> buf;
-                        buf.reserve(1 << op.size);
-                        
-                        for (std::size_t i = 0; i < mask_traits::size_in_bits; ++i) {
-                            if (op.mask & mask_mask) {
-                                // if the mask is selected
-                                // note: x << 3 is x * 8
-                                buf.emplace_back((hdl->d_data & mask2) >> (i << 3));
-                            }
-                            mask_mask <<= 1;
-                            mask2 <<= (1 << 3);
-                        }
-                        if (op.callback) {
-                            op.callback(buf);
-                        }
-                    }
-                    break;
+        tlul_testbench *tb;
+        
+        void operator()(get_op &op) const {
+            auto hdl = tb->hdl;
+            
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_opcode == op_AccessAckData);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_param == 0);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_size == op.size);
+            // no restriction on d_sink
+            // we do not consider the error
+            
+            // a burst was collected beat by beat, all lanes
+            std::size_t sz = std::size_t(1) << op.size;
+            if (sz > bus_width) {
+                if (op.callback) {
+                    op.callback(bytes{tb->d_burst.data(), sz});
                 }
+                return;
+            }
+            
+            // here, the mask is GUARANTEED to be contiguous
+            std::array<std::uint8_t, bus_width> lane_bytes;
+            std::array<std::uint8_t, bus_width> buf;
+            
+            // each set bit in the mask corresponds to a byte
+            byte_lanes::load(hdl->d_data, lane_bytes.data());
+            auto n = byte_lanes::compact<bus_width>(lane_bytes.data(), op.mask, buf.data());
+            if (op.callback) {
+                op.callback(bytes{buf.data(), n});
             }
         }
         
-        hdl->eval();
+        void operator()(put_full_data_op &op) const {
+            auto hdl = tb->hdl;
+            
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_opcode == op_AccessAck);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_param == 0);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_size == op.size);
+            // no restriction on d_sink
+            // no restriction on d_data
+            
+            // we do not consider the error case
+            
+            if (op.callback) {
+                op.callback();
+            }
+        }
         
-        if (hdl->CLK) {
-            // WRITEs here
-            switch (opstate) {
-                case opst_none: {
-                    if (next_state) {
-                        /* check if, */
-                        // non zero bits in mask matches size
-                        std::bitset<mask_traits::size_in_bits> bs{op.mask};
-                        std::size_t sz = 1u << op.size;
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(bs.count() == sz);
-                        
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(check_correct_mask(bs));
-                        // what is natural alignment? IDK, not very well defined
-                        // TLUL_TESTBENCH_ENSURE_OR_THROW(
-                        //     check_contiguous(std::bitset<mask_traits::size_in_bits>(op.mask)));
-                        
-                        /* start writing */
-                        hdl->a_valid = 1;
-                        hdl->a_opcode = op_Get;
-                        hdl->a_param = 0;
-                        hdl->a_size = op.size;
-                        hdl->a_source = 0;  // TODO temporarily
-                        hdl->a_address = op.address;
-                        hdl->a_mask = op.mask;
-                        
-                        // we have a strong guarantee that hdl->d_data is POD
-                        // make this case better by using unpacked arrays in SV
-                        // (not gonna repeat that anymore)
-                        hdl->a_data = 0;
-                        
-                        /* get into the next state */
-                        opstate = opst_wrdy;
-                    }
-                    break;
-                }
-                case opst_wrdy: {
-                    if (next_state) {
-                        hdl->a_valid = 0;
-                        /* the rest of channel A is not important (don't care) */
-                        
-                        /* now, we are ready too. we can listen foverilator_auxr an answer */
-                        hdl->d_ready = 1;
-                        
-                        /* get into the next state */
-                        opstate = opst_wack;
-                    }
-                    break;
-                }
-                case opst_wack: {
-                    if (next_state) {
-                        /* we are not ready yet */
-                        hdl->d_ready = 0;
-                        
-                        opstate = opst_none;
-                        
-                        // we can now move to the next operation
-                        return true;
-                    }
-                    break;
-                }
+        void operator()(put_partial_data_op &op) const {
+            auto hdl = tb->hdl;
+            
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_opcode == op_AccessAck);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_param == 0);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_size == op.size);
+            
+            if (op.callback) {
+                op.callback();
             }
         }
         
-        return false;
+        void operator()(wait_op &) const {
+            // never issued
+        }
+    };
+    
+    static constexpr std::size_t log2(std::size_t n) {
+        return n <= 1 ? 0 : 1 + log2(n >> 1);
     }
     
+    // a burst takes all lanes, at a naturally aligned address
+    void check_burst(address_type address, std::size_t sz, mask_type mask) const {
+        TLUL_TESTBENCH_ENSURE_OR_THROW(sz <= max_burst);
+        TLUL_TESTBENCH_ENSURE_OR_THROW(address % sz == 0);
+        TLUL_TESTBENCH_ENSURE_OR_THROW(mask == lanes(0, bus_width));
+    }
     
     /**
-     * @brief executed when the current operation is a Get operation
-     * @returns true if next operation is to be handled
-     * @warning do not call by hand.
+     * @brief Puts the given beat of a PutFullData on a_data.
      */
-    bool operator()(put_full_data_op &op) {
-        bool next_state = false;
+    void store_beat(put_full_data_op const &op, std::size_t beat) {
+        if (a_beats > 1) {
+            // all lanes
+            byte_lanes::store(hdl->a_data, op.data.bytes.data() + beat * bus_width);
+            return;
+        }
         
-        if (hdl->CLK) {
-            switch (opstate) {
-                case opst_none: {
-                    next_state = true;
-                    break;
-                }
-                case opst_wrdy: {
-                    if (hdl->a_ready) {
-                        next_state = true;
-                    }
-                    break;
-                }
-                case opst_wack: {
-                    if (hdl->d_valid) {
-                        next_state = true;
-                        
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_opcode == op_AccessAck);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_param == 0);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_size == op.size);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(hdl->d_source == 0);
-                        // no restriction on d_sink
-                        // no restriction on d_data
-                        
-                        // we do not consider the error case
-                        
-                        if (op.callback) {
-                            op.callback();
-                        }
-                    }
-                    break;
-                }
+        // copy the payload, considering the MASK
+        std::array<std::uint8_t, bus_width> buf;
+        byte_lanes::expand<bus_width>(op.data.bytes.data(), op.mask, buf.data());
+        byte_lanes::store(hdl->a_data, buf.data());
+    }
+    
+    /**
+     * @returns the mask which selects count lanes, starting from the given lane.
+     */
+    static constexpr mask_type lanes(std::size_t first, std::size_t count) {
+        return mask_type(
+            (count >= sizeof(std::uintmax_t) * CHAR_BIT ?
+                ~std::uintmax_t(0) : (std::uintmax_t(1) << count) - 1) << first);
+    }
+    
+    // for block operations
+    struct block_state {
+        callback_type callback;
+        std::size_t remaining;
+    };
+    
+    template <typename Callback>
+    std::size_t open_block(Callback &&callback) {
+        std::size_t id;
+        if (free_blocks.empty()) {
+            id = blocks.size();
+            blocks.emplace_back();
+        }
+        else {
+            id = free_blocks.back();
+            free_blocks.pop_back();
+        }
+        blocks[id].callback = std::forward<Callback>(callback);
+        blocks[id].remaining = 0;
+        return id;
+    }
+    
+    void close_beat(std::size_t id) {
+        if (--blocks[id].remaining == 0) {
+            auto cb = std::move(blocks[id].callback);
+            free_blocks.push_back(id);
+            if (cb) {
+                cb();
             }
         }
+    }
+    
+    /**
+     * @brief Samples channels A and D, before the rising edge is evaluated.
+     * @warning do not call by hand.
+     */
+    void sample() {
+        ++cycle;
+        ++statistics.cycles;
         
-        hdl->eval();
+        // channel A: the operation on the bus is accepted, or a beat of it
+        if (hdl->a_valid && hdl->a_ready) {
+            if (++a_beat < a_beats) {
+                a_next_beat = true;
+            }
+            else {
+                a_busy = false;
+                timings[hdl->a_source & (max_outstanding - 1)].accepted = cycle;
+            }
+        }
         
-        if (hdl->CLK) {
-            switch (opstate) {
-                case opst_none: {
-                    if (next_state) {
-                        std::bitset<mask_traits::size_in_bits> bs{op.mask};
-                        std::size_t sz = 1u << op.size;
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(op.data.size() == sz);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(bs.count() == sz);
-                        TLUL_TESTBENCH_ENSURE_OR_THROW(check_correct_mask(bs));
-                        
-                        hdl->a_valid = 1;
-                        hdl->a_opcode = op_PutFullData;
-                        hdl->a_param = 0;
-                        hdl->a_size = op.size;
-                        hdl->a_source = 0; // TODO temporarily
-                        hdl->a_address = op.address;
-                        hdl->a_mask = op.mask;
-                        
-                        // copy the payload, considering the MASK
-                        {
-                            auto it = op.data.begin();
-                            for (auto i = 0; i < mask_traits::size_in_bits; ++i) {
-                                if (get_bit(op.mask, i)) {
-                                    hdl->a_data = set_byte(hdl->a_data, i, *it);
-                                    ++it;
-                                }
-                            }
-                        }
-                        
-                        opstate = opst_wrdy;
-                    }
-                    break;
-                }
-                case opst_wrdy: {
-                    if (next_state) {
-                        hdl->a_valid = 0;
-                        hdl->d_ready = 1;
-                        
-                        opstate = opst_wack;
-                    }
-                    break;
-                }
-                case opst_wack: {
-                    if (next_state) {
-                        hdl->d_ready = 0;
-                        
-                        opstate = opst_none;
-                        
-                        return true;
-                    }
-                    break;
+        // channel D: a response is present, or a beat of it
+        bool response = false;
+        if (hdl->d_ready && hdl->d_valid) {
+            std::size_t source = hdl->d_source;
+            TLUL_TESTBENCH_ENSURE_OR_THROW(source < max_outstanding && in_flight[source]);
+            TLUL_TESTBENCH_ENSURE_OR_THROW(d_beat == 0 || source == d_burst_source);
+            
+            auto beats = timings[source].beats;
+            if (beats > 1) {
+                byte_lanes::load(hdl->d_data, d_burst.data() + d_beat * bus_width);
+                d_burst_source = source;
+                if (++d_beat == beats) {
+                    d_beat = 0;
+                    response = true;
                 }
             }
+            else {
+                response = true;
+            }
         }
         
-        return false;
+        if (response) {
+            std::size_t source = hdl->d_source;
+            
+            // release the source ID first, so that the callback may enqueue new operations
+            op current = std::move(ops[source]);
+            in_flight[source] = false;
+            free_sources[free_count++] = source;
+            
+            auto const &t = timings[source];
+            statistics.record(
+                tlul_stats::opcode(current.which()), t.bytes, t.issued, t.accepted, cycle);
+            
+            boost::apply_visitor(response_visitor{this}, current);
+        }
+        
+        if (wait_beats != 0) {
+            if (--wait_beats == 0 && wait_callback) {
+                auto cb = std::move(wait_callback);
+                wait_callback = nullptr;
+                cb();
+            }
+        }
     }
     
-    
     /**
-     * @brief executed when the current operation is a Get operation
-     * @returns true if next operation is to be handled
+     * @brief Drives channels A and D, after the rising edge is evaluated.
      * @warning do not call by hand.
      */
-    bool operator()(put_partial_data_op &op) {
-        return false;
+    void drive() {
+        if (a_busy) {
+            // the next beat of a burst PutFullData
+            if (a_next_beat) {
+                a_next_beat = false;
+                store_beat(boost::get<put_full_data_op>(ops[hdl->a_source]), a_beat);
+            }
+        }
+        else {
+            hdl->a_valid = 0;
+            /* the rest of channel A is not important (don't care) */
+            
+            while (wait_beats == 0 && !op_queue.empty() && outstanding() < outstanding_limit) {
+                source_type source = free_sources[free_count - 1];
+                
+                if (boost::apply_visitor(issue_visitor{this, source}, op_queue.front())) {
+                    --free_count;
+                    in_flight[source] = true;
+                    ops[source] = std::move(op_queue.front());
+                    timings[source].issued = cycle;
+                    timings[source].bytes = issued_bytes;
+                    timings[source].beats = issued_beats;
+                    a_beat = 0;
+                    op_queue.pop();
+                    a_busy = true;
+                    break;
+                }
+                
+                op_queue.pop();
+            }
+        }
+        
+        /* we can listen for an answer as long as something is in flight */
+        hdl->d_ready = outstanding() != 0 && (!d_ready_predicate || d_ready_predicate());
     }
 #undef TLUL_TESTBENCH_ENSURE_OR_THROW
-private:
-    // opcodes for several messages
-    enum opcodes {
-        op_Get                = 4,
-        op_AccessAckData      = 1,
-        op_PutFullData        = 0,
-        op_PutPartialData     = 1,
-        op_AccessAck          = 0
-    };
     
     HDLSlaveMemory *hdl;
     
-    // for operations in general
-    enum opstate_enum {
-        opst_none,
-        opst_wrdy,
-        opst_wack
-    } opstate {opst_none};
+    // channel A carries an operation which is not accepted yet
+    bool a_busy {false};
+    
+    // beats of the operation on channel A: accepted, in total, and whether the next one is due
+    std::size_t a_beat {0};
+    std::size_t a_beats {1};
+    bool a_next_beat {false};
+    
+    // set by issue_visitor: bytes of the operation, beats of its response
+    std::size_t issued_bytes {0};
+    std::size_t issued_beats {1};
+    
+    // the beats of a burst response received so far
+    std::array<std::uint8_t, max_burst> d_burst;
+    std::size_t d_beat {0};
+    std::size_t d_burst_source {0};
+    
+    // largest burst of write_block() and read_block()
+    std::size_t block_burst {bus_width};
+    
+    // operations in flight, indexed by their source IDs
+    std::array<op, max_outstanding> ops;
+    std::bitset<max_outstanding> in_flight;
+    
+    // for stats, indexed by source IDs
+    struct timing {
+        std::uint64_t issued;
+        std::uint64_t accepted;
+        std::size_t bytes;
+        std::size_t beats;      // of the response
+    };
+    
+    std::array<timing, max_outstanding> timings;
+    std::uint64_t cycle {0};
+    tlul_stats statistics;
+    
+    // free source IDs (a stack)
+    std::array<source_type, max_outstanding> free_sources;
+    std::size_t free_count {max_outstanding};
+    std::size_t outstanding_limit {max_outstanding};
+    
+    // for set_d_ready()
+    inplace_function<bool ()> d_ready_predicate;
     
     // for wait operation
-    std::size_t left_cycles {0};
+    std::size_t wait_beats {0};
+    callback_type wait_callback;
+    
+    ring_buffer<op> op_queue;
     
-    std::queue<op> op_queue;
+    // blocks in flight, a block is reused after its callback is called
+    std::vector<block_state> blocks;
+    std::vector<std::size_t> free_blocks;
 };
 
 }
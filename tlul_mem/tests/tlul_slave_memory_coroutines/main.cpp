@@ -0,0 +1,193 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Tests tlul_slave_memory with coroutine-based stimulus (coroutines.hpp). The
+ * simulation stops as soon as the sequences are done, no idle cycles are padded.
+ */
+
+
+#define BOOST_TEST_MODULE __FILE__
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+#include <verilator_aux.hpp>
+#include <hdl_tests_tlul_slave_memory_coroutines.h>
+
+#include "tlul_testbench.hpp"
+#include "coroutines.hpp"
+
+using hdl_type = hdl_tests_tlul_slave_memory_coroutines;
+using testbench = tlul_testbench<hdl_type>;
+using port = co::tlul_port<testbench>;
+
+// RAM_SIZE of tlul_slave_memory
+constexpr std::size_t memory_size = 256;
+
+std::size_t main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+// runs the simulation until the given sequence is done
+std::size_t run(hdl_type *top, testbench &tb, co::clock &clk, co::sequence const &s) {
+    std::size_t cycles = 0;
+    top->CLK = 1;
+    
+    while (!s.done()) {
+        ++main_time;
+        top->CLK = !top->CLK;
+        
+        if (top->CLK) {
+            clk.tick();
+            ++cycles;
+        }
+        
+        tb.eval();
+        
+        BOOST_REQUIRE(cycles < 100000);
+    }
+    
+    s.rethrow_if_failed();
+    return cycles;
+}
+
+co::sequence write_then_read(port &p, std::vector<std::uint8_t> &generated,
+        std::vector<std::uint8_t> &acquired) {
+    for (port::address_type address = 0; address < memory_size; address += 8) {
+        co_await p.put_full_data(address, 3, 0xff,
+            verilator_aux::span<std::uint8_t const>{generated.data() + address, 8});
+    }
+    
+    for (port::address_type address = 0; address < memory_size; address += 8) {
+        auto v = co_await p.get(address, 3, 0xff);
+        std::copy(v.begin(), v.end(), acquired.begin() + address);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_coroutines) {
+    auto top = std::make_unique<hdl_type>();
+    testbench tb{top.get()};
+    port p{tb};
+    co::clock clk;
+    
+    std::mt19937 mt{42};
+    std::uniform_int_distribution<int> dist{0, 0xFF};
+    
+    std::vector<std::uint8_t> generated(memory_size);
+    std::vector<std::uint8_t> acquired(memory_size);
+    for (auto &d: generated) {
+        d = dist(mt);
+    }
+    
+    auto s = write_then_read(p, generated, acquired);
+    auto cycles = run(top.get(), tb, clk, s);
+    
+    BOOST_TEST(acquired == generated);
+    
+    // one operation at a time, each one is issued on the cycle of the previous response
+    // (the first one on the first rising edge), so no cycle is wasted
+    BOOST_TEST(cycles == tb.stats().all().total.sum + 1);
+    
+    top->final();
+}
+
+co::sequence ticker(co::clock &clk, std::vector<std::uint64_t> &log, std::uint64_t period,
+        std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        co_await clk.cycles(period);
+        log.push_back(clk.cycle());
+    }
+}
+
+co::sequence parallel(port &p, co::clock &clk, std::vector<std::uint64_t> &log) {
+    // sequences run concurrently, the outer one resumes after both of them are done
+    auto a = ticker(clk, log, 3, 4);
+    auto b = ticker(clk, log, 5, 2);
+    co_await a;
+    co_await b;
+    
+    // whole blocks, with the unaligned head and tail
+    std::vector<std::uint8_t> data(77), back(77);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = 3 * i + 1;
+    }
+    co_await p.write_block(5, data);
+    co_await p.read_block(5, back);
+    
+    if (back != data) {
+        throw std::runtime_error("read_block returned other data");
+    }
+    
+    log.push_back(clk.cycle());
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_coroutines_clock) {
+    auto top = std::make_unique<hdl_type>();
+    testbench tb{top.get()};
+    port p{tb};
+    co::clock clk;
+    
+    std::vector<std::uint64_t> log;
+    auto s = parallel(p, clk, log);
+    auto cycles = run(top.get(), tb, clk, s);
+    
+    std::vector<std::uint64_t> expected{3, 5, 6, 9, 10, 12};
+    BOOST_REQUIRE(log.size() == expected.size() + 1);
+    BOOST_TEST(std::vector<std::uint64_t>(log.begin(), log.end() - 1) == expected);
+    BOOST_TEST(log.back() == cycles);
+    
+    top->final();
+}
+
+co::sequence waits(port &p, co::clock &clk, std::vector<std::uint64_t> &log) {
+    // a wait of no beats is done right away, channel A goes on
+    co_await p.wait(0);
+    log.push_back(clk.cycle());
+    co_await p.wait(4);
+    log.push_back(clk.cycle());
+    co_await p.wait(0);
+    auto v = co_await p.get(8, 3, 0xff);
+    log.push_back(v.size());
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_coroutines_wait) {
+    auto top = std::make_unique<hdl_type>();
+    testbench tb{top.get()};
+    port p{tb};
+    co::clock clk;
+    
+    std::vector<std::uint64_t> log;
+    auto s = waits(p, clk, log);
+    run(top.get(), tb, clk, s);
+    
+    BOOST_REQUIRE(log.size() == 3u);
+    BOOST_TEST(log[1] - log[0] >= 4u);
+    BOOST_TEST(log[2] == 8u);
+    BOOST_TEST(tb.idle());
+    
+    top->final();
+}
+
+co::sequence failing(port &p) {
+    co_await p.get(0, 3, 0xff);
+    throw std::runtime_error("expected");
+}
+
+BOOST_AUTO_TEST_CASE(tlul_slave_memory_coroutines_exception) {
+    auto top = std::make_unique<hdl_type>();
+    testbench tb{top.get()};
+    port p{tb};
+    co::clock clk;
+    
+    auto s = failing(p);
+    BOOST_CHECK_THROW(run(top.get(), tb, clk, s), std::runtime_error);
+    
+    top->final();
+}
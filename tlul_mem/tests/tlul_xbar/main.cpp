@@ -0,0 +1,254 @@
+/**
+ * @author Canberk Sönmez
+ * @file main.cpp
+ * @brief Tests of tlul_xbar, with tlul_slave_memory_pipelined behind it (xbar_memories.sv) and
+ * a tlul_testbench on each master.
+ * 
+ */
+
+
+#define BOOST_TEST_MODULE __FILE__
+
+#define FORCE_PRINT
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include <verilator_aux.hpp>
+#include <hdl_tests_tlul_xbar.h>
+#include <hdl_tests_tlul_xbar_3x1.h>
+
+#include "tlul_testbench.hpp"
+#include "tlul_traffic.hpp"
+#include "xbar_port.hpp"
+
+// RAM_SIZE of each memory, memory s is at s * memory_size
+constexpr std::size_t memory_size = 1024;
+
+std::size_t main_time = 0;
+
+double sc_time_stamp() {
+    return main_time;
+}
+
+// the initial block of tlul_slave_memory_pipelined, at a bus address
+std::uint8_t initial_byte(std::size_t address) {
+    return std::uint8_t(address % memory_size);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_xbar_routes) {
+    using masters = xbar_masters<hdl_tests_tlul_xbar>;
+    using testbench = masters::testbench;
+    
+    // 2 masters, 2 memories
+    masters soc{2};
+    
+    // every master writes 8 bytes into every memory, the other master reads them back
+    std::vector<std::vector<std::uint8_t>> written;
+    for (std::size_t m = 0; m < 2; ++m) {
+        for (std::size_t s = 0; s < 2; ++s) {
+            std::vector<std::uint8_t> data(8);
+            std::iota(data.begin(), data.end(), std::uint8_t(0x40 * m + 0x10 * s));
+            soc[m].put_full_data([] {  }, testbench::address_type(s * memory_size + 64 * m), 3,
+                0xff, testbench::bytes{data.data(), data.size()});
+            written.push_back(data);
+        }
+    }
+    BOOST_REQUIRE(soc.driver.run_until([&] { return soc.idle(); }, 1000));
+    
+    std::vector<std::vector<std::uint8_t>> read(4);
+    for (std::size_t m = 0; m < 2; ++m) {
+        for (std::size_t s = 0; s < 2; ++s) {
+            auto &out = read[2 * m + s];
+            soc[1 - m].get([&out](testbench::bytes v) { out.assign(v.begin(), v.end()); },
+                testbench::address_type(s * memory_size + 64 * m), 3, 0xff);
+        }
+    }
+    
+    // and the initial content of memory 1
+    std::vector<std::uint8_t> initial;
+    soc[0].get([&](testbench::bytes v) { initial.assign(v.begin(), v.end()); },
+        testbench::address_type(memory_size + 8), 3, 0xff);
+    BOOST_REQUIRE(soc.driver.run_until([&] { return soc.idle(); }, 1000));
+    
+    for (std::size_t i = 0; i < 4; ++i)
+        BOOST_TEST(read[i] == written[i]);
+    
+    std::vector<std::uint8_t> expected(8);
+    for (std::size_t i = 0; i < 8; ++i)
+        expected[i] = initial_byte(memory_size + 8 + i);
+    BOOST_TEST(initial == expected);
+    
+    soc.top->final();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_xbar_unmapped) {
+    using masters = xbar_masters<hdl_tests_tlul_xbar>;
+    using testbench = masters::testbench;
+    
+    masters soc{2};
+    
+    // past the last memory: never accepted, the other master goes on
+    bool unmapped = false;
+    bool mapped = false;
+    soc[0].get([&](testbench::bytes) { unmapped = true; },
+        testbench::address_type(2 * memory_size), 3, 0xff);
+    soc[1].get([&](testbench::bytes) { mapped = true; },
+        testbench::address_type(memory_size), 3, 0xff);
+    
+    soc.driver.run_until([&] { return false; }, 100);
+    BOOST_TEST(!unmapped);
+    BOOST_TEST(mapped);
+    
+    soc.top->final();
+}
+
+// cycles for n Gets from each master, master m to memory target(m)
+template <typename Target>
+std::uint64_t gets_cycles(std::size_t n, Target target) {
+    using masters = xbar_masters<hdl_tests_tlul_xbar>;
+    using testbench = masters::testbench;
+    
+    masters soc{2};
+    
+    std::size_t done = 0;
+    for (std::size_t m = 0; m < 2; ++m) {
+        for (std::size_t i = 0; i < n; ++i) {
+            soc[m].get([&](testbench::bytes) { ++done; },
+                testbench::address_type(target(m) * memory_size + 8 * (i % (memory_size / 8))),
+                3, 0xff);
+        }
+    }
+    
+    BOOST_REQUIRE(soc.driver.run_until([&] { return soc.idle(); }, 100 * n));
+    BOOST_TEST(done == 2 * n);
+    
+    soc.top->final();
+    return soc.driver.cycle();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_xbar_parallel) {
+    constexpr std::size_t n = 500;
+    
+    // to different memories in parallel, to the same one in turns
+    auto parallel = gets_cycles(n, [](std::size_t m) { return m; });
+    auto crossed = gets_cycles(n, [](std::size_t m) { return 1 - m; });
+    auto shared = gets_cycles(n, [](std::size_t) { return 0; });
+
+#ifdef FORCE_PRINT
+    std::cout << "cycles for " << n << " Gets per master, parallel: " << parallel
+        << " ; crossed: " << crossed << " ; shared: " << shared << "\n";
+#endif
+    
+    BOOST_TEST(parallel < n + 16);
+    BOOST_TEST(crossed < n + 16);
+    BOOST_TEST(shared >= 2 * n);
+    BOOST_TEST(shared < 2 * n + 16);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_xbar_round_robin) {
+    using masters = xbar_masters<hdl_tests_tlul_xbar_3x1>;
+    using testbench = masters::testbench;
+    
+    // 3 masters, 1 memory
+    masters soc{3};
+    
+    constexpr std::size_t n = 300;
+    std::vector<std::size_t> done(3);
+    for (std::size_t m = 0; m < 3; ++m) {
+        for (std::size_t i = 0; i < n; ++i)
+            soc[m].get([&done, m](testbench::bytes) { ++done[m]; },
+                testbench::address_type(8 * (i % (memory_size / 8))), 3, 0xff);
+    }
+    
+    // each master its turn, none is ahead of another by more than one operation
+    bool fair = true;
+    BOOST_REQUIRE(soc.driver.run_until([&] {
+            auto low = std::min({done[0], done[1], done[2]});
+            auto high = std::max({done[0], done[1], done[2]});
+            fair = fair && high - low <= 1;
+            return soc.idle();
+        }, 100 * n));
+    BOOST_TEST(fair);
+    BOOST_TEST(soc.driver.cycle() < 3 * n + 16);
+    
+    soc.top->final();
+}
+
+/**
+ * Random traffic with bursts from every master to every memory, master m on a window of its own
+ * in each (a tlul_traffic per window), every response checked. Channel D of every master is
+ * ready on a random half of the cycles, so grants are held and responses wait.
+ */
+template <typename HDL>
+void test_random_traffic(std::size_t n_masters, std::size_t n_memories, std::uint64_t seed,
+        std::uint64_t n_ops) {
+    using masters = xbar_masters<HDL>;
+    using traffic_type = verilator_aux::tlul_traffic<typename masters::testbench>;
+    
+    masters soc{n_masters};
+    
+    // the masters, rounded up to a power of 2
+    std::size_t slots = 1;
+    while (slots < n_masters)
+        slots *= 2;
+    std::size_t window = memory_size / slots;
+    
+    typename traffic_type::mix weights;
+    weights.get_burst = 1;
+    weights.put_burst = 1;
+    
+    std::mt19937_64 rng{seed};
+    std::vector<std::unique_ptr<traffic_type>> traffic;
+    for (std::size_t m = 0; m < n_masters; ++m) {
+        soc[m].set_d_ready([&rng] { return (rng() & 1) != 0; });
+        
+        for (std::size_t s = 0; s < n_memories; ++s) {
+            std::size_t base = s * memory_size + m * window;
+            std::vector<std::uint8_t> initial(window);
+            for (std::size_t i = 0; i < window; ++i)
+                initial[i] = initial_byte(base + i);
+            
+            traffic.push_back(std::make_unique<traffic_type>(
+                &soc[m], initial, seed + traffic.size(),
+                masters::testbench::max_outstanding / n_memories, weights,
+                typename traffic_type::address_type(base)));
+            traffic.back()->start(n_ops);
+        }
+    }
+    
+    BOOST_REQUIRE(soc.driver.run_until([&] {
+            for (auto const &t: traffic) {
+                if (!t->done())
+                    return false;
+            }
+            return true;
+        }, 100 * n_ops * n_memories));
+    
+    for (auto const &t: traffic) {
+        BOOST_TEST(t->mismatches() == 0u, t->first_mismatch());
+        BOOST_TEST(t->checked() > 0u);
+    }
+
+#ifdef FORCE_PRINT
+    std::cout << n_masters << " masters, " << n_memories << " memories ; seed: " << seed
+        << " ; cycles: " << soc.driver.cycle() << "\n";
+#endif
+    
+    soc.top->final();
+}
+
+BOOST_AUTO_TEST_CASE(tlul_xbar_random) {
+    test_random_traffic<hdl_tests_tlul_xbar>(2, 2, 51, 10000);
+}
+
+BOOST_AUTO_TEST_CASE(tlul_xbar_random_3x1) {
+    test_random_traffic<hdl_tests_tlul_xbar_3x1>(3, 1, 52, 10000);
+}
@@ -0,0 +1,209 @@
+/**
+ * @author Canberk Sönmez
+ * @file xbar_memories.sv
+ * @brief A small system: M masters, the ports of this module, and S tlul_slave_memory_pipelined
+ * behind a tlul_xbar. Memory s takes the RAM_SIZE bytes from s * RAM_SIZE on.
+ * 
+ * The port of master m is element m of each port array, with the names and widths of the ports
+ * of tlul_slave_memory, see xbar_port.hpp.
+ * 
+ * The memories are the pipelined ones, which take an operation per cycle. When two of them
+ * respond to the same master, one of them waits for d_ready; tlul_slave_memory would do as
+ * well (it keeps a_ready low while its response waits), one operation at a time.
+ */
+
+// xbar_memories module
+module xbar_memories
+    #(
+        // BEGIN Parameters
+        parameter
+        M = 2,              // masters
+        S = 2,              // memories
+        RAM_SIZE = 1024,    // bytes, of each memory
+        W = 8,
+        A = 32,
+        Z = 4,
+        O = 5,
+        I = 5
+        // END
+    )
+    (
+        // BEGIN Port Declarations
+        
+        // the clock signal
+        CLK,
+        
+        // the reset signal
+        RESET,
+        
+        // Channel A ports
+        a_opcode,
+        a_param,
+        a_size,
+        a_source,
+        a_address,
+        a_mask,
+        a_data,
+        a_valid,
+        a_ready,
+        
+        // Channel D ports
+        d_opcode,
+        d_param,
+        d_size,
+        d_source,
+        d_sink,
+        d_data,
+        d_error,
+        d_valid,
+        d_ready
+        
+        // END
+    );
+    
+    // BEGIN Port Definitions
+    
+    input CLK;
+    input RESET;
+    
+    // Channel A definitions (for SLAVE interfaces)
+    input [2:0]             a_opcode    [0:M-1];
+    input [2:0]             a_param     [0:M-1];
+    input [Z-1:0]           a_size      [0:M-1];
+    input [O-1:0]           a_source    [0:M-1];
+    input [A-1:0]           a_address   [0:M-1];
+    input [W-1:0]           a_mask      [0:M-1];
+    input [8*W-1:0]         a_data      [0:M-1];
+    input                   a_valid     [0:M-1];
+    output wire             a_ready     [0:M-1];
+    
+    // Channel D definitions (for SLAVE interfaces)
+    output wire [2:0]       d_opcode    [0:M-1];
+    output wire [1:0]       d_param     [0:M-1];
+    output wire [Z-1:0]     d_size      [0:M-1];
+    output wire [O-1:0]     d_source    [0:M-1];
+    output wire [I-1:0]     d_sink      [0:M-1];
+    output wire [8*W-1:0]   d_data      [0:M-1];
+    output wire             d_error     [0:M-1];
+    output wire             d_valid     [0:M-1];
+    input                   d_ready     [0:M-1];
+    
+    // END
+    
+    // a_source of the memories, {master, a_source}
+    localparam MB = M > 1 ? $clog2(M) : 1;
+    
+    // S fields of A bits, field k is first + k * step
+    function [S*A-1:0] fields(input integer first, input integer step);
+        integer k;
+        begin
+            fields = 0;
+            for (k = 0; k < S; k = k + 1)
+                fields[k*A +: A] = first + k * step;
+        end
+    endfunction
+    
+    // BEGIN the memory side of the crossbar
+    wire [2:0]              s_a_opcode  [0:S-1];
+    wire [2:0]              s_a_param   [0:S-1];
+    wire [Z-1:0]            s_a_size    [0:S-1];
+    wire [O+MB-1:0]         s_a_source  [0:S-1];
+    wire [A-1:0]            s_a_address [0:S-1];
+    wire [W-1:0]            s_a_mask    [0:S-1];
+    wire [8*W-1:0]          s_a_data    [0:S-1];
+    wire                    s_a_valid   [0:S-1];
+    wire                    s_a_ready   [0:S-1];
+    
+    wire [2:0]              s_d_opcode  [0:S-1];
+    wire [1:0]              s_d_param   [0:S-1];
+    wire [Z-1:0]            s_d_size    [0:S-1];
+    wire [O+MB-1:0]         s_d_source  [0:S-1];
+    wire [I-1:0]            s_d_sink    [0:S-1];
+    wire [8*W-1:0]          s_d_data    [0:S-1];
+    wire                    s_d_error   [0:S-1];
+    wire                    s_d_valid   [0:S-1];
+    wire                    s_d_ready   [0:S-1];
+    // END
+    
+    tlul_xbar
+        #(
+            .M(M), .S(S), .W(W), .A(A), .Z(Z), .O(O), .I(I),
+            .BASE(fields(0, RAM_SIZE)),
+            .SIZE(fields(RAM_SIZE, 0))
+        )
+        xbar(
+            .CLK(CLK),
+            
+            .m_a_opcode(a_opcode),
+            .m_a_param(a_param),
+            .m_a_size(a_size),
+            .m_a_source(a_source),
+            .m_a_address(a_address),
+            .m_a_mask(a_mask),
+            .m_a_data(a_data),
+            .m_a_valid(a_valid),
+            .m_a_ready(a_ready),
+            
+            .m_d_opcode(d_opcode),
+            .m_d_param(d_param),
+            .m_d_size(d_size),
+            .m_d_source(d_source),
+            .m_d_sink(d_sink),
+            .m_d_data(d_data),
+            .m_d_error(d_error),
+            .m_d_valid(d_valid),
+            .m_d_ready(d_ready),
+            
+            .s_a_opcode(s_a_opcode),
+            .s_a_param(s_a_param),
+            .s_a_size(s_a_size),
+            .s_a_source(s_a_source),
+            .s_a_address(s_a_address),
+            .s_a_mask(s_a_mask),
+            .s_a_data(s_a_data),
+            .s_a_valid(s_a_valid),
+            .s_a_ready(s_a_ready),
+            
+            .s_d_opcode(s_d_opcode),
+            .s_d_param(s_d_param),
+            .s_d_size(s_d_size),
+            .s_d_source(s_d_source),
+            .s_d_sink(s_d_sink),
+            .s_d_data(s_d_data),
+            .s_d_error(s_d_error),
+            .s_d_valid(s_d_valid),
+            .s_d_ready(s_d_ready));
+    
+    generate
+        genvar s;
+        
+        for (s = 0; s < S; s = s + 1) begin: memories
+            tlul_slave_memory_pipelined
+                #( .RAM_SIZE(RAM_SIZE), .W(W), .A(A), .Z(Z), .O(O + MB), .I(I) )
+                memory(
+                    .CLK(CLK),
+                    .RESET(RESET),
+                    
+                    .a_opcode(s_a_opcode[s]),
+                    .a_param(s_a_param[s]),
+                    .a_size(s_a_size[s]),
+                    .a_source(s_a_source[s]),
+                    .a_address(s_a_address[s]),
+                    .a_mask(s_a_mask[s]),
+                    .a_data(s_a_data[s]),
+                    .a_valid(s_a_valid[s]),
+                    .a_ready(s_a_ready[s]),
+                    
+                    .d_opcode(s_d_opcode[s]),
+                    .d_param(s_d_param[s]),
+                    .d_size(s_d_size[s]),
+                    .d_source(s_d_source[s]),
+                    .d_sink(s_d_sink[s]),
+                    .d_data(s_d_data[s]),
+                    .d_error(s_d_error[s]),
+                    .d_valid(s_d_valid[s]),
+                    .d_ready(s_d_ready[s]));
+        end
+    endgenerate
+
+endmodule
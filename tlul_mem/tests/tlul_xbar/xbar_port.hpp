@@ -0,0 +1,151 @@
+/**
+ * @author Canberk Sönmez
+ * @file xbar_port.hpp
+ * @brief The port of one master of a model with M masters (such as xbar_memories), for a
+ * tlul_testbench of its own.
+ * 
+ * The ports of the model are unpacked arrays, element m of each belongs to master m.
+ * tlul_testbench drives the fields of a single slave, so xbar_port has those fields and copies
+ * them from and to element m on every cycle:
+ * 
+ *     xbar_port<hdl> port{top.get(), m};
+ *     tlul_testbench<xbar_port<hdl>> tb{&port};
+ *     port.attach(driver, tb);
+ * 
+ * The outputs of the model are copied into the port before the testbench samples them, the
+ * inputs out of the port after it drives them, so the testbench sees the model as it would
+ * see a slave of its own. a_data and d_data are assigned whole, wide ones (W > 8) need the
+ * VlWide of newer Verilators.
+ * 
+ * xbar_masters puts together the model, a clock_driver and a port and a testbench per master.
+ */
+
+#ifndef XBAR_PORT_HPP_INCLUDED
+#define XBAR_PORT_HPP_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "clock_driver.hpp"
+#include "tlul_testbench.hpp"
+
+template <typename HDL>
+struct xbar_port {
+    // an element of a port array, C array or VlUnpacked
+    template <typename Array>
+    using element = std::remove_cv_t<std::remove_reference_t<
+        decltype(std::declval<Array &>()[0])>>;
+    
+    xbar_port(HDL *hdl, std::size_t index):
+        hdl{hdl},
+        index{index} {
+    }
+    
+    xbar_port(xbar_port const &) = delete;
+    xbar_port &operator=(xbar_port const &) = delete;
+    
+    /**
+     * @brief Registers the copies and the testbench on a clock_driver. Neither the port nor the
+     * testbench must move afterwards.
+     */
+    template <typename Driver, typename Testbench>
+    void attach(Driver &driver, Testbench &tb) {
+        driver.on(verilator_aux::edge_hook::before_posedge, [this] { sample(); });
+        tb.attach(driver);
+        driver.on(verilator_aux::edge_hook::after_posedge, [this] { drive(); });
+    }
+    
+    // outputs of the model
+    void sample() {
+        a_ready     = hdl->a_ready[index];
+        d_opcode    = hdl->d_opcode[index];
+        d_param     = hdl->d_param[index];
+        d_size      = hdl->d_size[index];
+        d_source    = hdl->d_source[index];
+        d_sink      = hdl->d_sink[index];
+        d_data      = hdl->d_data[index];
+        d_error     = hdl->d_error[index];
+        d_valid     = hdl->d_valid[index];
+    }
+    
+    // inputs of the model
+    void drive() const {
+        hdl->a_opcode[index]    = a_opcode;
+        hdl->a_param[index]     = a_param;
+        hdl->a_size[index]      = a_size;
+        hdl->a_source[index]    = a_source;
+        hdl->a_address[index]   = a_address;
+        hdl->a_mask[index]      = a_mask;
+        hdl->a_data[index]      = a_data;
+        hdl->a_valid[index]     = a_valid;
+        hdl->d_ready[index]     = d_ready;
+    }
+    
+    // Channel A
+    element<decltype(HDL::a_opcode)>    a_opcode {};
+    element<decltype(HDL::a_param)>     a_param {};
+    element<decltype(HDL::a_size)>      a_size {};
+    element<decltype(HDL::a_source)>    a_source {};
+    element<decltype(HDL::a_address)>   a_address {};
+    element<decltype(HDL::a_mask)>      a_mask {};
+    element<decltype(HDL::a_data)>      a_data {};
+    element<decltype(HDL::a_valid)>     a_valid {};
+    element<decltype(HDL::a_ready)>     a_ready {};
+    
+    // Channel D
+    element<decltype(HDL::d_opcode)>    d_opcode {};
+    element<decltype(HDL::d_param)>     d_param {};
+    element<decltype(HDL::d_size)>      d_size {};
+    element<decltype(HDL::d_source)>    d_source {};
+    element<decltype(HDL::d_sink)>      d_sink {};
+    element<decltype(HDL::d_data)>      d_data {};
+    element<decltype(HDL::d_error)>     d_error {};
+    element<decltype(HDL::d_valid)>     d_valid {};
+    element<decltype(HDL::d_ready)>     d_ready {};
+
+private:
+    HDL *hdl;
+    std::size_t index;
+};
+
+template <typename HDL>
+struct xbar_masters {
+    using port = xbar_port<HDL>;
+    using testbench = tlul_testbench<port>;
+    
+    explicit xbar_masters(std::size_t masters):
+        top{std::make_unique<HDL>()},
+        driver{top.get()} {
+        for (std::size_t m = 0; m < masters; ++m) {
+            ports.push_back(std::make_unique<port>(top.get(), m));
+            tbs.push_back(std::make_unique<testbench>(ports.back().get()));
+            ports.back()->attach(driver, *tbs.back());
+        }
+    }
+    
+    std::size_t size() const { return tbs.size(); }
+    
+    testbench &operator[](std::size_t m) { return *tbs[m]; }
+    
+    /**
+     * @returns true if the testbenches of all masters are idle.
+     */
+    bool idle() const {
+        for (auto const &tb: tbs) {
+            if (!tb->idle())
+                return false;
+        }
+        return true;
+    }
+    
+    std::unique_ptr<HDL> top;
+    verilator_aux::clock_driver<HDL> driver;
+private:
+    std::vector<std::unique_ptr<port>> ports;
+    std::vector<std::unique_ptr<testbench>> tbs;
+};
+
+#endif // XBAR_PORT_HPP_INCLUDED
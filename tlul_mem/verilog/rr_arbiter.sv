@@ -0,0 +1,49 @@
+/**
+ * @author Canberk Sönmez
+ * @file rr_arbiter.sv
+ * @brief Round-robin arbiter of N requesters.
+ * 
+ * GRANT is the first requester after the one granted last (at the last FIRE), in index order,
+ * and VALID tells whether it requests. While LOCK is high GRANT stays with the requester of the
+ * previous cycle, e.g. for a handshake which has started, or the beats of a burst.
+ */
+
+module rr_arbiter
+    #( parameter N = 2, NB = 1 )
+    ( CLK, REQ, LOCK, FIRE, GRANT, VALID );
+    
+    input CLK;
+    input [N-1:0] REQ;
+    input LOCK;
+    input FIRE;
+    output reg [NB-1:0] GRANT;
+    output wire VALID;
+    
+    // the grant of the previous cycle, and the last one which fired
+    reg [NB-1:0] owner = 0;
+    reg [NB-1:0] last = N - 1;
+    
+    integer k;
+    integer c;
+    
+    always @* begin
+        GRANT = owner;
+        if (!LOCK) begin
+            // downwards, so the nearest requester after last is assigned last
+            for (k = N; k >= 1; k = k - 1) begin
+                c = (last + k) % N;
+                if (REQ[c])
+                    GRANT = c[NB-1:0];
+            end
+        end
+    end
+    
+    assign VALID = REQ[GRANT];
+    
+    always @(posedge CLK) begin
+        owner <= GRANT;
+        if (FIRE)
+            last <= GRANT;
+    end
+
+endmodule
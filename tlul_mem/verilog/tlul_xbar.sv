@@ -0,0 +1,301 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_xbar.sv
+ * @brief TileLink-UL crossbar of M masters and S slaves.
+ * 
+ * Slave s takes the addresses in [BASE[s], BASE[s] + SIZE[s]) (fields of A bits, slave 0 in the
+ * lowest bits), the address goes to it unchanged. An operation to an address of no slave is
+ * never accepted, as in tlul_uart.
+ * 
+ * Channel A of every slave has a round-robin arbiter of the masters, channel D of every master
+ * one of the slaves, so operations of different masters to different slaves, and their
+ * responses, go through in the same cycle. The crossbar adds no cycles: the channels are routed
+ * combinationally and a_ready/d_ready are those of the other side.
+ * 
+ * The a_source of a slave is {master, a_source of the master}, O + MB bits; the upper MB bits of
+ * d_source select the master of a response, which gets back its own a_source.
+ * 
+ * A grant is held from valid to the handshake, and over all the beats of a PutFullData burst
+ * (channel A) or of an AccessAckData burst (channel D), so the beats of a message are never
+ * interleaved with another message.
+ */
+
+// tlul_xbar module
+module tlul_xbar
+    #(
+        // BEGIN Parameters
+        parameter
+        M = 2,          // masters
+        S = 2,          // slaves
+        W = 8,
+        A = 32,
+        Z = 4,
+        O = 5,          // a_source of the masters
+        I = 5,
+        // log2 of M, the upper bits of the a_source of a slave
+        MB = M > 1 ? $clog2(M) : 1,
+        SB = S > 1 ? $clog2(S) : 1,
+        
+        // the address ranges of the slaves, A bits each
+        parameter [S*A-1:0] BASE = 0,
+        parameter [S*A-1:0] SIZE = 0
+        // END
+    )
+    (
+        // BEGIN Port Declarations
+        
+        // the clock signal
+        CLK,
+        
+        // Channel A ports of the masters
+        m_a_opcode,
+        m_a_param,
+        m_a_size,
+        m_a_source,
+        m_a_address,
+        m_a_mask,
+        m_a_data,
+        m_a_valid,
+        m_a_ready,
+        
+        // Channel D ports of the masters
+        m_d_opcode,
+        m_d_param,
+        m_d_size,
+        m_d_source,
+        m_d_sink,
+        m_d_data,
+        m_d_error,
+        m_d_valid,
+        m_d_ready,
+        
+        // Channel A ports of the slaves
+        s_a_opcode,
+        s_a_param,
+        s_a_size,
+        s_a_source,
+        s_a_address,
+        s_a_mask,
+        s_a_data,
+        s_a_valid,
+        s_a_ready,
+        
+        // Channel D ports of the slaves
+        s_d_opcode,
+        s_d_param,
+        s_d_size,
+        s_d_source,
+        s_d_sink,
+        s_d_data,
+        s_d_error,
+        s_d_valid,
+        s_d_ready
+        
+        // END
+    );
+    
+    // BEGIN Port Definitions
+    
+    input CLK;
+    
+    // Channel A definitions (for SLAVE interfaces, towards the masters)
+    input [2:0]             m_a_opcode  [0:M-1];
+    input [2:0]             m_a_param   [0:M-1];
+    input [Z-1:0]           m_a_size    [0:M-1];
+    input [O-1:0]           m_a_source  [0:M-1];
+    input [A-1:0]           m_a_address [0:M-1];
+    input [W-1:0]           m_a_mask    [0:M-1];
+    input [8*W-1:0]         m_a_data    [0:M-1];
+    input                   m_a_valid   [0:M-1];
+    output wire             m_a_ready   [0:M-1];
+    
+    // Channel D definitions (for SLAVE interfaces, towards the masters)
+    output wire [2:0]       m_d_opcode  [0:M-1];
+    output wire [1:0]       m_d_param   [0:M-1];
+    output wire [Z-1:0]     m_d_size    [0:M-1];
+    output wire [O-1:0]     m_d_source  [0:M-1];
+    output wire [I-1:0]     m_d_sink    [0:M-1];
+    output wire [8*W-1:0]   m_d_data    [0:M-1];
+    output wire             m_d_error   [0:M-1];
+    output wire             m_d_valid   [0:M-1];
+    input                   m_d_ready   [0:M-1];
+    
+    // Channel A definitions (for MASTER interfaces, towards the slaves)
+    output wire [2:0]       s_a_opcode  [0:S-1];
+    output wire [2:0]       s_a_param   [0:S-1];
+    output wire [Z-1:0]     s_a_size    [0:S-1];
+    output wire [O+MB-1:0]  s_a_source  [0:S-1];
+    output wire [A-1:0]     s_a_address [0:S-1];
+    output wire [W-1:0]     s_a_mask    [0:S-1];
+    output wire [8*W-1:0]   s_a_data    [0:S-1];
+    output wire             s_a_valid   [0:S-1];
+    input                   s_a_ready   [0:S-1];
+    
+    // Channel D definitions (for MASTER interfaces, towards the slaves)
+    input [2:0]             s_d_opcode  [0:S-1];
+    input [1:0]             s_d_param   [0:S-1];
+    input [Z-1:0]           s_d_size    [0:S-1];
+    input [O+MB-1:0]        s_d_source  [0:S-1];
+    input [I-1:0]           s_d_sink    [0:S-1];
+    input [8*W-1:0]         s_d_data    [0:S-1];
+    input                   s_d_error   [0:S-1];
+    input                   s_d_valid   [0:S-1];
+    output wire             s_d_ready   [0:S-1];
+    
+    // END
+    
+    // BEGIN opcodes for TL-UL
+    parameter OP_Get                = 3'd4;
+    parameter OP_AccessAckData      = 3'd1;
+    // END
+    
+    localparam WORD_BITS = $clog2(W);
+    
+    // the beats of a burst after its first one, below 2^(2^Z - 1 - WORD_BITS)
+    localparam LEFT_BITS = (1 << Z) - 1 > WORD_BITS ? (1 << Z) - 1 - WORD_BITS : 1;
+    
+    // hit[m][s]: the address of master m is in the range of slave s
+    wire [S-1:0] hit [0:M-1];
+    
+    // the master granted channel A of each slave, the slave granted channel D of each master
+    wire [MB-1:0] a_grant [0:S-1];
+    wire [SB-1:0] d_grant [0:M-1];
+    
+    // handshakes on channel A of each slave, on channel D of each master
+    wire [S-1:0] a_fire;
+    wire [M-1:0] d_fire;
+    
+    generate
+        genvar m;
+        genvar s;
+        
+        // BEGIN address decoding
+        for (m = 0; m < M; m = m + 1) begin: decode
+            for (s = 0; s < S; s = s + 1) begin: ranges
+                assign hit[m][s] = m_a_address[m] - BASE[s*A +: A] < SIZE[s*A +: A];
+            end
+        end
+        // END
+        
+        // BEGIN channel A, an arbiter per slave
+        for (s = 0; s < S; s = s + 1) begin: a_channel
+            wire [M-1:0] req;
+            for (m = 0; m < M; m = m + 1) begin: requests
+                assign req[m] = m_a_valid[m] & hit[m][s];
+            end
+            
+            wire [MB-1:0] grant;
+            wire granted;
+            
+            // a_valid was high without a_ready at the last edge, the grant must stay
+            reg hold = 1'b0;
+            
+            // the beats of a PutFullData burst still to come
+            reg [LEFT_BITS-1:0] left = 0;
+            
+            rr_arbiter
+                #( .N(M), .NB(MB) )
+                arbiter(
+                    .CLK(CLK),
+                    .REQ(req),
+                    .LOCK(hold | (left != 0)),
+                    .FIRE(a_fire[s]),
+                    .GRANT(grant),
+                    .VALID(granted));
+            
+            assign a_grant[s] = grant;
+            assign a_fire[s] = granted & s_a_ready[s];
+            
+            assign s_a_opcode[s] = m_a_opcode[grant];
+            assign s_a_param[s] = m_a_param[grant];
+            assign s_a_size[s] = m_a_size[grant];
+            assign s_a_source[s] = {grant, m_a_source[grant]};
+            assign s_a_address[s] = m_a_address[grant];
+            assign s_a_mask[s] = m_a_mask[grant];
+            assign s_a_data[s] = m_a_data[grant];
+            assign s_a_valid[s] = granted;
+            
+            wire burst = m_a_opcode[grant] != OP_Get && m_a_size[grant] > WORD_BITS;
+            
+            always @(posedge CLK) begin
+                hold <= granted & ~s_a_ready[s];
+                if (a_fire[s]) begin
+                    if (left != 0)
+                        left <= left - 1;
+                    else if (burst)
+                        left <= (1 << (m_a_size[grant] - WORD_BITS)) - 1;
+                end
+            end
+        end
+        
+        // a_ready of a master is that of the slave which granted it
+        for (m = 0; m < M; m = m + 1) begin: a_accept
+            wire [S-1:0] taken;
+            for (s = 0; s < S; s = s + 1) begin: slaves
+                assign taken[s] = a_fire[s] & (a_grant[s] == m);
+            end
+            assign m_a_ready[m] = |taken;
+        end
+        // END
+        
+        // BEGIN channel D, an arbiter per master
+        for (m = 0; m < M; m = m + 1) begin: d_channel
+            wire [S-1:0] req;
+            for (s = 0; s < S; s = s + 1) begin: responses
+                assign req[s] = s_d_valid[s] & (s_d_source[s][O +: MB] == m);
+            end
+            
+            wire [SB-1:0] grant;
+            wire granted;
+            reg hold = 1'b0;
+            
+            // the beats of an AccessAckData burst still to come
+            reg [LEFT_BITS-1:0] left = 0;
+            
+            rr_arbiter
+                #( .N(S), .NB(SB) )
+                arbiter(
+                    .CLK(CLK),
+                    .REQ(req),
+                    .LOCK(hold | (left != 0)),
+                    .FIRE(d_fire[m]),
+                    .GRANT(grant),
+                    .VALID(granted));
+            
+            assign d_grant[m] = grant;
+            assign d_fire[m] = granted & m_d_ready[m];
+            
+            assign m_d_opcode[m] = s_d_opcode[grant];
+            assign m_d_param[m] = s_d_param[grant];
+            assign m_d_size[m] = s_d_size[grant];
+            assign m_d_source[m] = s_d_source[grant][O-1:0];
+            assign m_d_sink[m] = s_d_sink[grant];
+            assign m_d_data[m] = s_d_data[grant];
+            assign m_d_error[m] = s_d_error[grant];
+            assign m_d_valid[m] = granted;
+            
+            wire burst = s_d_opcode[grant] == OP_AccessAckData && s_d_size[grant] > WORD_BITS;
+            
+            always @(posedge CLK) begin
+                hold <= granted & ~m_d_ready[m];
+                if (d_fire[m]) begin
+                    if (left != 0)
+                        left <= left - 1;
+                    else if (burst)
+                        left <= (1 << (s_d_size[grant] - WORD_BITS)) - 1;
+                end
+            end
+        end
+        
+        // d_ready of a slave is that of the master which granted it
+        for (s = 0; s < S; s = s + 1) begin: d_accept
+            wire [M-1:0] taken;
+            for (m = 0; m < M; m = m + 1) begin: masters
+                assign taken[m] = d_fire[m] & (d_grant[m] == s);
+            end
+            assign s_d_ready[s] = |taken;
+        end
+        // END
+    endgenerate
+
+endmodule
@@ -0,0 +1,303 @@
+/**
+ * @author Canberk Sönmez
+ * @file byte_lanes.hpp
+ * @brief Byte lane compaction (gather) and expansion (scatter) by a TL-UL mask.
+ * 
+ * compact: the lanes selected by the mask are copied to the output, one after another.
+ * expand: the input bytes are copied to the lanes selected by the mask, one after another.
+ *         Unselected lanes are zeroed.
+ * 
+ * Lanes are processed 8 at a time, with BMI2 pext/pdep or SSSE3 pshufb (indexed by the mask)
+ * if the CPU supports them, and with a portable loop over the set bits otherwise. The choice is
+ * made at run time, so no special compiler flags are needed.
+ */
+
+#ifndef BYTE_LANES_HPP_INCLUDED
+#define BYTE_LANES_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "verilator_aux.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BYTE_LANES_X86
+#include <immintrin.h>
+#endif
+
+namespace verilator_aux {
+
+namespace byte_lanes {
+
+enum class isa {
+    portable,
+    ssse3,
+    bmi2
+};
+
+inline std::size_t popcount8(unsigned m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(m);
+#else
+    std::size_t n = 0;
+    for (; m; m &= m - 1)
+        ++n;
+    return n;
+#endif
+}
+
+inline unsigned ctz8(unsigned m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(m);
+#else
+    unsigned n = 0;
+    while (!(m & 1)) {
+        m >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// BEGIN 8-lane kernels
+// in and out always point to at least 8 readable/writable bytes.
+// compact8 may write garbage after the compacted bytes (inside those 8 bytes).
+
+inline std::size_t compact8_portable(std::uint8_t const *in, unsigned m, std::uint8_t *out) {
+    std::size_t n = 0;
+    for (; m; m &= m - 1)
+        out[n++] = in[ctz8(m)];
+    return n;
+}
+
+inline std::size_t expand8_portable(std::uint8_t const *in, unsigned m, std::uint8_t *out) {
+    std::memset(out, 0, 8);
+    std::size_t n = 0;
+    for (; m; m &= m - 1)
+        out[ctz8(m)] = in[n++];
+    return n;
+}
+
+#ifdef BYTE_LANES_X86
+
+struct shuffle_tables {
+    // compact[m]: indices of the set bits of m, then 0x80 (zero)
+    // expand[m]: for each lane, its rank among the set bits of m, or 0x80 if not selected
+    std::uint8_t compact[256][8];
+    std::uint8_t expand[256][8];
+};
+
+constexpr shuffle_tables make_shuffle_tables() {
+    shuffle_tables t {};
+    for (unsigned m = 0; m < 256; ++m) {
+        unsigned n = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            t.compact[m][i] = 0x80;
+            t.expand[m][i] = 0x80;
+        }
+        for (unsigned i = 0; i < 8; ++i) {
+            if (m & (1u << i)) {
+                t.compact[m][n] = i;
+                t.expand[m][i] = n;
+                ++n;
+            }
+        }
+    }
+    return t;
+}
+
+template <typename = void>
+struct tables {
+    static constexpr shuffle_tables value = make_shuffle_tables();
+};
+
+template <typename T>
+constexpr shuffle_tables tables<T>::value;
+
+__attribute__((target("ssse3")))
+inline std::size_t compact8_ssse3(std::uint8_t const *in, unsigned m, std::uint8_t *out) {
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(in));
+    __m128i s = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(tables<>::value.compact[m]));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_shuffle_epi8(v, s));
+    return popcount8(m);
+}
+
+__attribute__((target("ssse3")))
+inline std::size_t expand8_ssse3(std::uint8_t const *in, unsigned m, std::uint8_t *out) {
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(in));
+    __m128i s = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(tables<>::value.expand[m]));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_shuffle_epi8(v, s));
+    return popcount8(m);
+}
+
+__attribute__((target("bmi2")))
+inline std::uint64_t byte_mask8_bmi2(unsigned m) {
+    // 0b101 -> 0x0000'0000'00ff'00ff
+    return _pdep_u64(m, 0x0101'0101'0101'0101ull) * 0xff;
+}
+
+__attribute__((target("bmi2,popcnt")))
+inline std::size_t compact8_bmi2(std::uint8_t const *in, unsigned m, std::uint8_t *out) {
+    std::uint64_t v;
+    std::memcpy(&v, in, 8);
+    v = _pext_u64(v, byte_mask8_bmi2(m));
+    std::memcpy(out, &v, 8);
+    return popcount8(m);
+}
+
+__attribute__((target("bmi2,popcnt")))
+inline std::size_t expand8_bmi2(std::uint8_t const *in, unsigned m, std::uint8_t *out) {
+    std::uint64_t v;
+    std::memcpy(&v, in, 8);
+    v = _pdep_u64(v, byte_mask8_bmi2(m));
+    std::memcpy(out, &v, 8);
+    return popcount8(m);
+}
+
+#endif // BYTE_LANES_X86
+
+// END
+
+/**
+ * @returns the best kernel supported by the CPU.
+ */
+inline isa detect() {
+#ifdef BYTE_LANES_X86
+    // pext/pdep are microcoded (slow) on AMD before Zen 3, prefer pshufb there
+    static isa const best = [] {
+        __builtin_cpu_init();
+        bool slow_pext = __builtin_cpu_is("amd") &&
+            !__builtin_cpu_supports("avx512f") && !__builtin_cpu_supports("vaes");
+        if (__builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt") && !slow_pext)
+            return isa::bmi2;
+        if (__builtin_cpu_supports("ssse3"))
+            return isa::ssse3;
+        return isa::portable;
+    }();
+    return best;
+#else
+    return isa::portable;
+#endif
+}
+
+/**
+ * @returns true if the given kernel can be used on this CPU.
+ */
+inline bool supported(isa i) {
+#ifdef BYTE_LANES_X86
+    switch (i) {
+        case isa::bmi2: return __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+        case isa::ssse3: return __builtin_cpu_supports("ssse3");
+        default: return true;
+    }
+#else
+    return i == isa::portable;
+#endif
+}
+
+template <std::size_t (*Kernel)(std::uint8_t const *, unsigned, std::uint8_t *), std::size_t W>
+inline std::size_t compact_with(std::uint8_t const *lanes, std::uint64_t mask, std::uint8_t *out) {
+    if (W < 8) {
+        std::uint8_t in8[8] = {0};
+        std::uint8_t out8[8];
+        std::memcpy(in8, lanes, W);
+        auto n = Kernel(in8, unsigned(mask & ((1u << (W < 8 ? W : 0)) - 1)), out8);
+        std::memcpy(out, out8, n);
+        return n;
+    }
+    
+    // chunk k writes 8 bytes at out + n, n <= 8*k, so it never passes out + W
+    std::size_t n = 0;
+    for (std::size_t k = 0; k < W; k += 8)
+        n += Kernel(lanes + k, unsigned(mask >> k) & 0xff, out + n);
+    return n;
+}
+
+template <std::size_t (*Kernel)(std::uint8_t const *, unsigned, std::uint8_t *), std::size_t W>
+inline std::size_t expand_with(std::uint8_t const *in, std::uint64_t mask, std::uint8_t *lanes) {
+    if (W < 8) {
+        std::uint8_t in8[8] = {0};
+        std::uint8_t out8[8];
+        std::memcpy(in8, in, W);
+        auto n = Kernel(in8, unsigned(mask & ((1u << (W < 8 ? W : 0)) - 1)), out8);
+        std::memcpy(lanes, out8, W);
+        return n;
+    }
+    
+    // chunk k reads 8 bytes at in + n, n <= 8*k, so it never passes in + W
+    std::size_t n = 0;
+    for (std::size_t k = 0; k < W; k += 8)
+        n += Kernel(in + n, unsigned(mask >> k) & 0xff, lanes + k);
+    return n;
+}
+
+/**
+ * @brief Copies the lanes selected by the mask to out, one after another.
+ * @param lanes W bytes
+ * @param out room for W bytes
+ * @returns number of selected lanes
+ */
+template <std::size_t W>
+std::size_t compact(std::uint8_t const *lanes, std::uint64_t mask, std::uint8_t *out,
+        isa i = detect()) {
+    static_assert(W <= 64, "byte_lanes: masks wider than 64 bits are not supported.");
+    switch (i) {
+#ifdef BYTE_LANES_X86
+        case isa::bmi2: return compact_with<compact8_bmi2, W>(lanes, mask, out);
+        case isa::ssse3: return compact_with<compact8_ssse3, W>(lanes, mask, out);
+#endif
+        default: return compact_with<compact8_portable, W>(lanes, mask, out);
+    }
+}
+
+/**
+ * @brief Copies the bytes of in to the lanes selected by the mask, zeroes the rest.
+ * @param in W readable bytes, the first popcount(mask) of them are used
+ * @param lanes W bytes
+ * @returns number of selected lanes
+ */
+template <std::size_t W>
+std::size_t expand(std::uint8_t const *in, std::uint64_t mask, std::uint8_t *lanes,
+        isa i = detect()) {
+    static_assert(W <= 64, "byte_lanes: masks wider than 64 bits are not supported.");
+    switch (i) {
+#ifdef BYTE_LANES_X86
+        case isa::bmi2: return expand_with<expand8_bmi2, W>(in, mask, lanes);
+        case isa::ssse3: return expand_with<expand8_ssse3, W>(in, mask, lanes);
+#endif
+        default: return expand_with<expand8_portable, W>(in, mask, lanes);
+    }
+}
+
+/**
+ * @brief Copies a packed value to a byte array, lane 0 first.
+ */
+template <typename T>
+void load(T const &t, std::uint8_t *out) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::memcpy(out, &t, packed_traits<T>::size);
+#else
+    for (std::size_t i = 0; i < packed_traits<T>::size; ++i)
+        out[i] = get_lane(t, i);
+#endif
+}
+
+/**
+ * @brief Copies a byte array to a packed value, lane 0 first.
+ */
+template <typename T>
+void store(T &t, std::uint8_t const *in) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::memcpy(&t, in, packed_traits<T>::size);
+#else
+    for (std::size_t i = 0; i < packed_traits<T>::size; ++i)
+        set_lane(t, i, in[i]);
+#endif
+}
+
+};
+
+};
+
+#endif // BYTE_LANES_HPP_INCLUDED
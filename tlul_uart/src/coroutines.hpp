@@ -0,0 +1,391 @@
+/**
+ * @author Canberk Sönmez
+ * @file coroutines.hpp
+ * @brief C++20 coroutine layer over tlul_testbench and uart::sender. Stimulus is written as a
+ * sequence which resumes exactly when its transaction completes, instead of main_time checks.
+ * 
+ *     co::sequence stimulus(co::tlul_port<TB> &tb, co::clock &clk) {
+ *         TB::payload data{1, 2, 3, 4};   // GCC 12 rejects braced lists inside co_await
+ *         co_await tb.put_full_data(0x10, 2, 0x0f, data);
+ *         auto v = co_await tb.get(0x10, 2, 0x0f);
+ *         co_await clk.cycles(100);
+ *     }
+ * 
+ *     auto s = stimulus(port, clk);        // runs until its first co_await
+ *     while (!s.done()) {
+ *         top->CLK = !top->CLK;
+ *         if (top->CLK) clk.tick();
+ *         tb.eval();
+ *     }
+ *     s.rethrow_if_failed();
+ * 
+ * Sequences are resumed from the callbacks of the testbenches (i.e. from their eval()), they
+ * may enqueue new operations right away. A sequence must outlive its pending co_await.
+ * 
+ * Needs C++20, the rest of the code base stays C++14 and does not include this file.
+ */
+
+#ifndef COROUTINES_HPP_INCLUDED
+#define COROUTINES_HPP_INCLUDED
+
+#if !defined(__cpp_impl_coroutine)
+#error "coroutines.hpp needs C++20 coroutines (e.g. -std=c++20)."
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "verilator_aux.hpp"
+
+namespace co {
+
+/**
+ * @brief An eagerly started coroutine without a result. Can be co_awaited by another sequence,
+ * which resumes after this one finishes.
+ */
+struct sequence {
+    struct promise_type {
+        sequence get_return_object() {
+            return sequence{handle::from_promise(*this)};
+        }
+        
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        
+        // stays suspended at the end, so that done() can be queried, resumes the awaiter
+        auto final_suspend() noexcept {
+            struct awaiter {
+                bool await_ready() noexcept { return false; }
+                
+                std::coroutine_handle<> await_suspend(handle h) noexcept {
+                    auto c = h.promise().continuation;
+                    return c ? c : std::noop_coroutine();
+                }
+                
+                void await_resume() noexcept {}
+            };
+            return awaiter{};
+        }
+        
+        void return_void() {}
+        
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+        
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+    };
+    
+    using handle = std::coroutine_handle<promise_type>;
+    
+    sequence(sequence const &) = delete;
+    sequence &operator=(sequence const &) = delete;
+    
+    sequence(sequence &&other) noexcept:
+        h{std::exchange(other.h, nullptr)} {
+    }
+    
+    sequence &operator=(sequence &&other) noexcept {
+        if (this != &other) {
+            if (h)
+                h.destroy();
+            h = std::exchange(other.h, nullptr);
+        }
+        return *this;
+    }
+    
+    ~sequence() {
+        if (h)
+            h.destroy();
+    }
+    
+    /**
+     * @returns true if the coroutine returned (or threw).
+     */
+    bool done() const {
+        return !h || h.done();
+    }
+    
+    /**
+     * @brief Rethrows the exception which escaped the coroutine, if any.
+     */
+    void rethrow_if_failed() const {
+        if (h && h.done() && h.promise().error)
+            std::rethrow_exception(h.promise().error);
+    }
+    
+    bool await_ready() const noexcept {
+        return done();
+    }
+    
+    void await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        h.promise().continuation = awaiter;
+    }
+    
+    void await_resume() const {
+        rethrow_if_failed();
+    }
+private:
+    explicit sequence(handle h):
+        h{h} {
+    }
+    
+    handle h;
+};
+
+/**
+ * @brief Counts rising edges and resumes the sequences waiting for a number of cycles.
+ */
+struct clock {
+    struct cycles_awaiter {
+        bool await_ready() const noexcept {
+            return wake <= clk->now;
+        }
+        
+        void await_suspend(std::coroutine_handle<> h) {
+            clk->waiters.push(waiter{wake, clk->order++, h});
+        }
+        
+        void await_resume() const noexcept {}
+        
+        clock *clk;
+        std::uint64_t wake;
+    };
+    
+    /**
+     * @brief co_await clk.cycles(n) resumes after n more calls of tick(), n = 0 does not suspend.
+     */
+    cycles_awaiter cycles(std::uint64_t n) {
+        return cycles_awaiter{this, now + n};
+    }
+    
+    /**
+     * @brief Call once per rising edge, before the testbenches are evaluated. Operations
+     * enqueued by the resumed sequences are then issued on the same edge.
+     */
+    void tick() {
+        ++now;
+        // in the order of co_await for equal wake-up cycles
+        while (!waiters.empty() && waiters.top().wake <= now) {
+            auto h = waiters.top().h;
+            waiters.pop();
+            h.resume();
+        }
+    }
+    
+    /**
+     * @returns number of tick() calls so far.
+     */
+    std::uint64_t cycle() const {
+        return now;
+    }
+    
+    bool idle() const {
+        return waiters.empty();
+    }
+private:
+    struct waiter {
+        std::uint64_t wake;
+        std::uint64_t order;
+        std::coroutine_handle<> h;
+        
+        bool operator>(waiter const &other) const {
+            return wake != other.wake ? wake > other.wake : order > other.order;
+        }
+    };
+    
+    std::uint64_t now {0};
+    std::uint64_t order {0};
+    std::priority_queue<waiter, std::vector<waiter>, std::greater<waiter>> waiters;
+};
+
+/**
+ * @brief co_await ev suspends until the next notify(), e.g. from a uart::receiver callback.
+ */
+struct event {
+    struct awaiter {
+        bool await_ready() const noexcept { return false; }
+        
+        void await_suspend(std::coroutine_handle<> h) {
+            ev->waiters.push_back(h);
+        }
+        
+        void await_resume() const noexcept {}
+        
+        event *ev;
+    };
+    
+    awaiter operator co_await() {
+        return awaiter{this};
+    }
+    
+    /**
+     * @brief Resumes all the sequences waiting for the event, in the order of co_await.
+     */
+    void notify() {
+        auto ready = std::move(waiters);
+        waiters.clear();
+        for (auto h: ready)
+            h.resume();
+    }
+private:
+    std::vector<std::coroutine_handle<>> waiters;
+};
+
+/**
+ * @brief Awaitable operations of a tlul_testbench. co_await get(...) returns the read bytes
+ * (a TB::payload), the others return nothing.
+ */
+template <typename TB>
+struct tlul_port {
+    using address_type = typename TB::address_type;
+    using size_type = typename TB::size_type;
+    using mask_type = typename TB::mask_type;
+    using payload = typename TB::payload;
+    
+    explicit tlul_port(TB &tb):
+        tb{&tb} {
+    }
+    
+    struct get_awaiter {
+        bool await_ready() const noexcept { return false; }
+        
+        void await_suspend(std::coroutine_handle<> h) {
+            tb->get([this, h](typename TB::bytes v) {
+                    result.assign(v.begin(), v.end());
+                    h.resume();
+                }, address, size, mask);
+        }
+        
+        payload await_resume() const {
+            return result;
+        }
+        
+        TB *tb;
+        address_type address;
+        size_type size;
+        mask_type mask;
+        payload result;
+    };
+    
+    template <typename Enqueue>
+    struct ack_awaiter {
+        bool await_ready() const noexcept { return false; }
+        
+        void await_suspend(std::coroutine_handle<> h) {
+            enqueue(tb, [h] { h.resume(); });
+        }
+        
+        void await_resume() const noexcept {}
+        
+        TB *tb;
+        Enqueue enqueue;
+    };
+    
+    get_awaiter get(address_type address, size_type size, mask_type mask) {
+        return get_awaiter{tb, address, size, mask, {}};
+    }
+    
+    auto put_full_data(address_type address, size_type size, mask_type mask, payload data) {
+        return make_ack_awaiter([=](TB *tb, auto &&resume) {
+            tb->put_full_data(std::move(resume), address, size, mask, data);
+        });
+    }
+    
+    auto put_partial_data(address_type address, size_type size, mask_type mask, payload data) {
+        return make_ack_awaiter([=](TB *tb, auto &&resume) {
+            tb->put_partial_data(std::move(resume), address, size, mask, data);
+        });
+    }
+    
+    /**
+     * @brief Block operations of tlul_testbench, data must stay valid until resumed.
+     */
+    auto write_block(address_type address, verilator_aux::span<std::uint8_t const> data) {
+        return make_ack_awaiter([=](TB *tb, auto &&resume) {
+            tb->write_block(std::move(resume), address, data);
+        });
+    }
+    
+    auto read_block(address_type address, verilator_aux::span<std::uint8_t> data) {
+        return make_ack_awaiter([=](TB *tb, auto &&resume) {
+            tb->read_block(std::move(resume), address, data);
+        });
+    }
+    
+    /**
+     * @brief Keeps channel A idle for the given number of beats.
+     */
+    auto wait(std::size_t beats) {
+        return make_ack_awaiter([=](TB *tb, auto &&resume) {
+            tb->wait(std::move(resume), beats);
+        });
+    }
+    
+    TB &testbench() const {
+        return *tb;
+    }
+private:
+    template <typename Enqueue>
+    ack_awaiter<Enqueue> make_ack_awaiter(Enqueue &&enqueue) {
+        return ack_awaiter<Enqueue>{tb, std::forward<Enqueue>(enqueue)};
+    }
+    
+    TB *tb;
+};
+
+/**
+ * @brief Awaitable writes of a uart::sender. co_await write(...) resumes after the stop bit of
+ * the last byte.
+ */
+template <typename Sender>
+struct uart_port {
+    explicit uart_port(Sender &sender):
+        sender{&sender} {
+    }
+    
+    struct write_awaiter {
+        bool await_ready() const noexcept {
+            return data.empty();
+        }
+        
+        void await_suspend(std::coroutine_handle<> h) {
+            // the whole chunk is queued, resumed after its last byte
+            if (!sender->write_bytes(data, [h] { h.resume(); }))
+                throw std::logic_error("co::uart_port: no room in the sender");
+        }
+        
+        void await_resume() const noexcept {}
+        
+        Sender *sender;
+        std::vector<std::uint8_t> data;
+    };
+    
+    write_awaiter write(std::vector<std::uint8_t> data) {
+        return write_awaiter{sender, std::move(data)};
+    }
+    
+    write_awaiter write(std::string const &str) {
+        return write(std::vector<std::uint8_t>(str.begin(), str.end()));
+    }
+    
+    write_awaiter write(std::uint8_t byte) {
+        return write(std::vector<std::uint8_t>{byte});
+    }
+private:
+    Sender *sender;
+};
+
+};
+
+#endif // COROUTINES_HPP_INCLUDED
@@ -0,0 +1,242 @@
+/**
+ * @author Canberk Sönmez
+ * @file pty_bridge.hpp
+ * @brief Connects a simulated UART to a pseudo-terminal, so that host tools (screen, minicom,
+ * a script on /dev/pts/N) can talk to the model. POSIX only.
+ * 
+ * An I/O thread owns the terminal: it reads what the host writes into one spsc_queue and writes
+ * what the model sends from another. The simulation thread only touches the queues:
+ *     pump(sender)     moves host bytes into the FIFO of a uart::sender (as many as fit),
+ *     put(byte)        is called from the callback of a uart::receiver.
+ * The simulation thread never blocks and makes no system call. If the model sends faster than
+ * the host reads, bytes which do not fit are dropped and counted; the host side is throttled
+ * instead, by not reading the terminal while the queue towards the model is full.
+ */
+
+#ifndef PTY_BRIDGE_HPP_INCLUDED
+#define PTY_BRIDGE_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "verilator_aux.hpp"
+#include "spsc_queue.hpp"
+
+namespace uart {
+
+struct pty_bridge {
+    static constexpr std::size_t default_capacity = 1 << 16;
+    
+    // how long the I/O thread sleeps at most, i.e. the latency of the bytes from the model
+    static constexpr int poll_interval_ms = 1;
+    
+    /**
+     * @brief Opens a pseudo-terminal in raw mode and starts the I/O thread.
+     * @param capacity of both queues in bytes, rounded up to a power of 2
+     */
+    explicit pty_bridge(std::size_t capacity = default_capacity):
+        inbound{capacity},
+        outbound{capacity} {
+        master = ::posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0)
+            fail("posix_openpt");
+        if (::grantpt(master) != 0 || ::unlockpt(master) != 0)
+            fail("grantpt/unlockpt");
+        name = ::ptsname(master);
+        
+        // kept open, so that the terminal stays up (and keeps its settings) between clients
+        slave = ::open(name.c_str(), O_RDWR | O_NOCTTY);
+        if (slave < 0)
+            fail("open " + name);
+        
+        termios t;
+        if (::tcgetattr(slave, &t) != 0)
+            fail("tcgetattr");
+        ::cfmakeraw(&t);
+        if (::tcsetattr(slave, TCSANOW, &t) != 0)
+            fail("tcsetattr");
+        
+        if (::fcntl(master, F_SETFL, ::fcntl(master, F_GETFL) | O_NONBLOCK) != 0)
+            fail("fcntl");
+        
+        io = std::thread{[this] { run(); }};
+    }
+    
+    pty_bridge(pty_bridge const &) = delete;
+    pty_bridge &operator=(pty_bridge const &) = delete;
+    
+    ~pty_bridge() {
+        stopping.store(true, std::memory_order_relaxed);
+        if (io.joinable())
+            io.join();
+        close();
+    }
+    
+    /**
+     * @returns the path of the terminal for the host tools, e.g. /dev/pts/3.
+     */
+    std::string const &path() const {
+        return name;
+    }
+    
+    // BEGIN simulation thread
+    
+    /**
+     * @brief Moves the bytes written by the host into the FIFO of the sender, as many as fit.
+     * @returns number of bytes moved.
+     */
+    template <typename Sender>
+    std::size_t pump(Sender &sender) {
+        std::array<std::uint8_t, 256> buffer;
+        std::size_t total = 0;
+        
+        while (sender.space() > 0) {
+            auto n = inbound.pop({buffer.data(), std::min(buffer.size(), sender.space())});
+            if (n == 0)
+                break;
+            sender.write({buffer.data(), n});
+            total += n;
+        }
+        return total;
+    }
+    
+    /**
+     * @brief Queues a byte sent by the model, for the host. Dropped if the queue is full.
+     */
+    void put(std::uint8_t byte) {
+        if (!outbound.try_push(byte))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // END
+    
+    std::uint64_t bytes_to_model() const { return to_model.load(std::memory_order_relaxed); }
+    std::uint64_t bytes_to_host() const { return to_host.load(std::memory_order_relaxed); }
+    std::uint64_t bytes_dropped() const { return dropped.load(std::memory_order_relaxed); }
+    
+    /**
+     * @returns host time from the first to the last byte through the terminal, either way.
+     */
+    double seconds() const {
+        auto first = first_transfer.load(std::memory_order_relaxed);
+        auto last = last_transfer.load(std::memory_order_relaxed);
+        if (first < 0)
+            return 0;
+        return std::chrono::duration<double>(clock::duration{last - first}).count();
+    }
+    
+    void report(std::ostream &os) const {
+        double s = seconds();
+        os << "terminal:              " << name << "\n";
+        os << "bytes to model:        " << bytes_to_model() << "\n";
+        os << "bytes to host:         " << bytes_to_host() << "\n";
+        os << "bytes dropped:         " << bytes_dropped() << "\n";
+        os << "active time [s]:       " << s << "\n";
+        os << "to model [bytes/s]:    " << (s > 0 ? bytes_to_model() / s : 0) << "\n";
+        os << "to host [bytes/s]:     " << (s > 0 ? bytes_to_host() / s : 0) << "\n";
+    }
+private:
+    using clock = std::chrono::steady_clock;
+    
+    [[noreturn]] void fail(std::string const &what) {
+        std::string message = "uart::pty_bridge: " + what + ": " + std::strerror(errno);
+        close();
+        throw std::runtime_error(message);
+    }
+    
+    void close() {
+        if (slave >= 0)
+            ::close(slave);
+        if (master >= 0)
+            ::close(master);
+        slave = master = -1;
+    }
+    
+    void transferred(std::atomic<std::uint64_t> &counter, std::size_t n) {
+        auto now = clock::now().time_since_epoch().count();
+        if (first_transfer.load(std::memory_order_relaxed) < 0)
+            first_transfer.store(now, std::memory_order_relaxed);
+        last_transfer.store(now, std::memory_order_relaxed);
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+    
+    // the I/O thread
+    void run() {
+        std::array<std::uint8_t, 4096> in;
+        std::array<std::uint8_t, 4096> out;
+        std::size_t out_begin = 0;
+        std::size_t out_end = 0;
+        
+        while (!stopping.load(std::memory_order_relaxed)) {
+            if (out_begin == out_end) {
+                out_begin = 0;
+                out_end = outbound.pop({out.data(), out.size()});
+            }
+            std::size_t room = inbound.capacity() - inbound.size();
+            
+            pollfd p {master, 0, 0};
+            if (room > 0)
+                p.events |= POLLIN;
+            if (out_begin != out_end)
+                p.events |= POLLOUT;
+            
+            if (::poll(&p, 1, poll_interval_ms) < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            
+            if (p.revents & POLLIN) {
+                auto n = ::read(master, in.data(), std::min(in.size(), room));
+                if (n > 0) {
+                    inbound.push({in.data(), std::size_t(n)});
+                    transferred(to_model, std::size_t(n));
+                }
+            }
+            
+            if (p.revents & POLLOUT) {
+                auto n = ::write(master, out.data() + out_begin, out_end - out_begin);
+                if (n > 0) {
+                    out_begin += std::size_t(n);
+                    transferred(to_host, std::size_t(n));
+                }
+            }
+        }
+    }
+    
+    int master {-1};
+    int slave {-1};
+    std::string name;
+    
+    // host -> model, model -> host
+    verilator_aux::spsc_queue<std::uint8_t> inbound;
+    verilator_aux::spsc_queue<std::uint8_t> outbound;
+    
+    std::atomic<bool> stopping {false};
+    std::atomic<std::uint64_t> to_model {0};
+    std::atomic<std::uint64_t> to_host {0};
+    std::atomic<std::uint64_t> dropped {0};
+    std::atomic<clock::rep> first_transfer {-1};
+    std::atomic<clock::rep> last_transfer {-1};
+    
+    std::thread io;
+};
+
+}
+
+#endif // PTY_BRIDGE_HPP_INCLUDED
@@ -0,0 +1,113 @@
+/**
+ * @author Canberk Sönmez
+ * @file spsc_queue.hpp
+ * @brief A lock-free FIFO of trivially copyable elements, between exactly one producer thread
+ * and one consumer thread. The storage is allocated once, the capacity is a power of 2.
+ * 
+ * Neither side ever blocks or makes a system call: push() takes what fits, pop() what is there.
+ * Each index is written by one side only; the other side reads it with acquire semantics and
+ * keeps a cached copy, so the shared cache lines are touched only when the cached view runs out.
+ */
+
+#ifndef SPSC_QUEUE_HPP_INCLUDED
+#define SPSC_QUEUE_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <algorithm>
+
+#include "verilator_aux.hpp"
+
+namespace verilator_aux {
+
+template <typename T>
+struct spsc_queue {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "spsc_queue: T must be trivially copyable");
+    
+    /**
+     * @param capacity rounded up to a power of 2
+     */
+    explicit spsc_queue(std::size_t capacity) {
+        std::size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        storage.reset(new T[cap]);
+        mask = cap - 1;
+    }
+    
+    spsc_queue(spsc_queue const &) = delete;
+    spsc_queue &operator=(spsc_queue const &) = delete;
+    
+    std::size_t capacity() const { return mask + 1; }
+    
+    /**
+     * @brief Producer side. Copies as many elements as fit.
+     * @returns number of elements pushed.
+     */
+    std::size_t push(span<T const> data) {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (capacity() - (t - head_cache) < data.size())
+            head_cache = head.load(std::memory_order_acquire);
+        
+        std::size_t n = std::min(data.size(), capacity() - (t - head_cache));
+        for (std::size_t i = 0; i < n; ++i)
+            storage[(t + i) & mask] = data[i];
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+    
+    bool try_push(T const &t) {
+        return push(span<T const>{&t, 1}) == 1;
+    }
+    
+    /**
+     * @brief Consumer side. Copies out as many elements as there are, up to out.size().
+     * @returns number of elements popped.
+     */
+    std::size_t pop(span<T> out) {
+        auto h = head.load(std::memory_order_relaxed);
+        if (tail_cache - h < out.size())
+            tail_cache = tail.load(std::memory_order_acquire);
+        
+        std::size_t n = std::min(out.size(), tail_cache - h);
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = storage[(h + i) & mask];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+    
+    bool try_pop(T &t) {
+        return pop(span<T>{&t, 1}) == 1;
+    }
+    
+    /**
+     * @returns a snapshot of the number of elements, from either side.
+     */
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    
+    bool empty() const {
+        return size() == 0;
+    }
+private:
+    static constexpr std::size_t cache_line = 64;
+    
+    std::unique_ptr<T[]> storage;
+    std::size_t mask {0};
+    
+    // written by the consumer
+    alignas(cache_line) std::atomic<std::size_t> head {0};
+    std::size_t tail_cache {0};
+    
+    // written by the producer
+    alignas(cache_line) std::atomic<std::size_t> tail {0};
+    std::size_t head_cache {0};
+};
+
+};
+
+#endif // SPSC_QUEUE_HPP_INCLUDED
@@ -0,0 +1,214 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_stats.hpp
+ * @brief Cycle counters and latency histograms of TL-UL operations, collected by tlul_testbench.
+ * 
+ * Every acknowledged operation records three latencies, in clock cycles:
+ *     wait_ready: from putting it on channel A until a_ready (a_valid is held that long),
+ *     wait_ack:   from a_ready until its response on channel D,
+ *     total:      the sum of the two.
+ * 
+ * Histogram bucket 0 counts 0 cycles, bucket k (k >= 1) counts [2^(k-1), 2^k) cycles and the
+ * last bucket counts everything above. Nothing allocates, so collection is always on.
+ */
+
+#ifndef TLUL_STATS_HPP_INCLUDED
+#define TLUL_STATS_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <ostream>
+
+namespace verilator_aux {
+
+struct latency_histogram {
+    static constexpr std::size_t bucket_count = 16;
+    
+    void add(std::uint64_t cycles) {
+        ++count;
+        sum += cycles;
+        min = std::min(min, cycles);
+        max = std::max(max, cycles);
+        ++buckets[bucket_of(cycles)];
+    }
+    
+    void merge(latency_histogram const &other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        for (std::size_t i = 0; i < bucket_count; ++i)
+            buckets[i] += other.buckets[i];
+    }
+    
+    double mean() const {
+        return count ? double(sum) / count : 0;
+    }
+    
+    /**
+     * @returns the smallest latency which falls into bucket i.
+     */
+    static std::uint64_t bucket_floor(std::size_t i) {
+        return i == 0 ? 0 : std::uint64_t(1) << (i - 1);
+    }
+    
+    static std::size_t bucket_of(std::uint64_t cycles) {
+        std::size_t i = 0;
+        while (cycles) {
+            cycles >>= 1;
+            ++i;
+        }
+        return std::min(i, bucket_count - 1);
+    }
+    
+    std::uint64_t count {0};
+    std::uint64_t sum {0};
+    std::uint64_t min {std::numeric_limits<std::uint64_t>::max()};
+    std::uint64_t max {0};
+    std::array<std::uint64_t, bucket_count> buckets {};
+};
+
+struct tlul_stats {
+    // in the order of the operations of tlul_testbench::op
+    enum opcode {
+        Get,
+        PutFullData,
+        PutPartialData,
+        opcode_count
+    };
+    
+    static char const *name(opcode o) {
+        static char const *const names[] = {"Get", "PutFullData", "PutPartialData"};
+        return names[o];
+    }
+    
+    struct op_stats {
+        void merge(op_stats const &other) {
+            count += other.count;
+            bytes += other.bytes;
+            wait_ready.merge(other.wait_ready);
+            wait_ack.merge(other.wait_ack);
+            total.merge(other.total);
+        }
+        
+        std::uint64_t count {0};
+        std::uint64_t bytes {0};
+        latency_histogram wait_ready;
+        latency_histogram wait_ack;
+        latency_histogram total;
+    };
+    
+    /**
+     * @brief Records an acknowledged operation. Cycle numbers are absolute.
+     */
+    void record(opcode o, std::size_t n_bytes, std::uint64_t issued, std::uint64_t accepted,
+            std::uint64_t acknowledged) {
+        auto &s = ops[o];
+        ++s.count;
+        s.bytes += n_bytes;
+        s.wait_ready.add(accepted - issued);
+        s.wait_ack.add(acknowledged - accepted);
+        s.total.add(acknowledged - issued);
+    }
+    
+    /**
+     * @returns statistics of all the opcodes together.
+     */
+    op_stats all() const {
+        op_stats s;
+        for (auto const &o: ops)
+            s.merge(o);
+        return s;
+    }
+    
+    /**
+     * @returns bytes transferred (selected by a_mask) per clock cycle.
+     */
+    double bytes_per_cycle() const {
+        return cycles ? double(all().bytes) / cycles : 0;
+    }
+    
+    /**
+     * @brief One row per opcode and latency, then the "all" rows.
+     */
+    void write_csv(std::ostream &os) const {
+        os << "opcode,latency,count,bytes,cycles,bytes_per_cycle,min,mean,max";
+        for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+            os << ",ge" << latency_histogram::bucket_floor(i);
+        os << "\n";
+        
+        for (std::size_t o = 0; o < opcode_count; ++o)
+            write_csv_rows(os, name(opcode(o)), ops[o]);
+        write_csv_rows(os, "all", all());
+    }
+    
+    void write_json(std::ostream &os) const {
+        os << "{\n";
+        os << "  \"cycles\": " << cycles << ",\n";
+        os << "  \"bytes_per_cycle\": " << bytes_per_cycle() << ",\n";
+        os << "  \"histogram_floors\": [";
+        for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+            os << (i ? ", " : "") << latency_histogram::bucket_floor(i);
+        os << "],\n";
+        os << "  \"ops\": {\n";
+        for (std::size_t o = 0; o < opcode_count; ++o) {
+            write_json_op(os, name(opcode(o)), ops[o]);
+            os << ",\n";
+        }
+        write_json_op(os, "all", all());
+        os << "\n  }\n";
+        os << "}\n";
+    }
+    
+    void reset() {
+        *this = tlul_stats{};
+    }
+    
+    // clock cycles (rising edges) seen by the testbench
+    std::uint64_t cycles {0};
+    
+    std::array<op_stats, opcode_count> ops;
+private:
+    void write_csv_rows(std::ostream &os, char const *opcode_name, op_stats const &s) const {
+        auto row = [&](char const *latency, latency_histogram const &h) {
+            os << opcode_name << "," << latency << "," << s.count << "," << s.bytes << ","
+                << cycles << "," << (cycles ? double(s.bytes) / cycles : 0) << ","
+                << (h.count ? h.min : 0) << "," << h.mean() << "," << h.max;
+            for (auto b: h.buckets)
+                os << "," << b;
+            os << "\n";
+        };
+        row("wait_ready", s.wait_ready);
+        row("wait_ack", s.wait_ack);
+        row("total", s.total);
+    }
+    
+    static void write_json_histogram(
+            std::ostream &os, char const *latency, latency_histogram const &h) {
+        os << "      \"" << latency << "\": {\"min\": " << (h.count ? h.min : 0)
+            << ", \"mean\": " << h.mean() << ", \"max\": " << h.max << ", \"histogram\": [";
+        for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+            os << (i ? ", " : "") << h.buckets[i];
+        os << "]}";
+    }
+    
+    void write_json_op(std::ostream &os, char const *opcode_name, op_stats const &s) const {
+        os << "    \"" << opcode_name << "\": {\n";
+        os << "      \"count\": " << s.count << ",\n";
+        os << "      \"bytes\": " << s.bytes << ",\n";
+        os << "      \"bytes_per_cycle\": " << (cycles ? double(s.bytes) / cycles : 0) << ",\n";
+        write_json_histogram(os, "wait_ready", s.wait_ready);
+        os << ",\n";
+        write_json_histogram(os, "wait_ack", s.wait_ack);
+        os << ",\n";
+        write_json_histogram(os, "total", s.total);
+        os << "\n    }";
+    }
+};
+
+};
+
+#endif // TLUL_STATS_HPP_INCLUDED
@@ -0,0 +1,168 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_baud_sweep.cpp
+ * @brief Sweeps the baud rate of a single tlul_uart model: for each divisor, it is written to
+ * the divisor register over TL-UL and read back, the sender and the receiver follow it, and
+ * bytes are sent both ways (8-byte Puts out of tx, 8-byte Gets of what comes in on rx).
+ * Reports the simulated cycles per byte and the simulation speed at every rate.
+ * 
+ * Fails on any difference, or if a byte takes less than 10 bit times (the divisor was not
+ * taken).
+ * 
+ * usage: tlul_uart_baud_sweep [bytes per divisor] [divisor...]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <hdl_tlul_uart.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::uint32_t uart_address = 127;
+
+// as in tlul_uart.sv
+constexpr std::uint32_t reg_divisor = 5;
+
+using hdl = hdl_tlul_uart;
+using testbench = tlul_testbench<hdl>;
+
+struct sweep {
+    sweep():
+        top{new hdl},
+        tb{top.get()},
+        driver{top.get()},
+        sender{&(top->CLK), &(top->rx), 2},
+        receiver{[this](std::uint8_t c) { tx.push_back(c); }, &(top->CLK), &(top->tx), 2} {
+        tb.attach(driver);
+        receiver.attach(driver);
+        sender.attach(driver);
+    }
+    
+    ~sweep() {
+        top->final();
+    }
+    
+    void set_divisor(std::uint16_t divisor) {
+        // UART_ADDRESS + 5 = 132, lanes 4 and 5
+        std::array<std::uint8_t, 2> data {
+            std::uint8_t(divisor & 0xff), std::uint8_t(divisor >> 8) };
+        bool acked = false;
+        tb.put_full_data([&] { acked = true; }, uart_address + reg_divisor,
+            testbench::size_type(1), testbench::mask_type(0x30),
+            testbench::bytes{data.data(), data.size()});
+        driver.run_until([&] { return acked; }, 100);
+        
+        std::uint16_t read = 0;
+        acked = false;
+        tb.get([&](testbench::bytes v) {
+                read = std::uint16_t(v[0] | (v[1] << 8));
+                acked = true;
+            }, uart_address + reg_divisor, testbench::size_type(1), testbench::mask_type(0x30));
+        driver.run_until([&] { return acked; }, 100);
+        
+        if (read != divisor || std::uint64_t(top->INFO_CLKS_PER_BIT) != divisor)
+            fail("divisor " + std::to_string(divisor) + " read back as " + std::to_string(read));
+        
+        sender.set_cycles_per_bit(divisor);
+        receiver.set_cycles_per_bit(divisor);
+    }
+    
+    // 8 bytes each way, at once
+    void transfer(std::uint16_t divisor) {
+        std::array<std::uint8_t, 8> out, in;
+        for (auto &b: out)
+            b = std::uint8_t(rng());
+        for (auto &b: in)
+            b = std::uint8_t(rng());
+        sent_tx.insert(sent_tx.end(), out.begin(), out.end());
+        sent_rx.insert(sent_rx.end(), in.begin(), in.end());
+        
+        bool put = false, got = false;
+        tb.put_full_data([&] { put = true; }, uart_address, testbench::size_type(3),
+            testbench::mask_type(0xff), testbench::bytes{out.data(), out.size()});
+        sender.write(verilator_aux::span<std::uint8_t const>{in.data(), in.size()});
+        tb.get([&](testbench::bytes v) {
+                rx.insert(rx.end(), v.begin(), v.end());
+                got = true;
+            }, uart_address, testbench::size_type(3), testbench::mask_type(0xff));
+        
+        std::uint64_t budget = 20 * 10 * std::uint64_t(divisor) * out.size();
+        if (!driver.run_until([&] { return put && got && tx.size() == sent_tx.size(); },
+                budget))
+            fail("no echo at divisor " + std::to_string(divisor));
+    }
+    
+    void fail(std::string const &what) {
+        if (error.empty())
+            error = what + " (cycle " + std::to_string(driver.cycle()) + ")";
+    }
+    
+    std::unique_ptr<hdl> top;
+    testbench tb;
+    verilator_aux::clock_driver<hdl> driver;
+    uart::sender<decltype(hdl::CLK), decltype(hdl::rx)> sender;
+    uart::receiver<decltype(hdl::CLK), decltype(hdl::tx)> receiver;
+    
+    std::mt19937_64 rng {1};
+    std::vector<std::uint8_t> sent_tx, tx;
+    std::vector<std::uint8_t> sent_rx, rx;
+    std::string error;
+};
+
+int main(int argc, char **argv) {
+    std::size_t n_bytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    std::vector<std::uint16_t> divisors;
+    for (int i = 2; i < argc; ++i)
+        divisors.push_back(std::uint16_t(std::strtoul(argv[i], nullptr, 10)));
+    if (divisors.empty())
+        divisors = {87, 16, 5, 2};
+    
+    Verilated::commandArgs(argc, argv);
+    
+    sweep s;
+    std::cout << "bytes per divisor:         " << n_bytes << "\n";
+    for (auto divisor: divisors) {
+        if (divisor == 0 || !s.error.empty())
+            continue;
+        s.set_divisor(divisor);
+        
+        auto t0 = std::chrono::steady_clock::now();
+        auto c0 = s.driver.cycle();
+        for (std::size_t i = 0; i < n_bytes && s.error.empty(); i += 8)
+            s.transfer(divisor);
+        auto cycles = s.driver.cycle() - c0;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+            .count();
+        
+        double per_byte = double(cycles) / ((n_bytes + 7) / 8 * 8);
+        if (per_byte < 10.0 * divisor)
+            s.fail("divisor " + std::to_string(divisor) + " not taken");
+        
+        std::cout << "divisor " << divisor << ":\n";
+        std::cout << "    cycles per byte:       " << per_byte << "\n";
+        std::cout << "    [cycles/s]:            " << cycles / seconds << "\n";
+        std::cout << "    [bytes/s]:             " << 2 * n_bytes / seconds << std::endl;
+    }
+    
+    if (s.error.empty() && (s.tx != s.sent_tx || s.rx != s.sent_rx))
+        s.fail("the bytes received differ from the bytes sent");
+    if (!s.error.empty()) {
+        std::cerr << "tlul_uart: " << s.error << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_burst_check.cpp
+ * @brief Bursts on the data register of tlul_uart (built with UART_ADDRESS=128, aligned to
+ * the largest burst). Each round
+ *     writes 64 bytes with one PutFullData burst of 8 beats, more than the TX FIFO holds,
+ *     then the bytes of a random mask with a PutPartialData,
+ *     issues a 64-byte Get burst, then sends its bytes over the UART, more than the RX FIFO
+ *     holds.
+ * At the end, a PutPartialData on the divisor register, answered without effect.
+ * Fails unless the bytes out of tx are those written, the Gets return the bytes sent, and the
+ * divisor is unchanged.
+ * Reports the cycles per burst of both kinds.
+ * 
+ * usage: tlul_uart_burst_check [number of rounds] [seed]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <hdl_tlul_uart_burst.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::size_t clks_per_bit = 2;
+constexpr std::uint32_t uart_address = 128;
+
+using hdl = hdl_tlul_uart_burst;
+using testbench = tlul_testbench<hdl>;
+
+constexpr std::size_t burst = testbench::max_burst;
+
+int main(int argc, char **argv) {
+    std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto top = std::make_unique<hdl>();
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    
+    std::vector<std::uint8_t> written;
+    std::vector<std::uint8_t> tx;
+    std::vector<std::uint8_t> sent;
+    std::vector<std::uint8_t> read;
+    
+    auto uart_receiver = uart::make_receiver(
+        [&](std::uint8_t c) { tx.push_back(c); }, &(top->CLK), &(top->tx), clks_per_bit);
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->rx), clks_per_bit);
+    
+    uart_receiver.attach(driver);
+    uart_sender.attach(driver);
+    tb.attach(driver);
+    
+    std::mt19937_64 rng{seed};
+    verilator_aux::latency_histogram put_bursts;
+    verilator_aux::latency_histogram get_bursts;
+    
+    // every byte goes over the line, 10 bit times each
+    std::uint64_t const timeout = 2 * burst * 10 * clks_per_bit;
+    auto size = testbench::size_type(6);
+    auto mask = testbench::mask_type(0xff);
+    
+    bool timed_out = false;
+    for (std::size_t r = 0; r < rounds && !timed_out; ++r) {
+        std::array<std::uint8_t, burst> data;
+        for (auto &b: data)
+            b = std::uint8_t(rng());
+        written.insert(written.end(), data.begin(), data.end());
+        
+        bool acked = false;
+        tb.reset_stats();
+        tb.put_full_data([&] { acked = true; }, uart_address, size, mask,
+            testbench::bytes{data.data(), burst});
+        timed_out |= !driver.run_until([&] { return acked; }, timeout);
+        put_bursts.merge(tb.stats().ops[verilator_aux::tlul_stats::PutFullData].total);
+        
+        // the lanes of a non-empty mask, lowest lane first
+        auto lanes = testbench::mask_type(1 + rng() % 0xff);
+        std::vector<std::uint8_t> partial;
+        for (std::size_t i = 0; i < 8; ++i) {
+            if (lanes >> i & 1)
+                partial.push_back(std::uint8_t(rng()));
+        }
+        written.insert(written.end(), partial.begin(), partial.end());
+        
+        acked = false;
+        tb.put_partial_data([&] { acked = true; }, uart_address, testbench::size_type(3), lanes,
+            testbench::bytes{partial.data(), partial.size()});
+        timed_out |= !driver.run_until([&] { return acked; }, timeout);
+        
+        for (auto &b: data)
+            b = std::uint8_t(rng());
+        sent.insert(sent.end(), data.begin(), data.end());
+        
+        acked = false;
+        tb.reset_stats();
+        tb.get([&](testbench::bytes v) {
+                read.insert(read.end(), v.begin(), v.end());
+                acked = true;
+            }, uart_address, size, mask);
+        uart_sender.write(verilator_aux::span<std::uint8_t const>{data.data(), burst});
+        timed_out |= !driver.run_until([&] { return acked; }, timeout);
+        get_bursts.merge(tb.stats().ops[verilator_aux::tlul_stats::Get].total);
+    }
+    
+    // the low byte of the divisor (UART_ADDRESS + 5, lane 5), not 0
+    std::uint8_t low = 7;
+    bool acked = false;
+    tb.put_partial_data([&] { acked = true; }, uart_address + 5, testbench::size_type(0),
+        testbench::mask_type(0x20), testbench::bytes{&low, 1});
+    timed_out |= !driver.run_until([&] { return acked; }, timeout);
+    
+    // the last bytes may still be in the TX FIFO
+    driver.run_until([&] { return tx.size() == written.size(); }, timeout);
+    
+    std::cout << "rounds:                    " << rounds << "\n";
+    std::cout << "bytes written / tx:        " << written.size() << " / " << tx.size() << "\n";
+    std::cout << "bytes sent / read:         " << sent.size() << " / " << read.size() << "\n";
+    std::cout << "cycles per Put burst:      " << put_bursts.min << " / " << put_bursts.mean()
+        << " / " << put_bursts.max << " (min / mean / max)\n";
+    std::cout << "cycles per Get burst:      " << get_bursts.min << " / " << get_bursts.mean()
+        << " / " << get_bursts.max << " (min / mean / max)" << std::endl;
+    
+    top->final();
+    
+    bool ok = !timed_out && tx == written && read == sent && put_bursts.count == rounds &&
+        get_bursts.count == rounds && std::size_t(top->INFO_CLKS_PER_BIT) == clks_per_bit;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,187 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_bypass_check.cpp
+ * @brief Runs the same random Put/Get operations on tlul_uart with the UART (bit level) and
+ * built with UART_BYPASS (uart::byte_channel), in lockstep: the bypass model is advanced until
+ * it has produced as many bytes as the bit level one, and the byte streams (bytes sent out of
+ * tx, bytes returned by Gets) must be identical. Reports the cycles taken by both.
+ * 
+ * usage: tlul_uart_bypass_check [number of operations] [seed]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <hdl_tlul_uart.h>
+#include <hdl_tlul_uart_bypass.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::size_t clks_per_bit = 2;
+constexpr std::uint32_t uart_address = 127;
+
+// as in tlul_uart.sv
+constexpr std::size_t tx_fifo_size = 16;
+
+// the UART pins, with a uart::sender and a uart::receiver
+struct bit_level {
+    using hdl = hdl_tlul_uart;
+    
+    template <typename Driver>
+    bit_level(hdl *top, Driver &driver, std::vector<std::uint8_t> &tx):
+        sender{&(top->CLK), &(top->rx), clks_per_bit},
+        receiver{[&tx](std::uint8_t c) { tx.push_back(c); }, &(top->CLK), &(top->tx),
+            clks_per_bit} {
+        receiver.attach(driver);
+        sender.attach(driver);
+    }
+    
+    uart::sender<decltype(hdl::CLK), decltype(hdl::rx)> sender;
+    uart::receiver<decltype(hdl::CLK), decltype(hdl::tx)> receiver;
+};
+
+// the byte ports, with a uart::byte_channel
+struct bypass {
+    using hdl = hdl_tlul_uart_bypass;
+    
+    template <typename Driver>
+    bypass(hdl *top, Driver &driver, std::vector<std::uint8_t> &tx):
+        sender{[&tx](std::uint8_t c) { tx.push_back(c); },
+            &(top->rx_dv), &(top->rx_byte), &(top->rx_ready),
+            &(top->tx_dv), &(top->tx_byte), &(top->tx_done)} {
+        sender.attach(driver);
+    }
+    
+    uart::byte_channel<
+        decltype(hdl::rx_dv), decltype(hdl::rx_byte), decltype(hdl::rx_ready),
+        decltype(hdl::tx_dv), decltype(hdl::tx_byte), decltype(hdl::tx_done)> sender;
+};
+
+template <typename Ports>
+struct harness {
+    using hdl = typename Ports::hdl;
+    using testbench = tlul_testbench<hdl>;
+    
+    harness(std::uint64_t seed, std::size_t n_ops):
+        top{new hdl},
+        tb{top.get()},
+        driver{top.get()},
+        ports{top.get(), driver, tx},
+        rng{seed},
+        remaining{n_ops} {
+        tb.attach(driver);
+        next();
+    }
+    
+    ~harness() {
+        top->final();
+    }
+    
+    // one operation at a time, the next one is started from the callback
+    void next() {
+        if (remaining == 0) {
+            finished = true;
+            return;
+        }
+        --remaining;
+        
+        auto s = typename testbench::size_type(rng() % 4);
+        std::size_t sz = std::size_t(1) << s;
+        typename testbench::mask_type mask = (1u << sz) - 1;
+        std::array<std::uint8_t, 8> data;
+        for (std::size_t i = 0; i < sz; ++i)
+            data[i] = std::uint8_t(rng());
+        
+        if (rng() % 2) {
+            tb.put_full_data([this] { next(); }, uart_address, s, mask,
+                typename testbench::bytes{data.data(), sz});
+        }
+        else {
+            tb.get([this](typename testbench::bytes v) {
+                    rx.insert(rx.end(), v.begin(), v.end());
+                    next();
+                }, uart_address, s, mask);
+            ports.sender.write_bytes(typename testbench::bytes{data.data(), sz}, nullptr);
+        }
+    }
+    
+    std::size_t produced() const {
+        return tx.size() + rx.size();
+    }
+    
+    std::unique_ptr<hdl> top;
+    testbench tb;
+    verilator_aux::clock_driver<hdl> driver;
+    
+    // bytes out of tx, bytes returned by Gets
+    std::vector<std::uint8_t> tx;
+    std::vector<std::uint8_t> rx;
+    
+    Ports ports;
+    std::mt19937_64 rng;
+    std::size_t remaining;
+    bool finished {false};
+};
+
+bool prefix_equal(std::vector<std::uint8_t> const &a, std::vector<std::uint8_t> const &b) {
+    auto n = std::min(a.size(), b.size());
+    return std::equal(a.begin(), a.begin() + n, b.begin());
+}
+
+int main(int argc, char **argv) {
+    std::size_t n_ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    harness<bit_level> slow{seed, n_ops};
+    harness<bypass> fast{seed, n_ops};
+    
+    // a Get waits at most for 8 bytes on the UART
+    std::uint64_t const max_cycles = 1000 * clks_per_bit * (n_ops + 1);
+    
+    while (!(slow.finished && fast.finished) && !Verilated::gotFinish()) {
+        if (!slow.finished)
+            slow.driver.run_cycles(1);
+        fast.driver.run_until([&] {
+                return fast.finished || (fast.tx.size() >= slow.tx.size() &&
+                    fast.rx.size() >= slow.rx.size());
+            }, max_cycles);
+        
+        if (!prefix_equal(slow.tx, fast.tx) || !prefix_equal(slow.rx, fast.rx)) {
+            std::cerr << "bypass differs from bit level at cycle " << slow.driver.cycle()
+                << " (bypass: " << fast.driver.cycle() << ")" << std::endl;
+            return EXIT_FAILURE;
+        }
+        
+        if (slow.driver.cycle() > max_cycles || fast.driver.cycle() > max_cycles) {
+            std::cerr << "timed out" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    // the last bytes out of tx may still be in the TX FIFO (writes are posted) or on the wire
+    slow.driver.run_cycles((tx_fifo_size + 2) * 10 * clks_per_bit);
+    fast.driver.run_cycles((tx_fifo_size + 2) * 10 * clks_per_bit);
+    
+    std::cout << "operations:                " << n_ops << "\n";
+    std::cout << "bytes (tx / rx):           " << slow.tx.size() << " / " << slow.rx.size()
+        << "\n";
+    std::cout << "cycles (bit level):        " << slow.driver.cycle() << "\n";
+    std::cout << "cycles (bypass):           " << fast.driver.cycle() << "\n";
+    std::cout << "speed-up [cycles]:         "
+        << double(slow.driver.cycle()) / fast.driver.cycle() << std::endl;
+    
+    return slow.tx == fast.tx && slow.rx == fast.rx ? EXIT_SUCCESS : EXIT_FAILURE;
+}
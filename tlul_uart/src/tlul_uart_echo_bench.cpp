@@ -0,0 +1,103 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_echo_bench.cpp
+ * @brief Simulated cycles per second of tlul_uart_echo, with the hand-written clock loop of
+ * tlul_uart_tb.cpp and with clock_driver. The UART is kept busy in both cases.
+ * 
+ * usage: tlul_uart_echo_bench [number of cycles]
+ */
+
+#include "clock_driver.hpp"
+#include "uart_testbench.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <numeric>
+
+#include <hdl_tlul_uart_echo.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+struct result {
+    double cycles_per_second;
+    std::size_t echoed;
+};
+
+template <typename Run>
+result measure(std::uint64_t cycles, Run &&run) {
+    auto top = std::make_unique<hdl_tlul_uart_echo>();
+    
+    std::size_t echoed = 0;
+    auto uart_receiver = uart::make_receiver(
+        [&](std::uint8_t) { ++echoed; }, &(top->CLK), &(top->TX), 2);
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->RX), 2);
+    
+    // keeps the FIFO busy, two chunks are queued and each one queues itself again once sent
+    std::array<std::uint8_t, 256> pattern;
+    std::iota(pattern.begin(), pattern.end(), 0);
+    
+    struct {
+        decltype(uart_sender) *sender;
+        verilator_aux::span<std::uint8_t const> chunk;
+        
+        void operator()() const {
+            sender->write_bytes(chunk, *this);
+        }
+    } refill{&uart_sender, pattern};
+    refill();
+    refill();
+    
+    auto t0 = std::chrono::steady_clock::now();
+    run(top.get(), uart_receiver, uart_sender, cycles);
+    auto t1 = std::chrono::steady_clock::now();
+    
+    top->final();
+    return {cycles / std::chrono::duration<double>(t1 - t0).count(), echoed};
+}
+
+int main(int argc, char **argv) {
+    std::uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    // as in tlul_uart_tb.cpp
+    auto by_hand = measure(cycles, [](auto *top, auto &uart_receiver, auto &uart_sender,
+            std::uint64_t cycles) {
+        top->CLK = 1;
+        for (std::uint64_t i = 0; i < 2 * cycles; ++i) {
+            ++main_time;
+            
+            // toggle the clock
+            top->CLK = !top->CLK;
+            
+            uart_receiver.eval();
+            top->eval();
+            uart_sender.eval();
+        }
+    });
+    
+    auto driven = measure(cycles, [](auto *top, auto &uart_receiver, auto &uart_sender,
+            std::uint64_t cycles) {
+        verilator_aux::clock_driver<hdl_tlul_uart_echo> driver{top};
+        uart_receiver.attach(driver);
+        uart_sender.attach(driver);
+        driver.run_cycles(cycles);
+    });
+    
+    std::cout << "cycles:                    " << cycles << "\n";
+    std::cout << "by hand [cycles/s]:        " << by_hand.cycles_per_second << "\n";
+    std::cout << "clock_driver [cycles/s]:   " << driven.cycles_per_second << "\n";
+    std::cout << "speed-up:                  "
+        << driven.cycles_per_second / by_hand.cycles_per_second << "\n";
+    std::cout << "bytes echoed:              " << by_hand.echoed << " / " << driven.echoed
+        << std::endl;
+    
+    // both loops must simulate the same thing
+    return by_hand.echoed == driven.echoed && driven.echoed > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
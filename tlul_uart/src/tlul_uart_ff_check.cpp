@@ -0,0 +1,117 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_ff_check.cpp
+ * @brief Runs tlul_uart_echo (at 87 clocks per bit) with and without the fast-forward of
+ * clock_driver. Fails unless both runs see the same bytes at the same cycles; reports the speed
+ * of both.
+ * 
+ * usage: tlul_uart_ff_check [number of bursts]
+ */
+
+#include "clock_driver.hpp"
+#include "uart_testbench.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <hdl_tlul_uart_echo_87.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::size_t clks_per_bit = 87;
+
+struct run_result {
+    // (cycle, byte) of each echoed byte
+    std::vector<std::pair<std::uint64_t, std::uint8_t>> log;
+    std::uint64_t cycles;
+    std::uint64_t skipped;
+    double seconds;
+};
+
+run_result run(std::size_t bursts, std::uint64_t fast_forward) {
+    auto top = std::make_unique<hdl_tlul_uart_echo_87>();
+    verilator_aux::clock_driver<hdl_tlul_uart_echo_87> driver{top.get()};
+    run_result r;
+    
+    auto uart_receiver = uart::make_receiver(
+        [&](std::uint8_t c) { r.log.emplace_back(driver.cycle(), c); },
+        &(top->CLK), &(top->TX), clks_per_bit);
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->RX), clks_per_bit);
+    
+    uart_receiver.attach(driver);
+    uart_sender.attach(driver);
+    driver.set_fast_forward(fast_forward);
+    
+    // sends a burst, byte after byte
+    std::string const burst = "canberkx";
+    std::size_t sent = 0;
+    struct {
+        decltype(uart_sender) *sender;
+        std::string const *burst;
+        std::size_t *sent;
+        std::size_t idx;
+        
+        void operator()() {
+            if (idx == burst->size())
+                return;
+            auto self = *this;
+            ++self.idx;
+            ++*sent;
+            sender->write_byte(std::uint8_t((*burst)[idx]), self);
+        }
+    } send{&uart_sender, &burst, &sent, 0};
+    
+    auto t0 = std::chrono::steady_clock::now();
+    
+    for (std::size_t i = 0; i < bursts; ++i) {
+        auto next = send;
+        next();
+        
+        // all echoed, then an idle gap of varying length
+        driver.run_until([&] { return r.log.size() == sent && sent == (i + 1) * burst.size(); },
+            100000 * burst.size());
+        driver.run_cycles(1000 + 37 * i);
+    }
+    
+    auto t1 = std::chrono::steady_clock::now();
+    
+    top->final();
+    
+    r.cycles = driver.cycle();
+    r.skipped = driver.skipped_cycles();
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    return r;
+}
+
+int main(int argc, char **argv) {
+    std::size_t bursts = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto plain = run(bursts, 0);
+    auto fast = run(bursts, 8);
+    
+    std::cout << "cycles:                    " << plain.cycles << " / " << fast.cycles << "\n";
+    std::cout << "bytes echoed:              " << plain.log.size() << " / " << fast.log.size()
+        << "\n";
+    std::cout << "fast-forwarded cycles:     " << fast.skipped << " ("
+        << 100.0 * fast.skipped / fast.cycles << "%)\n";
+    std::cout << "plain [cycles/s]:          " << plain.cycles / plain.seconds << "\n";
+    std::cout << "fast-forward [cycles/s]:   " << fast.cycles / fast.seconds << "\n";
+    std::cout << "speed-up:                  " << plain.seconds / fast.seconds << std::endl;
+    
+    if (plain.log != fast.log || plain.cycles != fast.cycles) {
+        std::cerr << "fast-forward does not match cycle by cycle stepping" << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return plain.log.size() == bursts * 8 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
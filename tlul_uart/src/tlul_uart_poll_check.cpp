@@ -0,0 +1,247 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_poll_check.cpp
+ * @brief The register map of tlul_uart (RX level, TX free, flags), in polling mode:
+ *     tlul_uart:          the registers are read with a 4-byte Get from UART_ADDRESS + 1, and
+ *                         every data Get is sized to what the RX level says is there; an
+ *                         overrun is flagged once, however many bytes are lost (256 too),
+ *     tlul_uart_echo:     built with POLL=1, random-sized chunks are echoed exactly (the echo
+ *                         master never Gets more than is there).
+ * Fails on any difference, or if a Get has to wait.
+ * 
+ * usage: tlul_uart_poll_check [number of rounds] [seed]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "uart_capture.hpp"
+#include "clock_driver.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <hdl_tlul_uart.h>
+#include <hdl_tlul_uart_echo_poll.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::size_t clks_per_bit = 2;
+constexpr std::uint32_t uart_address = 127;
+
+// as in tlul_uart.sv
+constexpr std::size_t fifo_size = 16;
+
+// bytes lost at most by one send()
+constexpr std::size_t max_lost = 256;
+
+enum flag: std::uint8_t {
+    rx_avail = 1 << 0,
+    tx_idle = 1 << 1,
+    tx_full = 1 << 2,
+    rx_overrun = 1 << 3
+};
+
+struct registers {
+    std::uint8_t rx_level;
+    std::uint8_t tx_free;
+    std::uint8_t flags;
+};
+
+struct register_check {
+    using hdl = hdl_tlul_uart;
+    using testbench = tlul_testbench<hdl>;
+    
+    register_check():
+        top{new hdl},
+        tb{top.get()},
+        driver{top.get()},
+        sender{&(top->CLK), &(top->rx), clks_per_bit} {
+        tb.attach(driver);
+        sender.attach(driver);
+    }
+    
+    ~register_check() {
+        top->final();
+    }
+    
+    // runs until the Get is acknowledged, which must not take longer than receiving a byte
+    template <typename Callback>
+    void get(std::uint32_t address, std::size_t size_log2, std::uint8_t mask, Callback &&cb) {
+        bool acked = false;
+        tb.get([&](testbench::bytes v) {
+                cb(v);
+                acked = true;
+            }, address, testbench::size_type(size_log2), testbench::mask_type(mask));
+        if (!driver.run_until([&] { return acked; }, 10 * clks_per_bit))
+            fail("a Get waited");
+    }
+    
+    registers read_registers() {
+        registers r {};
+        
+        // UART_ADDRESS + 1 = 128, aligned to 4 bytes
+        get(uart_address + 1, 2, 0x0f, [&](testbench::bytes v) {
+            r = registers{v[0], v[1], v[2]};
+            if (v[3] != 0)
+                fail("the byte after the flags is not 0");
+        });
+        return r;
+    }
+    
+    void send(std::size_t n) {
+        std::array<std::uint8_t, fifo_size + max_lost> data;
+        for (std::size_t i = 0; i < n; ++i)
+            data[i] = std::uint8_t(rng());
+        sender.write(verilator_aux::span<std::uint8_t const>{data.data(), n});
+        
+        // at most fifo_size bytes are kept
+        sent.insert(sent.end(), data.begin(), data.begin() + std::min(n, fifo_size));
+        
+        // the stop bit of the last byte
+        driver.run_until([&] { return !sender.ongoing(); });
+        driver.run_cycles(2 * clks_per_bit);
+    }
+    
+    // reads whatever the RX level says, in power-of-2 Gets of at most 8 bytes
+    void drain() {
+        for (auto r = read_registers(); r.rx_level != 0; r = read_registers()) {
+            std::size_t s = 0;
+            while (s < 3 && (std::size_t(2) << s) <= r.rx_level)
+                ++s;
+            std::size_t sz = std::size_t(1) << s;
+            
+            get(uart_address, s, std::uint8_t((1u << sz) - 1), [&](testbench::bytes v) {
+                read.insert(read.end(), v.begin(), v.end());
+            });
+        }
+    }
+    
+    void expect(registers r, std::uint8_t rx_level, std::uint8_t tx_free, std::uint8_t flags) {
+        if (r.rx_level != rx_level || r.tx_free != tx_free || r.flags != flags) {
+            fail("registers " + std::to_string(r.rx_level) + " " + std::to_string(r.tx_free) +
+                " " + std::to_string(r.flags) + ", expected " + std::to_string(rx_level) + " " +
+                std::to_string(tx_free) + " " + std::to_string(flags));
+        }
+    }
+    
+    void fail(std::string const &what) {
+        if (error.empty())
+            error = what + " (cycle " + std::to_string(driver.cycle()) + ")";
+    }
+    
+    void round() {
+        // idle
+        expect(read_registers(), 0, fifo_size, tx_idle);
+        
+        // buffered bytes, read exactly
+        std::size_t n = 1 + rng() % fifo_size;
+        send(n);
+        expect(read_registers(), std::uint8_t(n), fifo_size, rx_avail | tx_idle);
+        drain();
+        
+        // more than fits: the overrun is flagged, the first read clears it
+        send(fifo_size + 1 + rng() % fifo_size);
+        expect(read_registers(), fifo_size, fifo_size, rx_avail | tx_idle | rx_overrun);
+        expect(read_registers(), fifo_size, fifo_size, rx_avail | tx_idle);
+        drain();
+        
+        // a posted write occupies the TX FIFO until it is sent
+        bool acked = false;
+        std::array<std::uint8_t, 8> data {};
+        tb.put_full_data([&] { acked = true; }, uart_address, testbench::size_type(3),
+            testbench::mask_type(0xff), testbench::bytes{data.data(), data.size()});
+        driver.run_until([&] { return acked; }, 10 * clks_per_bit);
+        auto r = read_registers();
+        if (r.tx_free < fifo_size - 8 || r.tx_free >= fifo_size || (r.flags & tx_idle))
+            fail("TX free " + std::to_string(r.tx_free) + ", flags " + std::to_string(r.flags) +
+                " while sending");
+        driver.run_cycles(10 * 10 * clks_per_bit);
+        expect(read_registers(), 0, fifo_size, tx_idle);
+    }
+    
+    // as many lost bytes as an 8-bit counter of them takes to wrap around
+    void overrun_wrap() {
+        send(fifo_size + max_lost);
+        expect(read_registers(), fifo_size, fifo_size, rx_avail | tx_idle | rx_overrun);
+        expect(read_registers(), fifo_size, fifo_size, rx_avail | tx_idle);
+        drain();
+    }
+    
+    std::unique_ptr<hdl> top;
+    testbench tb;
+    verilator_aux::clock_driver<hdl> driver;
+    uart::sender<decltype(hdl::CLK), decltype(hdl::rx)> sender;
+    
+    std::mt19937_64 rng {1};
+    std::vector<std::uint8_t> sent;
+    std::vector<std::uint8_t> read;
+    std::string error;
+};
+
+// random-sized chunks through tlul_uart_echo with POLL=1, each one echoed before the next
+bool echo_check(std::size_t rounds, std::uint64_t seed) {
+    using hdl = hdl_tlul_uart_echo_poll;
+    
+    auto top = std::make_unique<hdl>();
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    uart::capture echoed;
+    
+    auto uart_receiver = uart::make_receiver(
+        echoed.sink(driver), &(top->CLK), &(top->TX), clks_per_bit);
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->RX), clks_per_bit);
+    uart_receiver.attach(driver);
+    uart_sender.attach(driver);
+    
+    std::mt19937_64 rng{seed};
+    std::vector<std::uint8_t> sent;
+    bool ok = true;
+    for (std::size_t r = 0; r < rounds && ok; ++r) {
+        std::array<std::uint8_t, 64> chunk;
+        std::size_t n = 1 + rng() % chunk.size();
+        for (std::size_t i = 0; i < n; ++i)
+            sent.push_back(chunk[i] = std::uint8_t(rng()));
+        uart_sender.write(verilator_aux::span<std::uint8_t const>{chunk.data(), n});
+        
+        ok = driver.run_until([&] { return echoed.size() == sent.size(); },
+            (n + 4) * 20 * 10 * clks_per_bit);
+    }
+    
+    auto c = uart::compare(sent, echoed.bytes());
+    std::cout << "echoed (POLL=1):           " << c.received << " of " << c.sent << " bytes"
+        << std::endl;
+    top->final();
+    return ok && c.equal();
+}
+
+int main(int argc, char **argv) {
+    std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    register_check regs;
+    regs.rng.seed(seed);
+    for (std::size_t r = 0; r < rounds && regs.error.empty(); ++r)
+        regs.round();
+    if (regs.error.empty())
+        regs.overrun_wrap();
+    if (regs.error.empty() && regs.read != regs.sent)
+        regs.fail("the bytes read differ from the bytes sent");
+    
+    std::cout << "rounds:                    " << rounds << "\n";
+    std::cout << "bytes read (polling):      " << regs.read.size() << " of " << regs.sent.size()
+        << std::endl;
+    if (!regs.error.empty())
+        std::cerr << "tlul_uart: " << regs.error << std::endl;
+    
+    bool echo_ok = echo_check(rounds, seed);
+    return regs.error.empty() && echo_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
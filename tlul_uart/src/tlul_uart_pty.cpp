@@ -0,0 +1,153 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_pty.cpp
+ * @brief Runs tlul_uart_echo behind a pseudo-terminal: what a host tool writes to the terminal
+ * goes to RX, what comes out of TX is written back to the terminal. Prints the path of the
+ * terminal, and the throughput every second while there is traffic.
+ * 
+ * usage: tlul_uart_pty [seconds, 0 runs until killed]
+ *        tlul_uart_pty --self-test [number of bytes]
+ * 
+ * The self-test opens the terminal itself, writes random bytes one at a time and expects each
+ * one to be echoed; it fails on a mismatch or if an echo does not come within a second.
+ */
+
+#include "clock_driver.hpp"
+#include "uart_testbench.hpp"
+#include "pty_bridge.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <hdl_tlul_uart_echo.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+// as in tlul_uart_echo.sv
+constexpr std::size_t clks_per_bit = 2;
+
+// a host tool, on the other end of the terminal
+struct self_test {
+    std::atomic<bool> done {false};
+    std::atomic<bool> passed {false};
+    std::string message;
+    
+    void operator()(std::string const &path, std::size_t n) {
+        message = run(path, n);
+        passed = message.empty();
+        done = true;
+    }
+    
+    static std::string run(std::string const &path, std::size_t n) {
+        int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+        if (fd < 0)
+            return "cannot open " + path + ": " + std::strerror(errno);
+        
+        std::mt19937 rng{1};
+        std::string error;
+        for (std::size_t i = 0; i < n && error.empty(); ++i) {
+            auto sent = std::uint8_t(rng());
+            if (::write(fd, &sent, 1) != 1) {
+                error = "write failed";
+                break;
+            }
+            
+            pollfd p {fd, POLLIN, 0};
+            std::uint8_t echoed;
+            if (::poll(&p, 1, 1000) != 1 || ::read(fd, &echoed, 1) != 1)
+                error = "no echo for byte #" + std::to_string(i);
+            else if (echoed != sent)
+                error = "byte #" + std::to_string(i) + ": sent " + std::to_string(sent) +
+                    ", echoed " + std::to_string(echoed);
+        }
+        
+        ::close(fd);
+        return error;
+    }
+};
+
+int main(int argc, char **argv) {
+    bool testing = argc > 1 && std::string{argv[1]} == "--self-test";
+    std::size_t test_bytes = testing && argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+    double duration = !testing && argc > 1 ? std::strtod(argv[1], nullptr) : 0;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto top = std::make_unique<hdl_tlul_uart_echo>();
+    verilator_aux::clock_driver<hdl_tlul_uart_echo> driver{top.get()};
+    uart::pty_bridge bridge;
+    
+    auto uart_receiver = uart::make_receiver(
+        [&](std::uint8_t c) { bridge.put(c); }, &(top->CLK), &(top->TX), clks_per_bit);
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->RX), clks_per_bit);
+    
+    uart_receiver.attach(driver);
+    uart_sender.attach(driver);
+    
+    std::cout << "terminal: " << bridge.path() << std::endl;
+    
+    self_test test;
+    std::thread host;
+    if (testing)
+        host = std::thread{[&] { test(bridge.path(), test_bytes); }};
+    
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    auto last_print = start;
+    std::uint64_t last_to_model = 0;
+    std::uint64_t last_to_host = 0;
+    
+    for (;;) {
+        bridge.pump(uart_sender);
+        driver.run_cycles(256);
+        
+        auto now = clock::now();
+        if (testing ? test.done.load() :
+                duration > 0 && std::chrono::duration<double>(now - start).count() >= duration)
+            break;
+        
+        if (now - last_print >= std::chrono::seconds{1}) {
+            auto to_model = bridge.bytes_to_model();
+            auto to_host = bridge.bytes_to_host();
+            double s = std::chrono::duration<double>(now - last_print).count();
+            if (to_model != last_to_model || to_host != last_to_host) {
+                std::cout << "to model [bytes/s]: " << (to_model - last_to_model) / s
+                    << ", to host [bytes/s]: " << (to_host - last_to_host) / s
+                    << ", simulated cycles: " << driver.cycle() << std::endl;
+            }
+            last_print = now;
+            last_to_model = to_model;
+            last_to_host = to_host;
+        }
+    }
+    
+    if (host.joinable())
+        host.join();
+    top->final();
+    
+    bridge.report(std::cout);
+    std::cout << "simulated cycles:      " << driver.cycle() << std::endl;
+    
+    if (testing) {
+        if (!test.passed) {
+            std::cerr << "self-test failed: " << test.message << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "self-test passed: " << test_bytes << " bytes echoed" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
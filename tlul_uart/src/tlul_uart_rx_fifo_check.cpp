@@ -0,0 +1,115 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_rx_fifo_check.cpp
+ * @brief Gets on tlul_uart, served from the RX FIFO. Each round
+ *     sends 16 bytes (the size of the RX FIFO) over the UART while the bus is idle, then reads
+ *     them back with two 8-byte Gets (buffered),
+ *     issues an 8-byte Get, then sends its bytes (waiting).
+ * Fails unless every Get returns the bytes sent, and a buffered Get completes in less time
+ * than it takes to receive a byte. Reports the cycles per Get of both kinds.
+ *
+ * usage: tlul_uart_rx_fifo_check [number of rounds] [seed]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <hdl_tlul_uart.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::size_t clks_per_bit = 2;
+constexpr std::uint32_t uart_address = 127;
+
+// as in tlul_uart.sv
+constexpr std::size_t rx_fifo_size = 16;
+
+using hdl = hdl_tlul_uart;
+using testbench = tlul_testbench<hdl>;
+
+int main(int argc, char **argv) {
+    std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto top = std::make_unique<hdl>();
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->rx), clks_per_bit);
+    
+    tb.attach(driver);
+    uart_sender.attach(driver);
+    
+    std::mt19937_64 rng{seed};
+    std::vector<std::uint8_t> sent;
+    std::vector<std::uint8_t> read;
+    verilator_aux::latency_histogram buffered;
+    verilator_aux::latency_histogram waiting;
+    
+    std::uint64_t const timeout = 100 * 10 * clks_per_bit;
+    
+    // an 8-byte Get, wait() runs until it is acknowledged and records its latency in h
+    bool acked = false;
+    auto get = [&] {
+        acked = false;
+        tb.reset_stats();
+        tb.get([&](testbench::bytes v) {
+                read.insert(read.end(), v.begin(), v.end());
+                acked = true;
+            }, uart_address, testbench::size_type(3), testbench::mask_type(0xff));
+    };
+    auto wait = [&](verilator_aux::latency_histogram &h) {
+        bool ok = driver.run_until([&] { return acked; }, timeout);
+        h.merge(tb.stats().ops[verilator_aux::tlul_stats::Get].total);
+        return ok;
+    };
+    
+    auto send = [&](std::size_t n) {
+        std::array<std::uint8_t, rx_fifo_size> data;
+        for (std::size_t i = 0; i < n; ++i)
+            sent.push_back(data[i] = std::uint8_t(rng()));
+        uart_sender.write(verilator_aux::span<std::uint8_t const>{data.data(), n});
+    };
+    
+    bool timed_out = false;
+    for (std::size_t r = 0; r < rounds && !timed_out; ++r) {
+        // buffered: the bytes are in the RX FIFO before the Gets
+        send(rx_fifo_size);
+        driver.run_until([&] { return !uart_sender.ongoing(); }, timeout);
+        driver.run_cycles(10 * clks_per_bit);
+        for (std::size_t i = 0; i < rx_fifo_size / 8; ++i) {
+            get();
+            timed_out |= !wait(buffered);
+        }
+        
+        // waiting: the Get is issued first
+        get();
+        send(8);
+        timed_out |= !wait(waiting);
+    }
+    
+    std::cout << "rounds:                    " << rounds << "\n";
+    std::cout << "bytes sent / read:         " << sent.size() << " / " << read.size() << "\n";
+    std::cout << "cycles per buffered Get:   " << buffered.min << " / " << buffered.mean()
+        << " / " << buffered.max << " (min / mean / max)\n";
+    std::cout << "cycles per waiting Get:    " << waiting.min << " / " << waiting.mean()
+        << " / " << waiting.max << " (min / mean / max)" << std::endl;
+    
+    top->final();
+    
+    bool ok = !timed_out && read == sent && buffered.count == rounds * (rx_fifo_size / 8) &&
+        buffered.max < 10 * clks_per_bit;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,6 +1,11 @@
 #include "tlul_testbench.hpp"
 #include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+#include "uart_capture.hpp"
+#include <cstdlib>
+#include <iostream>
 #include <memory>
+#include <string>
 
 #include <verilated_vcd_c.h>
 #include <hdl_tlul_uart.h>
@@ -154,8 +159,12 @@ int main(int argc, char **argv) {
     std::unique_ptr<hdl_tlul_uart_echo> top{new hdl_tlul_uart_echo};
     std::unique_ptr<VerilatedVcdC> tfp{new VerilatedVcdC};
     
+    verilator_aux::clock_driver<hdl_tlul_uart_echo> driver{top.get()};
+    
+    // the echoed bytes, with their cycles
+    uart::capture echoed;
     auto uart_receiver = uart::make_receiver(
-        [](std::uint8_t c) { std::cout << c << " "; },
+        echoed.sink(driver),
         &(top->CLK), &(top->TX), 2); // top->INFO_CLKS_PER_BIT);
     
     auto uart_sender = uart::make_sender(&(top->CLK), &(top->RX), 2);
@@ -164,32 +173,38 @@ int main(int argc, char **argv) {
     top->trace(tfp.get(), 99);
     tfp->open("dump4.vcd");
     
-    top->CLK = 1;
+    uart_receiver.attach(driver);
+    uart_sender.attach(driver);
     
-    while (!Verilated::gotFinish()) {
-        if (main_time == 20000) {
-            break;
-        }
-        
-        if (main_time == 5) {
-            uart_sender.write_bytes("canberkxcanberkxcanberkx", [] {});
-        }
-        
+    auto dump = [&] {
         ++main_time;
-        
-        // toggle the clock
-        top->CLK = !top->CLK;
-        
-        uart_receiver.eval();
-        top->eval();
-        uart_sender.eval();
-        
         if (tfp) tfp->dump(main_time);
-    }
+    };
+    driver.on(verilator_aux::edge_hook::after_posedge, dump);
+    driver.on(verilator_aux::edge_hook::after_negedge, dump);
+    
+    std::string const sent = "canberkxcanberkxcanberkx";
+    driver.run_cycles(3);
+    uart_sender.write_bytes(sent, [] {});
+    
+    // every byte echoed, in far fewer than 1000 cycles each
+    bool finished = driver.run_until(
+        [&] { return Verilated::gotFinish() || echoed.size() == sent.size(); },
+        1000 * sent.size());
     
     top->final();
     tfp->close();
-    return 0;
+    
+    auto c = uart::compare(
+        {reinterpret_cast<std::uint8_t const *>(sent.data()), sent.size()}, echoed.bytes());
+    std::cout << "echoed " << c.received << " of " << c.sent << " bytes";
+    if (!c.equal() && c.first_mismatch < c.received)
+        std::cout << ", first mismatch at byte " << c.first_mismatch << " (cycle "
+            << echoed.cycles()[c.first_mismatch] << ")";
+    if (!finished)
+        std::cout << ", timed out after " << driver.cycle() << " cycles";
+    std::cout << std::endl;
+    return finished && c.equal() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 #endif
@@ -0,0 +1,109 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_tx_fifo_check.cpp
+ * @brief Bus occupancy of PutFullData on tlul_uart, with posted writes (the default) and with
+ * POSTED_WRITES=0 (the write is acknowledged once its bytes are sent, as before the TX FIFO).
+ * 
+ * 8-byte writes are issued one at a time, each one an idle gap after the previous AccessAck;
+ * the gap is longer than sending 8 bytes, so the TX FIFO never fills up. The bus is occupied
+ * from putting a write on channel A until its AccessAck. Fails unless both models send the
+ * same bytes out of tx, and a posted write occupies the bus for less than sending a byte.
+ * 
+ * usage: tlul_uart_tx_fifo_check [number of writes] [seed]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <hdl_tlul_uart.h>
+#include <hdl_tlul_uart_unposted.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+constexpr std::size_t clks_per_bit = 2;
+constexpr std::uint32_t uart_address = 127;
+
+// sending 8 bytes takes 80 bit times
+constexpr std::uint64_t gap = 100 * clks_per_bit;
+
+struct result {
+    std::vector<std::uint8_t> sent;
+    std::vector<std::uint8_t> tx;
+    verilator_aux::latency_histogram occupancy;
+    std::uint64_t cycles;
+};
+
+template <typename HDL>
+result run(std::size_t n_writes, std::uint64_t seed) {
+    using testbench = tlul_testbench<HDL>;
+    
+    auto top = std::make_unique<HDL>();
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<HDL> driver{top.get()};
+    result r;
+    
+    auto uart_receiver = uart::make_receiver(
+        [&](std::uint8_t c) { r.tx.push_back(c); }, &(top->CLK), &(top->tx), clks_per_bit);
+    uart_receiver.attach(driver);
+    tb.attach(driver);
+    
+    std::mt19937_64 rng{seed};
+    for (std::size_t i = 0; i < n_writes; ++i) {
+        std::array<std::uint8_t, 8> data;
+        for (auto &b: data)
+            b = std::uint8_t(rng());
+        r.sent.insert(r.sent.end(), data.begin(), data.end());
+        
+        bool acked = false;
+        tb.put_full_data([&] { acked = true; }, uart_address, typename testbench::size_type(3),
+            typename testbench::mask_type(0xff), typename testbench::bytes{data.data(), 8});
+        driver.run_until([&] { return acked; }, 1000 * clks_per_bit);
+        driver.run_cycles(gap);
+    }
+    
+    // the last bytes may still be in the TX FIFO
+    driver.run_until([&] { return r.tx.size() == r.sent.size(); }, 1000 * clks_per_bit);
+    
+    r.occupancy = tb.stats().ops[verilator_aux::tlul_stats::PutFullData].total;
+    r.cycles = driver.cycle();
+    top->final();
+    return r;
+}
+
+void print(char const *name, result const &r) {
+    std::cout << "cycles per write (" << name << "):   " << r.occupancy.min << " / "
+        << r.occupancy.mean() << " / " << r.occupancy.max << " (min / mean / max)\n";
+    std::cout << "bus occupancy (" << name << "):      " << double(r.occupancy.sum) / r.cycles
+        << "\n";
+}
+
+int main(int argc, char **argv) {
+    std::size_t n_writes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto unposted = run<hdl_tlul_uart_unposted>(n_writes, seed);
+    auto posted = run<hdl_tlul_uart>(n_writes, seed);
+    
+    std::cout << "writes:                        " << n_writes << "\n";
+    print("unposted", unposted);
+    print("posted  ", posted);
+    std::cout << std::flush;
+    
+    bool ok = posted.tx == posted.sent && unposted.tx == unposted.sent &&
+        posted.occupancy.count == n_writes && unposted.occupancy.count == n_writes &&
+        posted.occupancy.max < 10 * clks_per_bit;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
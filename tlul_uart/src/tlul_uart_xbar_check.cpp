@@ -0,0 +1,130 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_xbar_check.cpp
+ * @brief tlul_uart behind tlul_xbar, next to a memory (tlul_uart_xbar.sv), one master. Each round
+ *     writes random bytes to the memory and sends 8 bytes with a PutFullData to the data
+ *     register of the UART,
+ *     issues an 8-byte Get from the UART before its bytes arrive, then Gets from the memory:
+ *     those are answered while the UART Get waits, out of order,
+ *     sends the bytes of the UART Get over rx.
+ * Fails unless the memory (every round, and all of it at the end), tx and the UART Gets return
+ * the bytes written, and the memory Gets complete before the UART Get.
+ * 
+ * usage: tlul_uart_xbar_check [number of rounds] [seed]
+ */
+
+#include "tlul_testbench.hpp"
+#include "uart_testbench.hpp"
+#include "clock_driver.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <hdl_tlul_uart_xbar.h>
+
+double main_time = 0;
+
+double sc_time_stamp() { return main_time; }
+
+// as in tlul_uart_xbar.sv
+constexpr std::size_t clks_per_bit = 2;
+constexpr std::size_t memory_size = 1024;
+constexpr std::uint32_t uart_address = 1024;
+
+using hdl = hdl_tlul_uart_xbar;
+using testbench = tlul_testbench<hdl>;
+
+int main(int argc, char **argv) {
+    std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+    std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    
+    Verilated::commandArgs(argc, argv);
+    
+    auto top = std::make_unique<hdl>();
+    testbench tb{top.get()};
+    verilator_aux::clock_driver<hdl> driver{top.get()};
+    
+    std::vector<std::uint8_t> transmitted;
+    auto uart_sender = uart::make_sender(&(top->CLK), &(top->rx), clks_per_bit);
+    auto uart_receiver = uart::make_receiver(
+        [&transmitted](std::uint8_t c) { transmitted.push_back(c); },
+        &(top->CLK), &(top->tx), clks_per_bit);
+    
+    tb.attach(driver);
+    uart_sender.attach(driver);
+    uart_receiver.attach(driver);
+    
+    std::mt19937_64 rng{seed};
+    
+    // the bytes put to tx and sent over rx, and the bytes the UART Gets returned
+    std::vector<std::uint8_t> put;
+    std::vector<std::uint8_t> sent;
+    std::vector<std::uint8_t> received;
+    
+    // see the initial block of tlul_slave_memory_pipelined
+    std::vector<std::uint8_t> shadow(memory_size);
+    for (std::size_t i = 0; i < memory_size; ++i)
+        shadow[i] = std::uint8_t(i);
+    
+    std::uint64_t const timeout = 100 * 10 * clks_per_bit;
+    bool ok = true;
+    
+    for (std::size_t r = 0; r < rounds && ok; ++r) {
+        // a block of the memory, and 8 bytes to tx
+        std::size_t offset = rng() % (memory_size - 64);
+        std::size_t n = 1 + rng() % 64;
+        for (std::size_t i = 0; i < n; ++i)
+            shadow[offset + i] = std::uint8_t(rng());
+        tb.write_block([]{  }, testbench::address_type(offset),
+            testbench::bytes{shadow.data() + offset, n});
+        
+        std::array<std::uint8_t, 8> data;
+        for (auto &d: data)
+            put.push_back(d = std::uint8_t(rng()));
+        tb.put_full_data([]{  }, uart_address, testbench::size_type(3),
+            testbench::mask_type(0xff), testbench::bytes{data.data(), data.size()});
+        
+        // the UART Get first, the memory Gets are answered while it waits
+        bool uart_done = false;
+        bool memory_done = false;
+        tb.get([&](testbench::bytes v) {
+                received.insert(received.end(), v.begin(), v.end());
+                uart_done = true;
+            }, uart_address, testbench::size_type(3), testbench::mask_type(0xff));
+        
+        std::vector<std::uint8_t> read(n);
+        tb.read_block([&] { memory_done = true; }, testbench::address_type(offset), read);
+        
+        // the bytes of the UART Get are not sent yet
+        ok = driver.run_until([&] { return memory_done; }, timeout) && !uart_done && ok;
+        
+        for (auto &d: data)
+            sent.push_back(d = std::uint8_t(rng()));
+        uart_sender.write(verilator_aux::span<std::uint8_t const>{data.data(), data.size()});
+        
+        ok = driver.run_until([&] { return tb.idle() && transmitted.size() == put.size(); },
+            timeout) && ok;
+        ok = ok && uart_done && std::equal(read.begin(), read.end(), shadow.begin() + offset);
+    }
+    
+    // the whole memory at the end
+    std::vector<std::uint8_t> memory(memory_size);
+    tb.read_block([]{  }, 0, memory);
+    ok = driver.run_until([&] { return tb.idle(); }, 100 * memory_size) && ok;
+    
+    std::cout << "rounds:                    " << rounds << "\n";
+    std::cout << "bytes to tx / from rx:     " << transmitted.size() << " / " << received.size()
+        << "\n";
+    std::cout << "cycles:                    " << driver.cycle() << std::endl;
+    
+    top->final();
+    
+    ok = ok && memory == shadow && transmitted == put && received == sent;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
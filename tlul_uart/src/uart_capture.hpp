@@ -0,0 +1,266 @@
+/**
+ * @author Canberk Sönmez
+ * @file uart_capture.hpp
+ * @brief A binary sink for the bytes of a uart::receiver, instead of printing them one by one.
+ * 
+ * capture keeps each byte with the cycle it was received in. In memory, the buffers are sized
+ * up front; with a file, a batch is collected and written with a single fwrite() once full:
+ *     <path>           the received bytes, as they are,
+ *     <path>.cycles    the cycle of each byte, as native std::uint64_t (if stamps are kept).
+ * close() writes the last batch and reports any error; the destructor does the same for a
+ * capture which is not closed, but cannot report an error.
+ * compare() and compare_files() check received bytes against the sent stream, byte for byte
+ * (see also uart_capture_diff).
+ */
+
+#ifndef UART_CAPTURE_HPP_INCLUDED
+#define UART_CAPTURE_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "verilator_aux.hpp"
+
+namespace uart {
+
+// an open FILE, closed with the handle
+struct file {
+    explicit file(std::FILE *f = nullptr):
+        f{f} {
+    }
+    
+    file(file &&other) noexcept:
+        f{other.f} {
+        other.f = nullptr;
+    }
+    
+    file &operator=(file &&other) noexcept {
+        std::swap(f, other.f);
+        return *this;
+    }
+    
+    ~file() {
+        if (f)
+            std::fclose(f);
+    }
+    
+    explicit operator bool() const {
+        return f != nullptr;
+    }
+    
+    /**
+     * @brief Closes the file now.
+     * @returns false if fclose() failed, the last writes may be lost.
+     */
+    bool close() {
+        auto closed = std::exchange(f, nullptr);
+        return !closed || std::fclose(closed) == 0;
+    }
+    
+    std::FILE *f;
+};
+
+struct capture {
+    static constexpr std::size_t default_batch = 1 << 16;
+    
+    /**
+     * @brief Captures into memory.
+     * @param reserve number of bytes the buffers are sized for, they grow beyond it
+     */
+    explicit capture(std::size_t reserve = default_batch) {
+        bytes_buffer.reserve(reserve);
+        cycles_buffer.reserve(reserve);
+    }
+    
+    /**
+     * @brief Captures into <path> (and <path>.cycles if stamps is true), batch bytes at a time.
+     */
+    capture(std::string const &path, bool stamps, std::size_t batch = default_batch):
+        batch{std::max<std::size_t>(batch, 1)},
+        stamps{stamps},
+        bytes_file{open(path)},
+        cycles_file{stamps ? open(path + ".cycles") : file{}} {
+        bytes_buffer.reserve(this->batch);
+        cycles_buffer.reserve(this->batch);
+    }
+    
+    capture(capture const &) = delete;
+    capture &operator=(capture const &) = delete;
+    
+    ~capture() {
+        // an error is lost here, close() reports it
+        try {
+            flush();
+        }
+        catch (std::exception const &) {
+        }
+    }
+    
+    void push(std::uint64_t cycle, std::uint8_t byte) {
+        bytes_buffer.push_back(byte);
+        if (stamps)
+            cycles_buffer.push_back(cycle);
+        ++count;
+        
+        if (bytes_file && bytes_buffer.size() == batch)
+            flush();
+    }
+    
+    /**
+     * @returns a callback for uart::make_receiver, which stamps the bytes with driver.cycle().
+     */
+    template <typename Driver>
+    auto sink(Driver const &driver) {
+        return [this, &driver](std::uint8_t byte) { push(driver.cycle(), byte); };
+    }
+    
+    /**
+     * @brief Writes the collected batch to the files, nothing to do in memory.
+     */
+    void flush() {
+        if (!bytes_file)
+            return;
+        write(bytes_file, bytes_buffer.data(), bytes_buffer.size());
+        bytes_buffer.clear();
+        if (cycles_file) {
+            write(cycles_file, cycles_buffer.data(), cycles_buffer.size());
+            cycles_buffer.clear();
+        }
+    }
+    
+    /**
+     * @brief Writes the collected batch and closes the files, throws if either fails. Bytes
+     * pushed afterwards stay in memory.
+     */
+    void close() {
+        flush();
+        bool closed = bytes_file.close();
+        closed = cycles_file.close() && closed;
+        if (!closed)
+            throw std::runtime_error("uart::capture: close failed");
+    }
+    
+    /**
+     * @returns number of bytes captured so far.
+     */
+    std::uint64_t size() const {
+        return count;
+    }
+    
+    /**
+     * @returns the bytes in memory: all of them, or the batch not yet written to the file.
+     */
+    verilator_aux::span<std::uint8_t const> bytes() const {
+        return bytes_buffer;
+    }
+    
+    verilator_aux::span<std::uint64_t const> cycles() const {
+        return cycles_buffer;
+    }
+private:
+    static file open(std::string const &path) {
+        file f{std::fopen(path.c_str(), "wb")};
+        if (!f)
+            throw std::runtime_error("uart::capture: cannot open " + path);
+        
+        // the batches are the buffer
+        std::setvbuf(f.f, nullptr, _IONBF, 0);
+        return f;
+    }
+    
+    template <typename T>
+    static void write(file const &f, T const *data, std::size_t n) {
+        if (n != 0 && std::fwrite(data, sizeof(T), n, f.f) != n)
+            throw std::runtime_error("uart::capture: write failed");
+    }
+    
+    std::size_t batch {default_batch};
+    bool stamps {true};
+    std::uint64_t count {0};
+    
+    std::vector<std::uint8_t> bytes_buffer;
+    std::vector<std::uint64_t> cycles_buffer;
+    file bytes_file;
+    file cycles_file;
+};
+
+struct comparison {
+    static constexpr std::uint64_t npos = std::numeric_limits<std::uint64_t>::max();
+    
+    std::uint64_t sent {0};
+    std::uint64_t received {0};
+    
+    // index of the first differing byte, or of the first missing/extra byte; npos if equal
+    std::uint64_t first_mismatch {npos};
+    
+    bool equal() const {
+        return first_mismatch == npos;
+    }
+};
+
+/**
+ * @brief Compares the received bytes with the sent ones.
+ */
+inline comparison compare(
+        verilator_aux::span<std::uint8_t const> sent,
+        verilator_aux::span<std::uint8_t const> received) {
+    comparison c;
+    c.sent = sent.size();
+    c.received = received.size();
+    
+    std::size_t n = std::min(sent.size(), received.size());
+    auto m = std::mismatch(sent.begin(), sent.begin() + n, received.begin());
+    if (m.first != sent.begin() + n)
+        c.first_mismatch = std::uint64_t(m.first - sent.begin());
+    else if (sent.size() != received.size())
+        c.first_mismatch = n;
+    return c;
+}
+
+/**
+ * @brief Compares two files of bytes, a block at a time.
+ */
+inline comparison compare_files(std::string const &sent_path, std::string const &received_path) {
+    file sent{std::fopen(sent_path.c_str(), "rb")};
+    file received{std::fopen(received_path.c_str(), "rb")};
+    if (!sent.f || !received.f)
+        throw std::runtime_error("uart::compare_files: cannot open " +
+            (sent.f ? received_path : sent_path));
+    
+    constexpr std::size_t block_size = 1 << 16;
+    
+    comparison c;
+    std::vector<std::uint8_t> a(block_size), b(block_size);
+    for (;;) {
+        auto na = std::fread(a.data(), 1, a.size(), sent.f);
+        auto nb = std::fread(b.data(), 1, b.size(), received.f);
+        auto block = compare({a.data(), na}, {b.data(), nb});
+        
+        if (!block.equal() && c.equal())
+            c.first_mismatch = c.sent + block.first_mismatch;
+        c.sent += na;
+        c.received += nb;
+        
+        if (na < a.size() || nb < b.size()) {
+            // the rest of the longer file only counts
+            while ((na = std::fread(a.data(), 1, a.size(), sent.f)) > 0)
+                c.sent += na;
+            while ((nb = std::fread(b.data(), 1, b.size(), received.f)) > 0)
+                c.received += nb;
+            break;
+        }
+    }
+    if (c.equal() && c.sent != c.received)
+        c.first_mismatch = std::min(c.sent, c.received);
+    return c;
+}
+
+}
+
+#endif // UART_CAPTURE_HPP_INCLUDED
@@ -0,0 +1,50 @@
+/**
+ * @author Canberk Sönmez
+ * @file uart_capture_diff.cpp
+ * @brief Compares a sent byte stream with the bytes captured by uart::capture, without any text
+ * conversion. With the .cycles file of the capture, reports the cycle of the first mismatch.
+ * 
+ * usage: uart_capture_diff <sent file> <captured file> [<captured file>.cycles]
+ */
+
+#include "uart_capture.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <sent file> <captured file> [<cycles file>]\n";
+        return EXIT_FAILURE;
+    }
+    
+    try {
+        auto c = uart::compare_files(argv[1], argv[2]);
+        
+        std::cout << "sent:                      " << c.sent << "\n";
+        std::cout << "received:                  " << c.received << "\n";
+        if (c.equal()) {
+            std::cout << "equal" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        
+        std::cout << "first mismatch at byte:    " << c.first_mismatch << "\n";
+        if (argc > 3 && c.first_mismatch < c.received) {
+            std::uint64_t cycle;
+            auto f = std::fopen(argv[3], "rb");
+            if (f && std::fseek(f, long(c.first_mismatch * sizeof(cycle)), SEEK_SET) == 0 &&
+                    std::fread(&cycle, sizeof(cycle), 1, f) == 1)
+                std::cout << "received in cycle:         " << cycle << "\n";
+            if (f)
+                std::fclose(f);
+        }
+        std::cout << std::flush;
+    }
+    catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    return EXIT_FAILURE;
+}
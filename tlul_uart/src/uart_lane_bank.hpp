@@ -0,0 +1,268 @@
+/**
+ * @author Canberk Sönmez
+ * @file uart_lane_bank.hpp
+ * @brief N UART lanes (a sender and a receiver each) in one object, for simulations with many
+ * channels. The state of all lanes is kept as structure of arrays, and a clock cycle advances
+ * every lane in one branch-free loop over those arrays; only starting a byte (a FIFO pop) and
+ * completing one (the receive callback) are done lane by lane, on the cycles which need them.
+ * 
+ * The timing on tx and the bytes taken from rx are the same as with N uart::sender and
+ * uart::receiver instances. The pins are the arrays tx and rx of the bank, copied to and from
+ * the model by the caller.
+ */
+
+#ifndef UART_LANE_BANK_HPP_INCLUDED
+#define UART_LANE_BANK_HPP_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "verilator_aux.hpp"
+#include "clock_driver.hpp"
+#include "inplace_function.hpp"
+
+namespace uart {
+
+template <std::size_t N>
+struct lane_bank {
+    using callback_type = verilator_aux::inplace_function<void (std::size_t, std::uint8_t)>;
+    using bytes = verilator_aux::span<std::uint8_t const>;
+    
+    static constexpr std::size_t lanes = N;
+    static constexpr std::size_t default_capacity = 256;
+    
+    /**
+     * @param cycles_per_bit of every lane, see set_cycles_per_bit()
+     * @param capacity of the FIFO of each lane in bytes, rounded up to a power of 2. It never
+     * grows.
+     */
+    explicit lane_bank(std::size_t cycles_per_bit, std::size_t capacity = default_capacity) {
+        std::size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        fifo.resize(N * cap);
+        fifo_mask = cap - 1;
+        
+        tx.fill(1);
+        rx.fill(1);
+        for (std::size_t i = 0; i < N; ++i)
+            set_cycles_per_bit(i, cycles_per_bit);
+    }
+    
+    /**
+     * @brief Called with (lane, byte) for every byte received, in the order of the lanes.
+     */
+    template <typename Callback>
+    void on_receive(Callback &&callback) {
+        received_callback = std::forward<Callback>(callback);
+    }
+    
+    /**
+     * @brief Changes the baud rate of a lane from its next byte on, each way.
+     */
+    void set_cycles_per_bit(std::size_t lane, std::size_t n) {
+        if (n == 0 || n > UINT32_MAX)
+            throw std::runtime_error("uart::lane_bank: cycles_per_bit out of range");
+        cycles_per_bit[lane] = std::uint32_t(n);
+    }
+    
+    bool ongoing(std::size_t lane) const {
+        return pending[lane] != 0;
+    }
+    
+    std::size_t space(std::size_t lane) const {
+        return fifo_mask + 1 - pending[lane];
+    }
+    
+    /**
+     * @brief Queues as many bytes as fit into the FIFO of the lane.
+     * @returns number of bytes queued.
+     */
+    std::size_t write(std::size_t lane, bytes data) {
+        std::size_t n = std::min(data.size(), space(lane));
+        auto base = lane * (fifo_mask + 1);
+        for (std::size_t i = 0; i < n; ++i)
+            fifo[base + ((head[lane] + pending[lane] + i) & fifo_mask)] = std::uint8_t(data[i]);
+        pending[lane] += std::uint32_t(n);
+        return n;
+    }
+    
+    std::uint64_t sent(std::size_t lane) const {
+        return sent_count[lane];
+    }
+    
+    std::uint64_t received(std::size_t lane) const {
+        return received_count[lane];
+    }
+    
+    /**
+     * @brief Runs the bank on a clock_driver: receive() before the main model, send() after
+     * it. The bank must not move afterwards.
+     */
+    template <typename Driver>
+    void attach(Driver &driver) {
+        using verilator_aux::edge_hook;
+        
+        driver.on(edge_hook::before_posedge, [this] { receive(); });
+        driver.on(edge_hook::after_posedge, [this] { send(); });
+    }
+    
+    void posedge() {
+        receive();
+        send();
+    }
+    
+    // the rising edge of the receivers, samples rx
+    void receive() {
+        // BEGIN all lanes, as uart::receiver::posedge()
+        //     phase 0: idle, 1: start bit, 2..9: data bits, 10: stop bit, 11: cleanup
+        // the conditions are masks (all ones or 0) and the byte is a shift register, so that
+        // the loop has neither branches nor variable shifts
+        
+        std::uint32_t done = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            std::uint32_t p = r_phase[i];
+            std::uint32_t c = r_count[i];
+            std::uint32_t r = rx[i] & 1u;
+            std::uint32_t cycles = r_cycles[i];
+            
+            std::uint32_t idle = mask(p == 0);
+            std::uint32_t start = mask(p == 1);
+            std::uint32_t framing = mask(p - 1u < 10u);
+            
+            // the start bit is checked in its middle
+            std::uint32_t target = (((cycles - 1) >> 1) & start) | ((cycles - 1) & ~start);
+            std::uint32_t hit = framing & mask(c >= target);
+            std::uint32_t sample = hit & mask(p - 2u < 8u);
+            
+            r_count[i] = (c + 1) & framing & ~hit;
+            r_byte[i] = (((r_byte[i] >> 1) | (r << 7)) & sample) | (r_byte[i] & ~sample & ~idle);
+            r_cycles[i] = (cycles_per_bit[i] & idle) | (cycles & ~idle);
+            r_phase[i] = ((1u - r) & idle) |
+                ((p + (hit & 1u)) & ~idle & ~(start & hit & (0u - r)));
+            
+            // as of the start of the cycle, a byte entering cleanup now completes next cycle
+            r_done[i] = p == 11;
+            done |= r_done[i];
+        }
+        
+        // END
+        
+        if (!done)
+            return;
+        auto n = flagged(r_done);
+        for (std::size_t k = 0; k < n; ++k) {
+            auto i = lane_list[k];
+            r_phase[i] = 0;
+            ++received_count[i];
+            if (received_callback)
+                received_callback(i, std::uint8_t(r_byte[i]));
+        }
+    }
+    
+    // the rising edge of the senders, drives tx
+    void send() {
+        // BEGIN all lanes, as uart::sender::posedge()
+        //     phase 0: idle, 1: start bit, 2..9: data bits, 10: stop bit, 11: cleanup
+        
+        std::uint32_t service = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            std::uint32_t p = s_phase[i];
+            std::uint32_t c = s_count[i];
+            std::uint32_t frame = s_frame[i];
+            
+            std::uint32_t framing = mask(p - 1u < 10u);
+            std::uint32_t last = framing & mask(c + 1 >= s_cycles[i]);
+            
+            // the frame is shifted out, a bit per bit time
+            tx[i] = (frame | ~framing) & 1u;
+            s_frame[i] = ((frame >> 1) & last) | (frame & ~last);
+            s_count[i] = (c + 1) & framing & ~last;
+            s_phase[i] = p + (last & 1u);
+            
+            // as of the start of the cycle, as for the receivers
+            s_service[i] = ((p == 0) & (pending[i] != 0)) | (p == 11);
+            service |= s_service[i];
+        }
+        
+        // END
+        
+        if (!service)
+            return;
+        auto n = flagged(s_service);
+        for (std::size_t k = 0; k < n; ++k) {
+            auto i = lane_list[k];
+            if (s_phase[i] == 11) {
+                // the byte in front is sent
+                head[i] = (head[i] + 1) & fifo_mask;
+                --pending[i];
+                ++sent_count[i];
+                s_phase[i] = 0;
+            }
+            else {
+                // start bit, 8 data bits (LSB first), stop bit
+                std::uint32_t byte = fifo[i * (fifo_mask + 1) + head[i]];
+                s_frame[i] = (byte << 1) | (1u << 9);
+                s_cycles[i] = cycles_per_bit[i];
+                s_phase[i] = 1;
+            }
+        }
+    }
+    
+    // the pins, as wide as the state (so that the loops over the lanes vectorize)
+    std::array<std::uint32_t, N> tx;
+    std::array<std::uint32_t, N> rx;
+private:
+    template <typename T>
+    using lane_array = std::array<T, N>;
+    
+    static std::uint32_t mask(bool condition) {
+        return 0u - std::uint32_t(condition);
+    }
+    
+    // collects the lanes with a flag set into lane_list, without a branch per lane
+    std::size_t flagged(lane_array<std::uint32_t> const &flags) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            lane_list[n] = std::uint32_t(i);
+            n += flags[i] != 0;
+        }
+        return n;
+    }
+    
+    lane_array<std::uint32_t> cycles_per_bit {};
+    
+    // senders
+    lane_array<std::uint32_t> s_phase {};
+    lane_array<std::uint32_t> s_count {};
+    lane_array<std::uint32_t> s_cycles {};     // taken at the start of the byte
+    lane_array<std::uint32_t> s_frame {};
+    lane_array<std::uint32_t> s_service {};    // a byte completes or starts
+    
+    // receivers
+    lane_array<std::uint32_t> r_phase {};
+    lane_array<std::uint32_t> r_count {};
+    lane_array<std::uint32_t> r_cycles {};     // taken at the start bit
+    lane_array<std::uint32_t> r_byte {};
+    lane_array<std::uint32_t> r_done {};
+    
+    // the FIFOs, fifo_mask + 1 bytes per lane; the front byte is being sent
+    std::vector<std::uint8_t> fifo;
+    std::size_t fifo_mask {0};
+    lane_array<std::uint32_t> head {};
+    lane_array<std::uint32_t> pending {};
+    
+    lane_array<std::uint64_t> sent_count {};
+    lane_array<std::uint64_t> received_count {};
+    lane_array<std::uint32_t> lane_list {};
+    
+    callback_type received_callback;
+};
+
+}
+
+#endif // UART_LANE_BANK_HPP_INCLUDED
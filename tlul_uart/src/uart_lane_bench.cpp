@@ -0,0 +1,155 @@
+/**
+ * @author Canberk Sönmez
+ * @file uart_lane_bench.cpp
+ * @brief Cost per lane and cycle of N UART lanes, N = 1..256: N uart::sender/uart::receiver
+ * instances against one uart::lane_bank<N>. Each lane is looped back (tx to rx) and kept busy,
+ * lane i at 2 + i % 5 cycles per bit. Fails unless both deliver the same bytes on every lane.
+ * 
+ * usage: uart_lane_bench [number of cycles]
+ */
+
+#include "uart_testbench.hpp"
+#include "uart_lane_bank.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// bytes received on a lane
+struct lane_result {
+    std::uint64_t count {0};
+    std::uint64_t sum {0};
+    
+    void push(std::uint8_t byte) {
+        sum = sum * 31 + byte;
+        ++count;
+    }
+    
+    bool operator==(lane_result const &other) const {
+        return count == other.count && sum == other.sum;
+    }
+};
+
+struct result {
+    double seconds;
+    std::vector<lane_result> lanes;
+};
+
+constexpr std::size_t refill_period = 1024;
+
+std::size_t cycles_per_bit(std::size_t lane) {
+    return 2 + lane % 5;
+}
+
+std::uint8_t pattern(std::size_t lane, std::uint64_t i) {
+    return std::uint8_t(i * 7 + lane);
+}
+
+// each lane is its own pair of instances, with its own pins
+result run_instances(std::size_t n, std::uint64_t cycles) {
+    struct lane {
+        explicit lane(std::size_t i, std::vector<lane_result> &results):
+            sender{&clk, &tx, cycles_per_bit(i)},
+            receiver{[&results, i](std::uint8_t c) { results[i].push(c); }, &clk, &rx,
+                cycles_per_bit(i)} {}
+        
+        std::uint8_t clk {1};
+        std::uint8_t tx {1};
+        std::uint8_t rx {1};
+        std::uint64_t written {0};
+        uart::sender<std::uint8_t, std::uint8_t> sender;
+        uart::receiver<std::uint8_t, std::uint8_t> receiver;
+    };
+    
+    result r{0, std::vector<lane_result>(n)};
+    std::vector<std::unique_ptr<lane>> lanes;
+    for (std::size_t i = 0; i < n; ++i)
+        lanes.emplace_back(new lane{i, r.lanes});
+    
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::uint64_t c = 0; c < cycles; ++c) {
+        if (c % refill_period == 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                auto &l = *lanes[i];
+                while (l.sender.space() != 0) {
+                    auto byte = pattern(i, l.written++);
+                    l.sender.write(verilator_aux::span<std::uint8_t const>{&byte, 1});
+                }
+            }
+        }
+        
+        for (auto &l: lanes) {
+            l->receiver.posedge();
+            l->sender.posedge();
+            l->rx = l->tx;
+        }
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+template <std::size_t N>
+result run_bank(std::uint64_t cycles) {
+    using bank_type = uart::lane_bank<N>;
+    
+    result r{0, std::vector<lane_result>(N)};
+    auto bank = std::make_unique<bank_type>(2);
+    bank->on_receive([&r](std::size_t lane, std::uint8_t c) { r.lanes[lane].push(c); });
+    std::array<std::uint64_t, N> written {};
+    for (std::size_t i = 0; i < N; ++i)
+        bank->set_cycles_per_bit(i, cycles_per_bit(i));
+    
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::uint64_t c = 0; c < cycles; ++c) {
+        if (c % refill_period == 0) {
+            for (std::size_t i = 0; i < N; ++i) {
+                while (bank->space(i) != 0) {
+                    auto byte = pattern(i, written[i]++);
+                    bank->write(i, verilator_aux::span<std::uint8_t const>{&byte, 1});
+                }
+            }
+        }
+        
+        bank->posedge();
+        bank->rx = bank->tx;
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+template <std::size_t N>
+bool measure(std::uint64_t cycles) {
+    auto instances = run_instances(N, cycles);
+    auto bank = run_bank<N>(cycles);
+    
+    double lane_cycles = double(N) * cycles;
+    std::cout << "lanes " << N << ":\n";
+    std::cout << "    instances [ns/lane/cycle]: " << 1e9 * instances.seconds / lane_cycles << "\n";
+    std::cout << "    lane_bank [ns/lane/cycle]: " << 1e9 * bank.seconds / lane_cycles << "\n";
+    std::cout << "    speed-up:                  " << instances.seconds / bank.seconds
+        << std::endl;
+    
+    return instances.lanes == bank.lanes && bank.lanes[0].count > 0;
+}
+
+int main(int argc, char **argv) {
+    std::uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    
+    std::cout << "cycles:                        " << cycles << "\n";
+    bool ok = measure<1>(cycles);
+    ok = measure<2>(cycles) && ok;
+    ok = measure<4>(cycles) && ok;
+    ok = measure<8>(cycles) && ok;
+    ok = measure<16>(cycles) && ok;
+    ok = measure<32>(cycles) && ok;
+    ok = measure<64>(cycles) && ok;
+    ok = measure<128>(cycles) && ok;
+    ok = measure<256>(cycles) && ok;
+    
+    // both must simulate the same thing
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
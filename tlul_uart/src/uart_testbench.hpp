@@ -3,6 +3,14 @@
  * @file uart_testbench.hpp
  * @brief A UART wrapper for C++, which facilitates writing tests involving UART.
  * modelled after the given Verilog codes, the same constraints also apply here.
+ * 
+ * The sender sends from a fixed-capacity byte FIFO. Bytes may be written at any time, while
+ * there is room; the callback of a chunk is called once its last byte is sent. The callbacks
+ * wait in a ring of their own, much smaller than the FIFO: most writers chain one chunk at a
+ * time. Nothing allocates after construction.
+ * 
+ * Like uart_rx and uart_tx, the sender and the receiver take cycles_per_bit at the start of each
+ * byte; set_cycles_per_bit() follows the divisor register of tlul_uart.
  */
 
 #ifndef UART_TESTBENCH_HPP_INCLUDED
@@ -10,157 +18,314 @@
 
 #include <cstdint>
 #include <stdexcept>
+#include <string>
 #include <vector>
-#include <utility>
+#include <algorithm>
 #include <functional>
-#include <memory>
 #include <utility>
 
 #include "verilator_aux.hpp"
+#include "clock_driver.hpp"
+#include "inplace_function.hpp"
+#include "ring_buffer.hpp"
 
 namespace uart {
 
 template <typename CLK, typename TX>
 struct sender {
-    sender(CLK *clk, TX *tx, std::size_t cycles_per_bit):
+    using callback_type = verilator_aux::inplace_function<void ()>;
+    using bytes = verilator_aux::span<std::uint8_t const>;
+    
+    static constexpr std::size_t default_capacity = 4096;
+    static constexpr std::size_t default_chunks = 64;
+    
+    /**
+     * @param capacity of the FIFO in bytes, rounded up to a power of 2. It never grows.
+     * @param chunks chunks with a callback which may wait at once, rounded up to a power of 2
+     */
+    sender(CLK *clk, TX *tx, std::size_t cycles_per_bit,
+            std::size_t capacity = default_capacity, std::size_t chunks = default_chunks):
         clk{clk},
         tx{tx},
-        cycles_per_bit{cycles_per_bit} {
+        cycles_per_bit{cycles_per_bit},
+        fifo{capacity},
+        chunks{chunks} {
         if (clk == nullptr || tx == nullptr)
             throw std::runtime_error("uart::sender nullptr");
     }
     
+    /**
+     * @returns true if a byte is queued or being sent.
+     */
     bool ongoing() const {
-        return callback != nullptr;
+        return !fifo.empty();
     }
     
-    template <typename Callback>
-    bool write_byte(std::uint8_t byte, Callback &&callback) {
-        if (ongoing())
-            return false;
-        this->byte = byte;
-        this->callback = std::forward<Callback>(callback);
-        if (!this->callback)
-            return false;
-        return true;
+    /**
+     * @returns number of bytes which can be written now.
+     */
+    std::size_t space() const {
+        return fifo.capacity() - fifo.size();
+    }
+    
+    /**
+     * @brief Changes the baud rate from the next byte on, the byte being sent keeps its rate.
+     */
+    void set_cycles_per_bit(std::size_t n) {
+        if (n == 0)
+            throw std::runtime_error("uart::sender: cycles_per_bit is 0");
+        cycles_per_bit = n;
+    }
+    
+    /**
+     * @brief Queues as many bytes as fit into the FIFO, without a callback.
+     * @returns number of bytes queued.
+     */
+    std::size_t write(bytes data) {
+        std::size_t n = std::min(data.size(), space());
+        for (std::size_t i = 0; i < n; ++i)
+            fifo.try_push(std::uint8_t(data[i]));
+        queued += n;
+        return n;
     }
     
+    /**
+     * @brief Queues a chunk of bytes, the callback is called once its last byte is sent. The
+     * callback may write again.
+     * @returns false (and queues nothing) if the chunk does not fit into the FIFO, or if it has a
+     * callback and the ring of callbacks is full.
+     */
     template <typename Callback>
-    bool write_bytes(std::vector<std::uint8_t> data, Callback &&callback) {
-        if (ongoing())
+    bool write_bytes(bytes data, Callback &&callback) {
+        if (data.size() > space())
             return false;
         
-        struct write_structure: std::enable_shared_from_this<write_structure> {
-            sender *s;
-            std::vector<std::uint8_t> data;
-            std::function<void ()> callback;
-            std::size_t idx{0};
-            
-            void start() {
-                if (idx == data.size()) {
-                    // write is complete
-                    callback();
-                    return ;
-                }
-                s->write_byte(data[idx], [this, _ = this->shared_from_this()] {
-                    ++idx;
-                    start();
-                });
-            }
-        };
+        callback_type cb{std::forward<Callback>(callback)};
+        if (cb && !data.empty() && chunks.full())
+            return false;
         
-        auto w = std::make_shared<write_structure>();
-        w->s = this;
-        w->data = std::move(data);
-        w->callback = std::move(callback);
-        w->idx = 0;
-        w->start();
+        write(data);
+        if (data.empty()) {
+            if (cb)
+                cb();
+        }
+        else if (cb) {
+            chunks.try_emplace(chunk{queued, std::move(cb)});
+        }
+        return true;
     }
     
     template <typename Callback>
     bool write_bytes(std::string const &str, Callback &&callback) {
-        return write_bytes(std::vector<std::uint8_t>(
-            str.begin(), str.end()), std::forward<Callback>(callback));
+        return write_bytes(
+            bytes{reinterpret_cast<std::uint8_t const *>(str.data()), str.size()},
+            std::forward<Callback>(callback));
+    }
+    
+    template <typename Callback>
+    bool write_byte(std::uint8_t byte, Callback &&callback) {
+        return write_bytes(bytes{&byte, 1}, std::forward<Callback>(callback));
     }
     
     // must be called after the main model
     void eval() {
+        if (*clk) {
+            posedge();
+        }
+    }
+    
+    /**
+     * @brief Runs the sender on a clock_driver, after the main model. The sender must not move
+     * afterwards.
+     * 
+     * Only the idle state is checked every rising edge; once a byte is started, the edges on
+     * which tx changes are scheduled, about 10 wake-ups per byte instead of 10 * cycles_per_bit.
+     * The timing on tx is the same as with eval().
+     */
+    template <typename Driver>
+    void attach(Driver &driver) {
+        using verilator_aux::edge_hook;
+        
+        auto d = &driver;
+        driver.on(edge_hook::after_posedge, [this, d] { idle(*d); }, true);
+        timer = driver.add_timer(edge_hook::after_posedge, [this, d] { wake(*d); });
+        driver.on_quiet([this] { return quiet(); }, [](std::uint64_t) {});
+    }
+    
+    /**
+     * @returns quiescence::forever, unless a byte is about to be started. The scheduled edges
+     * end a fast-forwarded window by themselves.
+     */
+    verilator_aux::quiescence quiet() const {
         using namespace verilator_aux;
         
-        if (*clk) {
-            switch (r_SM_Main) {
-                case s_IDLE: {
-                    *tx = 1;
-                    r_Clock_Count = 0;
-                    r_Bit_Index = 0;
-                    
-                    if (callback /* write requested */) {
-                        r_SM_Main = s_TX_START_BIT;
-                    }
-                    break;
+        if (r_SM_Main == s_IDLE && (!fifo.empty() || *tx != 1))
+            return {};
+        return {quiescence::forever};
+    }
+    
+    // the rising edge half of eval()
+    void posedge() {
+        using namespace verilator_aux;
+        
+        switch (r_SM_Main) {
+            case s_IDLE: {
+                *tx = 1;
+                r_Clock_Count = 0;
+                r_Bit_Index = 0;
+                
+                if (!fifo.empty() /* write requested */) {
+                    byte = fifo.front();
+                    r_Clks_Per_Bit = cycles_per_bit;
+                    r_SM_Main = s_TX_START_BIT;
                 }
-                case s_TX_START_BIT: {
-                    *tx = 0;
-                    if (r_Clock_Count < cycles_per_bit - 1) {
-                        ++r_Clock_Count;
-                    }
-                    else {
-                        r_Clock_Count = 0;
-                        r_SM_Main = s_TX_DATA_BITS;
-                    }
-                    break;
+                break;
+            }
+            case s_TX_START_BIT: {
+                *tx = 0;
+                if (r_Clock_Count < r_Clks_Per_Bit - 1) {
+                    ++r_Clock_Count;
                 }
-                case s_TX_DATA_BITS: {
-                    *tx = get_bit(byte, r_Bit_Index);
-                    
-                    if (r_Clock_Count < cycles_per_bit - 1) {
-                        ++r_Clock_Count;
-                    }
-                    else {
-                        r_Clock_Count = 0;
-                        if (r_Bit_Index < 7) {
-                            r_Bit_Index = r_Bit_Index + 1;
-                        }
-                        else {
-                            r_Bit_Index = 0;
-                            r_SM_Main = s_TX_STOP_BIT;
-                        }
-                    }
-                    break;
+                else {
+                    r_Clock_Count = 0;
+                    r_SM_Main = s_TX_DATA_BITS;
+                }
+                break;
+            }
+            case s_TX_DATA_BITS: {
+                *tx = get_bit(byte, r_Bit_Index);
+                
+                if (r_Clock_Count < r_Clks_Per_Bit - 1) {
+                    ++r_Clock_Count;
                 }
-                case s_TX_STOP_BIT: {
-                    *tx = 1;
-                    if (r_Clock_Count < cycles_per_bit - 1) {
-                        ++r_Clock_Count;
+                else {
+                    r_Clock_Count = 0;
+                    if (r_Bit_Index < 7) {
+                        r_Bit_Index = r_Bit_Index + 1;
                     }
                     else {
-                        r_Clock_Count = 0;
-                        r_SM_Main = s_CLEANUP;
+                        r_Bit_Index = 0;
+                        r_SM_Main = s_TX_STOP_BIT;
                     }
-                    break;
                 }
-                case s_CLEANUP: {
-                    auto cb = std::move(callback);
-                    callback = nullptr;
-                    cb();   // to allow setting from callback function, callback = nullptr avoided
-                    r_SM_Main = s_IDLE;
-                    break;
+                break;
+            }
+            case s_TX_STOP_BIT: {
+                *tx = 1;
+                if (r_Clock_Count < r_Clks_Per_Bit - 1) {
+                    ++r_Clock_Count;
                 }
-                default: {
-                    r_SM_Main = s_IDLE;
-                    break;
+                else {
+                    r_Clock_Count = 0;
+                    r_SM_Main = s_CLEANUP;
                 }
+                break;
+            }
+            case s_CLEANUP: {
+                complete();
+                r_SM_Main = s_IDLE;
+                break;
+            }
+            default: {
+                r_SM_Main = s_IDLE;
+                break;
             }
         }
     }
 private:
+    // BEGIN scheduled (attach), r_SM_Main is the state entered at the next wake-up
+    
+    template <typename Driver>
+    void idle(Driver &driver) {
+        if (r_SM_Main != s_IDLE)
+            return;
+        
+        *tx = 1;
+        if (!fifo.empty()) {
+            byte = fifo.front();
+            r_Clks_Per_Bit = cycles_per_bit;
+            r_Bit_Index = 0;
+            r_SM_Main = s_TX_START_BIT;
+            driver.schedule(timer, driver.cycle() + 1);
+        }
+    }
+    
+    template <typename Driver>
+    void wake(Driver &driver) {
+        using namespace verilator_aux;
+        
+        auto now = driver.cycle();
+        switch (r_SM_Main) {
+            case s_TX_START_BIT: {
+                *tx = 0;
+                r_SM_Main = s_TX_DATA_BITS;
+                driver.schedule(timer, now + r_Clks_Per_Bit);
+                break;
+            }
+            case s_TX_DATA_BITS: {
+                *tx = get_bit(byte, r_Bit_Index);
+                if (r_Bit_Index < 7) {
+                    ++r_Bit_Index;
+                }
+                else {
+                    r_Bit_Index = 0;
+                    r_SM_Main = s_TX_STOP_BIT;
+                }
+                driver.schedule(timer, now + r_Clks_Per_Bit);
+                break;
+            }
+            case s_TX_STOP_BIT: {
+                *tx = 1;
+                r_SM_Main = s_CLEANUP;
+                driver.schedule(timer, now + r_Clks_Per_Bit);
+                break;
+            }
+            case s_CLEANUP: {
+                r_SM_Main = s_IDLE;
+                complete();
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+    
+    // END
+    
+    // the byte in front is sent
+    void complete() {
+        fifo.pop();
+        ++sent;
+        
+        // a callback may write again, the chunk is popped first
+        while (!chunks.empty() && chunks.front().end <= sent) {
+            auto cb = std::move(chunks.front().callback);
+            chunks.pop();
+            cb();
+        }
+    }
+    
+    // a chunk is complete once sent reaches end
+    struct chunk {
+        std::uint64_t end;
+        callback_type callback;
+    };
+    
     std::uint8_t byte;
-    std::function<void ()> callback;
     
     CLK *clk;
     TX *tx;
     std::size_t cycles_per_bit;
     
+    // the front byte is being sent
+    verilator_aux::ring_buffer<std::uint8_t> fifo;
+    verilator_aux::ring_buffer<chunk> chunks;
+    std::uint64_t queued {0};
+    std::uint64_t sent {0};
+    
+    std::size_t timer {0};
+    
     enum {
         s_IDLE,
         s_TX_START_BIT,
@@ -169,6 +334,7 @@ private:
         s_CLEANUP
     } r_SM_Main {s_IDLE};
     
+    std::size_t r_Clks_Per_Bit {1};
     std::size_t r_Clock_Count {0};
     std::uint8_t r_Bit_Index {0};
 };
@@ -185,76 +351,181 @@ struct receiver {
             throw std::runtime_error("uart::sender nullptr");
     }
     
+    /**
+     * @brief Changes the baud rate from the next start bit on.
+     */
+    void set_cycles_per_bit(std::size_t n) {
+        if (n == 0)
+            throw std::runtime_error("uart::receiver: cycles_per_bit is 0");
+        cycles_per_bit = n;
+    }
+    
     // must be called before the main model
     void eval() {
+        if (*clk) {
+            posedge();
+        }
+    }
+    
+    /**
+     * @brief Runs the receiver on a clock_driver, before the main model. The receiver must not
+     * move afterwards.
+     * 
+     * Only the idle state is checked every rising edge (rx against the start bit); once a start
+     * bit is seen, the edges of the sample points are scheduled, about 10 wake-ups per byte
+     * instead of 10 * cycles_per_bit. The bytes and their timing are the same as with eval().
+     */
+    template <typename Driver>
+    void attach(Driver &driver) {
+        using verilator_aux::edge_hook;
+        
+        auto d = &driver;
+        driver.on(edge_hook::before_posedge, [this, d] { idle(*d); }, true);
+        timer = driver.add_timer(edge_hook::before_posedge, [this, d] { wake(*d); });
+        driver.on_quiet([this] { return quiet(); }, [](std::uint64_t) {});
+    }
+    
+    /**
+     * @returns quiescence::forever while rx stays high (idle) or until the next sample point.
+     */
+    verilator_aux::quiescence quiet() const {
         using namespace verilator_aux;
         
-        if (*clk) {
-            switch (r_SM_Main) {
-                case s_IDLE: {
-                    r_Clock_Count = 0;
-                    r_Bit_Index = 0;
-                    
-                    if (*rx == 0) {
-                        r_SM_Main = s_RX_START_BIT;
-                    }
-                    break;
+        if (r_SM_Main == s_IDLE)
+            return {quiescence::forever, rx, 1};
+        return {quiescence::forever};
+    }
+    
+    // the rising edge half of eval()
+    void posedge() {
+        using namespace verilator_aux;
+        
+        switch (r_SM_Main) {
+            case s_IDLE: {
+                r_Clock_Count = 0;
+                r_Bit_Index = 0;
+                
+                if (*rx == 0) {
+                    r_Clks_Per_Bit = cycles_per_bit;
+                    r_SM_Main = s_RX_START_BIT;
                 }
-                case s_RX_START_BIT: {
-                    if (r_Clock_Count == (cycles_per_bit-1)/2) {
-                        if (*rx == 0) {
-                            r_Clock_Count = 0;
-                            r_SM_Main = s_RX_DATA_BITS;
-                        }
-                        else {
-                            r_SM_Main = s_IDLE;
-                        }
+                break;
+            }
+            case s_RX_START_BIT: {
+                if (r_Clock_Count == (r_Clks_Per_Bit - 1) / 2) {
+                    if (*rx == 0) {
+                        r_Clock_Count = 0;
+                        r_SM_Main = s_RX_DATA_BITS;
                     }
                     else {
-                        ++r_Clock_Count;
+                        r_SM_Main = s_IDLE;
                     }
-                    break;
                 }
-                case s_RX_DATA_BITS: {
-                    if (r_Clock_Count < cycles_per_bit-1) {
-                        ++r_Clock_Count;
-                    }
-                    else {
-                        r_Clock_Count = 0;
-                        byte = set_bit(byte, r_Bit_Index, *rx);
-                        if (r_Bit_Index < 7) {
-                            ++r_Bit_Index;
-                        }
-                        else {
-                            r_Bit_Index = 0;
-                            r_SM_Main = s_RX_STOP_BIT;
-                        }
-                    }
-                    break;
+                else {
+                    ++r_Clock_Count;
+                }
+                break;
+            }
+            case s_RX_DATA_BITS: {
+                if (r_Clock_Count < r_Clks_Per_Bit - 1) {
+                    ++r_Clock_Count;
                 }
-                case s_RX_STOP_BIT: {
-                    if (r_Clock_Count < cycles_per_bit - 1) {
-                        ++r_Clock_Count;
+                else {
+                    r_Clock_Count = 0;
+                    byte = set_bit(byte, r_Bit_Index, *rx);
+                    if (r_Bit_Index < 7) {
+                        ++r_Bit_Index;
                     }
                     else {
-                        r_Clock_Count = 0;
-                        r_SM_Main = s_CLEANUP;
+                        r_Bit_Index = 0;
+                        r_SM_Main = s_RX_STOP_BIT;
                     }
-                    break;
                 }
-                case s_CLEANUP: {
-                    if (callback)
-                        callback(byte);
-                    r_SM_Main = s_IDLE;
+                break;
+            }
+            case s_RX_STOP_BIT: {
+                if (r_Clock_Count < r_Clks_Per_Bit - 1) {
+                    ++r_Clock_Count;
                 }
-                default: {
-                    r_SM_Main = s_IDLE;
-                    break;
+                else {
+                    r_Clock_Count = 0;
+                    r_SM_Main = s_CLEANUP;
                 }
+                break;
+            }
+            case s_CLEANUP: {
+                if (callback)
+                    callback(byte);
+                r_SM_Main = s_IDLE;
+                break;
+            }
+            default: {
+                r_SM_Main = s_IDLE;
+                break;
             }
         }
     }
 private:
+    // BEGIN scheduled (attach), r_SM_Main is the state entered at the next wake-up
+    
+    template <typename Driver>
+    void idle(Driver &driver) {
+        if (r_SM_Main != s_IDLE || driver.cycle() < resume || *rx != 0)
+            return;
+        
+        // the start bit is checked in its middle
+        r_Clks_Per_Bit = cycles_per_bit;
+        r_SM_Main = s_RX_START_BIT;
+        driver.schedule(timer, driver.cycle() + 1 + (r_Clks_Per_Bit - 1) / 2);
+    }
+    
+    template <typename Driver>
+    void wake(Driver &driver) {
+        using namespace verilator_aux;
+        
+        auto now = driver.cycle();
+        switch (r_SM_Main) {
+            case s_RX_START_BIT: {
+                if (*rx == 0) {
+                    r_Bit_Index = 0;
+                    r_SM_Main = s_RX_DATA_BITS;
+                    driver.schedule(timer, now + r_Clks_Per_Bit);
+                }
+                else {
+                    r_SM_Main = s_IDLE;
+                    resume = now + 1;
+                }
+                break;
+            }
+            case s_RX_DATA_BITS: {
+                byte = set_bit(byte, r_Bit_Index, *rx);
+                if (r_Bit_Index < 7) {
+                    ++r_Bit_Index;
+                    driver.schedule(timer, now + r_Clks_Per_Bit);
+                }
+                else {
+                    // the stop bit is not sampled, the byte is complete an edge after it
+                    r_Bit_Index = 0;
+                    r_SM_Main = s_CLEANUP;
+                    driver.schedule(timer, now + r_Clks_Per_Bit + 1);
+                }
+                break;
+            }
+            case s_CLEANUP: {
+                r_SM_Main = s_IDLE;
+                resume = now + 1;
+                if (callback)
+                    callback(byte);
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+    
+    // END
+    
     std::function<void (std::uint8_t)> callback;
     CLK *clk;
     RX *rx;
@@ -262,6 +533,9 @@ private:
     
     std::uint8_t byte;
     
+    std::size_t timer {0};
+    std::uint64_t resume {0};
+    
     enum {
         s_IDLE,
         s_RX_START_BIT,
@@ -270,13 +544,169 @@ private:
         s_CLEANUP
     } r_SM_Main {s_IDLE};
     
+    std::size_t r_Clks_Per_Bit {1};
     std::size_t r_Clock_Count {0};
     std::uint8_t r_Bit_Index {0};
 };
 
+/**
+ * @brief The testbench side of the byte ports of tlul_uart, built with UART_BYPASS. It takes
+ * the place of both the sender and the receiver: a byte is delivered to rx_dv/rx_byte while
+ * rx_ready is high, and a byte on tx_dv/tx_byte is received and acknowledged by tx_done, one
+ * byte per clock cycle each way.
+ * 
+ * Writing works as with the sender. Unlike with the UART, a byte written while the RX FIFO of
+ * the model is full waits in the FIFO instead of being lost.
+ */
+template <typename RXDV, typename RXBYTE, typename RXREADY, typename TXDV, typename TXBYTE,
+    typename TXDONE>
+struct byte_channel {
+    using callback_type = verilator_aux::inplace_function<void ()>;
+    using bytes = verilator_aux::span<std::uint8_t const>;
+    
+    static constexpr std::size_t default_capacity = 4096;
+    static constexpr std::size_t default_chunks = 64;
+    
+    /**
+     * @param callback called with every byte on tx_byte
+     * @param capacity of the FIFO in bytes, rounded up to a power of 2. It never grows.
+     * @param chunks chunks with a callback which may wait at once, rounded up to a power of 2
+     */
+    template <typename Callback>
+    byte_channel(Callback &&callback,
+            RXDV *rx_dv, RXBYTE *rx_byte, RXREADY *rx_ready,
+            TXDV *tx_dv, TXBYTE *tx_byte, TXDONE *tx_done,
+            std::size_t capacity = default_capacity, std::size_t chunks = default_chunks):
+        callback{std::forward<Callback>(callback)},
+        rx_dv{rx_dv},
+        rx_byte{rx_byte},
+        rx_ready{rx_ready},
+        tx_dv{tx_dv},
+        tx_byte{tx_byte},
+        tx_done{tx_done},
+        fifo{capacity},
+        chunks{chunks} {
+        if (!rx_dv || !rx_byte || !rx_ready || !tx_dv || !tx_byte || !tx_done)
+            throw std::runtime_error("uart::byte_channel nullptr");
+    }
+    
+    bool ongoing() const {
+        return !fifo.empty();
+    }
+    
+    std::size_t space() const {
+        return fifo.capacity() - fifo.size();
+    }
+    
+    /**
+     * @brief Queues as many bytes as fit into the FIFO, without a callback.
+     * @returns number of bytes queued.
+     */
+    std::size_t write(bytes data) {
+        std::size_t n = std::min(data.size(), space());
+        for (std::size_t i = 0; i < n; ++i)
+            fifo.try_push(std::uint8_t(data[i]));
+        queued += n;
+        return n;
+    }
+    
+    /**
+     * @brief Queues a chunk of bytes, the callback is called once its last byte is delivered.
+     * @returns false (and queues nothing) if the chunk does not fit into the FIFO, or if it has a
+     * callback and the ring of callbacks is full.
+     */
+    template <typename Callback>
+    bool write_bytes(bytes data, Callback &&callback) {
+        if (data.size() > space())
+            return false;
+        
+        callback_type cb{std::forward<Callback>(callback)};
+        if (cb && !data.empty() && chunks.full())
+            return false;
+        
+        write(data);
+        if (data.empty()) {
+            if (cb)
+                cb();
+        }
+        else if (cb) {
+            chunks.try_emplace(chunk{queued, std::move(cb)});
+        }
+        return true;
+    }
+    
+    template <typename Callback>
+    bool write_bytes(std::string const &str, Callback &&callback) {
+        return write_bytes(
+            bytes{reinterpret_cast<std::uint8_t const *>(str.data()), str.size()},
+            std::forward<Callback>(callback));
+    }
+    
+    template <typename Callback>
+    bool write_byte(std::uint8_t byte, Callback &&callback) {
+        return write_bytes(bytes{&byte, 1}, std::forward<Callback>(callback));
+    }
+    
+    /**
+     * @brief Registers posedge() on a clock_driver, after the main model. The channel must not
+     * move afterwards.
+     */
+    template <typename Driver>
+    void attach(Driver &driver) {
+        driver.on(verilator_aux::edge_hook::after_posedge, [this] { posedge(); });
+    }
+    
+    // drives the byte ports for the next rising edge
+    void posedge() {
+        // the byte of the last edge is taken, the next one is offered
+        *rx_dv = 0;
+        if (*rx_ready && !fifo.empty()) {
+            *rx_dv = 1;
+            *rx_byte = fifo.front();
+            fifo.pop();
+            ++sent;
+            
+            while (!chunks.empty() && chunks.front().end <= sent) {
+                auto cb = std::move(chunks.front().callback);
+                chunks.pop();
+                cb();
+            }
+        }
+        
+        // tx_dv stays high while there are bytes to send, each one is taken at once
+        *tx_done = 0;
+        if (*tx_dv) {
+            *tx_done = 1;
+            if (callback)
+                callback(std::uint8_t(*tx_byte));
+        }
+    }
+private:
+    struct chunk {
+        std::uint64_t end;
+        callback_type callback;
+    };
+    
+    std::function<void (std::uint8_t)> callback;
+    
+    RXDV *rx_dv;
+    RXBYTE *rx_byte;
+    RXREADY *rx_ready;
+    TXDV *tx_dv;
+    TXBYTE *tx_byte;
+    TXDONE *tx_done;
+    
+    verilator_aux::ring_buffer<std::uint8_t> fifo;
+    verilator_aux::ring_buffer<chunk> chunks;
+    std::uint64_t queued {0};
+    std::uint64_t sent {0};
+};
+
 template <typename CLK, typename TX>
-auto make_sender(CLK *clk, TX *tx, std::size_t cycles_per_bit) {
-    return sender<CLK, TX>{clk, tx, cycles_per_bit};
+auto make_sender(CLK *clk, TX *tx, std::size_t cycles_per_bit,
+        std::size_t capacity = sender<CLK, TX>::default_capacity,
+        std::size_t chunks = sender<CLK, TX>::default_chunks) {
+    return sender<CLK, TX>{clk, tx, cycles_per_bit, capacity, chunks};
 }
 
 template <typename Callback, typename CLK, typename RX>
@@ -284,6 +714,17 @@ auto make_receiver(Callback &&callback, CLK *clk, RX *rx, std::size_t cycles_per
     return receiver<CLK, RX>{std::forward<Callback>(callback), clk, rx, cycles_per_bit};
 }
 
+template <typename Callback, typename RXDV, typename RXBYTE, typename RXREADY, typename TXDV,
+    typename TXBYTE, typename TXDONE>
+auto make_byte_channel(Callback &&callback,
+        RXDV *rx_dv, RXBYTE *rx_byte, RXREADY *rx_ready,
+        TXDV *tx_dv, TXBYTE *tx_byte, TXDONE *tx_done,
+        std::size_t capacity = 4096, std::size_t chunks = 64) {
+    return byte_channel<RXDV, RXBYTE, RXREADY, TXDV, TXBYTE, TXDONE>{
+        std::forward<Callback>(callback), rx_dv, rx_byte, rx_ready, tx_dv, tx_byte, tx_done,
+        capacity, chunks};
+}
+
 };
 
 #endif // UART_TESTBENCH_HPP_INCLUDED
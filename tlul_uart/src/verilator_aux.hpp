@@ -7,7 +7,11 @@
 #define VERILATOR_AUX_HPP_INCLUDED
 
 #include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <bitset>
 #include <type_traits>
+#include <vector>
 
 #include <iostream>
 
@@ -37,6 +41,17 @@ struct packed_traits<Base [M]>: std::true_type {
 template <typename Base, unsigned A, unsigned B>
 struct packed_traits<Base [A][B]>: std::false_type {};
 
+// newer versions of Verilator use VlWide<N> instead of WData [N], matched
+// without including verilated.h
+template <template <std::size_t> class Wide, std::size_t N>
+struct packed_traits<Wide<N>>: std::true_type {
+    using base_type = std::uint32_t;
+    using element_type = Wide<N>;
+    static constexpr auto size_in_bits = sizeof(base_type) * N * CHAR_BIT;
+    static constexpr auto size = sizeof(base_type) * N;
+    static constexpr auto length = (unsigned) N;
+};
+
 template <typename Base>
 struct unpacked_traits2: std::false_type {};
 
@@ -60,6 +75,54 @@ struct unpacked_traits2<Base [N][M]>: std::true_type {
     static constexpr auto length = packed_traits::length * N;
 };
 
+/**
+ * @brief A non-owning view over contiguous elements.
+ */
+template <typename T>
+struct span {
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    
+    constexpr span() = default;
+    
+    constexpr span(T *data, std::size_t size):
+        first{data},
+        length{size} {
+    }
+    
+    template <typename Container, typename = decltype(std::declval<Container &>().data())>
+    constexpr span(Container &c):
+        first{c.data()},
+        length{c.size()} {
+    }
+    
+    // to allow span<T> -> span<T const>
+    template <typename U, typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+    constexpr span(span<U> const &s):
+        first{s.data()},
+        length{s.size()} {
+    }
+    
+    constexpr T *data() const { return first; }
+    constexpr std::size_t size() const { return length; }
+    constexpr bool empty() const { return length == 0; }
+    constexpr T *begin() const { return first; }
+    constexpr T *end() const { return first + length; }
+    constexpr T &operator[](std::size_t i) const { return first[i]; }
+    
+    constexpr span subspan(std::size_t offset, std::size_t count) const {
+        return span{first + offset, count};
+    }
+    
+    // allocates, only for the convenience of the old code
+    operator std::vector<value_type>() const {
+        return std::vector<value_type>(begin(), end());
+    }
+private:
+    T *first {nullptr};
+    std::size_t length {0};
+};
+
 template <unsigned long N>
 bool check_contiguous(std::bitset<N> bs) {
     // a contiguous bitset is
@@ -111,6 +174,69 @@ constexpr T set_bit(T t, N n, std::uint8_t b) {
     return (t & ~(T(1) << n)) | (((uintmax_t) b) << n);
 }
 
+/**
+ * @name word access
+ * Uniform access to the words of a packed value, which may be a scalar (a single word),
+ * a WData array or a VlWide. Wide values are accessed word at a time, never as a whole.
+ */
+template <typename T>
+constexpr T &word(T &t, std::size_t) {
+    return t;
+}
+
+template <typename T, unsigned M>
+constexpr T &word(T (&t)[M], std::size_t i) {
+    return t[i];
+}
+
+template <template <std::size_t> class Wide, std::size_t N>
+constexpr auto &word(Wide<N> &t, std::size_t i) {
+    return t[i];
+}
+
+template <typename T>
+constexpr T const &word(T const &t, std::size_t) {
+    return t;
+}
+
+template <typename T, unsigned M>
+constexpr T const &word(T const (&t)[M], std::size_t i) {
+    return t[i];
+}
+
+template <template <std::size_t> class Wide, std::size_t N>
+constexpr auto const &word(Wide<N> const &t, std::size_t i) {
+    return t[i];
+}
+
+/**
+ * @brief Reads the n-th byte (lane) of a packed value.
+ */
+template <typename T>
+constexpr std::uint8_t get_lane(T const &t, std::size_t n) {
+    using base_type = typename packed_traits<T>::base_type;
+    return get_byte(word(t, n / sizeof(base_type)), n % sizeof(base_type));
+}
+
+/**
+ * @brief Writes the n-th byte (lane) of a packed value.
+ */
+template <typename T>
+void set_lane(T &t, std::size_t n, std::uint8_t b) {
+    using base_type = typename packed_traits<T>::base_type;
+    auto &w = word(t, n / sizeof(base_type));
+    w = set_byte(w, n % sizeof(base_type), b);
+}
+
+/**
+ * @brief Zeroes a packed value.
+ */
+template <typename T>
+void clear_packed(T &t) {
+    for (std::size_t i = 0; i < packed_traits<T>::length; ++i)
+        word(t, i) = 0;
+}
+
 };
 
 #endif // VERILATOR_AUX_HPP_INCLUDED
@@ -6,7 +6,11 @@ module tlul_master_echo
         A = 32,
         Z = 4,
         O = 5,
-        I = 5
+        I = 5,
+        // 1: read the RX level register of tlul_uart first, and Get only
+        // what is there (the largest power of 2, at most W bytes), so that
+        // a Get never holds the bus waiting for bytes
+        POLL = 0
     )
     (
         // the clock
@@ -96,11 +100,20 @@ module tlul_master_echo
     parameter act_None  = 0;
     parameter act_Read  = 1;
     parameter act_Write = 2;
+    parameter act_Poll  = 3;
     
     // END
     
     reg [1:0] action;
     
+    // log2 of the bytes of the next Get and Put
+    reg [Z-1:0] xfer_size;
+    
+    // the RX level register (see tlul_uart), in its lane of d_data
+    parameter LEVEL_LANE = (UART_ADDRESS + 1) % W;
+    wire [7:0] level = d_data[8*LEVEL_LANE +: 8];
+    integer k;
+    
     initial begin
         d_ready = 0;
         a_opcode = 0;
@@ -113,7 +126,8 @@ module tlul_master_echo
         a_valid = 0;
         
         state = st_IDLE;
-        action = act_Read;
+        action = POLL ? act_Poll : act_Read;
+        xfer_size = BUFFER_SZ_LOG2;
     end
     
     always @(posedge CLK) begin
@@ -124,14 +138,15 @@ module tlul_master_echo
             end else begin
                 case (action)
                 act_Read: begin
-                    // we need to put a Get operation of size BUFFER_SZ_LOG2
+                    // we need to put a Get operation of size xfer_size
+                    // (BUFFER_SZ_LOG2, unless POLL)
                     a_valid <= 1;
                     a_opcode <= OP_Get;
                     a_param <= 0;
-                    /* verilator lint_off WIDTH */ a_size <= BUFFER_SZ_LOG2;
+                    /* verilator lint_off WIDTH */ a_size <= xfer_size;
                     a_source <= 0;
                     a_address <= UART_ADDRESS;
-                    a_mask <= {W{1'b1}};
+                    a_mask <= {W{1'b1}} >> (W - (1 << xfer_size));
                     a_data <= 0;
                     state <= st_WRDY;
                 end
@@ -139,13 +154,25 @@ module tlul_master_echo
                     a_valid <= 1;
                     a_opcode <= OP_PutFullData;
                     a_param <= 0;
-                    /* verilator lint_off WIDTH */ a_size <= BUFFER_SZ_LOG2;
+                    /* verilator lint_off WIDTH */ a_size <= xfer_size;
                     a_source <= 0;
-                    a_address <= 127;
-                    a_mask <= {W{1'b1}};
+                    a_address <= UART_ADDRESS;
+                    a_mask <= {W{1'b1}} >> (W - (1 << xfer_size));
                     a_data <= buffer;
                     state <= st_WRDY;
                 end
+                act_Poll: begin
+                    // a 1-byte Get of the RX level register
+                    a_valid <= 1;
+                    a_opcode <= OP_Get;
+                    a_param <= 0;
+                    a_size <= 0;
+                    a_source <= 0;
+                    a_address <= UART_ADDRESS + 1;
+                    a_mask <= 1 << LEVEL_LANE;
+                    a_data <= 0;
+                    state <= st_WRDY;
+                end
                 default: begin end
                 endcase
             end
@@ -171,8 +198,19 @@ module tlul_master_echo
                 act_Write: begin
                     d_ready <= 0;
                     state <= st_IDLE;
-                    if (action == act_Read) action <= act_Write;
-                    else if (action == act_Write) action <= act_Read;
+                    action <= POLL ? act_Poll : act_Read;
+                end
+                act_Poll: begin
+                    d_ready <= 0;
+                    state <= st_IDLE;
+                    if (level != 0) begin
+                        // the largest power of 2 which is there
+                        for (k = 0; k <= BUFFER_SZ_LOG2; k = k + 1) begin
+                            if ((1 << k) <= level)
+                                xfer_size <= k;
+                        end
+                        action <= act_Read;
+                    end
                 end
                 default: begin end
                 endcase
@@ -1,6 +1,7 @@
 module tlul_uart
     #(
         parameter
+        // the divisor after reset (see the register map)
         // CLKS_PER_BIT = 87,
         CLKS_PER_BIT = 2,
         UART_ADDRESS = 127,
@@ -8,7 +9,16 @@ module tlul_uart
         A = 32,
         Z = 4,
         O = 5,
-        I = 5
+        I = 5,
+        // the TX FIFO holds 2^TX_FIFO_SZ_LOG2 bytes, at least 2 and W
+        // (and at most 128, see the register map)
+        TX_FIFO_SZ_LOG2 = 4,
+        // 1: a PutFullData is acknowledged once its bytes are queued,
+        // 0: once they are sent (as without the TX FIFO)
+        POSTED_WRITES = 1,
+        // the RX FIFO holds 2^RX_FIFO_SZ_LOG2 bytes, at least 2 and W
+        // (and at most 128)
+        RX_FIFO_SZ_LOG2 = 4
     )
     (
         // the clock signal
@@ -47,6 +57,19 @@ module tlul_uart
         
         // END
         
+`ifdef UART_BYPASS
+        // BEGIN Byte Ports (UART_BYPASS)
+        
+        rx_dv,
+        rx_byte,
+        rx_ready,
+        tx_dv,
+        tx_byte,
+        tx_done,
+        
+        // END
+`endif
+        
         INFO_CLKS_PER_BIT
     );
     
@@ -85,7 +108,24 @@ module tlul_uart
     
     // END
     
-    output integer INFO_CLKS_PER_BIT = CLKS_PER_BIT;
+`ifdef UART_BYPASS
+    // BEGIN Byte Port definitions
+    
+    // uart_rx and uart_tx are left out, bytes are exchanged with the
+    // testbench (see uart::byte_channel), a byte per clock cycle
+    
+    input                   rx_dv;
+    input [7:0]             rx_byte;
+    output wire             rx_ready;   // rx_dv is taken at the next rising edge
+                                        // (there is room in the RX FIFO)
+    output reg              tx_dv;
+    output reg [7:0]        tx_byte;
+    input                   tx_done;
+    
+    // END
+`endif
+    
+    output integer INFO_CLKS_PER_BIT;   // the divisor
     
     // BEGIN opcodes for TL-UL
     
@@ -102,14 +142,65 @@ module tlul_uart
     parameter st_IDLE = 0;
     parameter st_W1 = 1;
     parameter st_W2 = 2;
-    parameter st_WTX = 3;
-    parameter st_WRX = 4;
+    parameter st_WTX = 3;   // waits for the TX FIFO, unless POSTED_WRITES
+    parameter st_WRX = 4;   // waits for sz bytes in the RX FIFO
     parameter st_WRDY = 5;
+    parameter st_WBEAT = 6; // waits for the next beat of a burst PutFullData
     
     // END
     
     reg [2:0] state;
     
+    // BEGIN register map
+    
+    // UART_ADDRESS + 0     data: PutFullData sends, Get receives (and
+    //                      waits until sz bytes are there)
+    // UART_ADDRESS + 1     RX level: bytes in the RX FIFO
+    // UART_ADDRESS + 2     TX free: room in the TX FIFO, in bytes
+    // UART_ADDRESS + 3     flags, reading them clears RX_OVERRUN
+    // UART_ADDRESS + 4     (reserved, 0)
+    // UART_ADDRESS + 5     divisor: clock cycles per bit, 16 bits (low
+    //                      byte first), CLKS_PER_BIT after reset
+    //
+    // A Get never waits on the registers; a Get of several bytes reads the
+    // following registers too (0 beyond the last one). The divisor is the
+    // only writable register, writes to the others are acknowledged
+    // without effect. A divisor of 0 is ignored; a new divisor is taken by
+    // uart_rx and uart_tx at the start of their next byte, so it is best
+    // written while TX_IDLE and the line is quiet. With the default
+    // UART_ADDRESS, the divisor is aligned to 2 bytes.
+    //
+    // The map is read a beat at a time like the rest of the bus, so any
+    // W from 2 on (the divisor in one beat) reaches all of it: with W = 4,
+    // a Get at UART_ADDRESS + 1 returns the levels and the flags, a Get at
+    // UART_ADDRESS + 5 the divisor.
+    //
+    // A Get or a PutFullData of the data register may be a burst of
+    // 2^a_size > W bytes (UART_ADDRESS aligned to it), W bytes per beat:
+    // each beat of a PutFullData waits for room for W bytes in the TX
+    // FIFO, each beat of the AccessAckData for W bytes in the RX FIFO. The
+    // registers take no bursts.
+    //
+    // A PutPartialData of the data register queues the bytes of its
+    // lanes, lowest lane first, like a PutFullData of that many bytes. On
+    // the registers, it is answered with d_error, without effect.
+    
+    parameter REG_RX_LEVEL  = 1;
+    parameter REG_TX_FREE   = 2;
+    parameter REG_FLAGS     = 3;
+    parameter REG_DIVISOR   = 5;
+    
+    parameter FLAG_RX_AVAIL     = 0;    // the RX FIFO is not empty
+    parameter FLAG_TX_IDLE      = 1;    // the TX FIFO is empty, nothing is being sent
+    parameter FLAG_TX_FULL      = 2;    // the TX FIFO is full
+    parameter FLAG_RX_OVERRUN   = 3;    // a byte was lost (RX FIFO full) since the flags
+                                        // were last read; sticky until then
+    
+    // END
+    
+`ifdef UART_BYPASS
+    assign tx = 1'b1;
+`else
     wire            rx_dv;
     wire [7:0]      rx_byte;
     
@@ -117,25 +208,143 @@ module tlul_uart
     reg [7:0]       tx_byte;
     wire            tx_active;
     wire            tx_done;
+`endif
     
     reg [O-1:0]     source;
     reg [Z-1:0]     size;
     integer         sz;     // in bytes
     reg [W-1:0]     mask;
+    reg             registers;  // the operation is on the register map, not data
+    reg [A-1:0]     offset;     // of the register, from UART_ADDRESS
+    reg             partial;    // PutPartialData, sz is the lanes of each beat
+    reg             error;      // answered with d_error, without effect
+    
+    // the lanes of a PutPartialData
+    function integer count_lanes(input [W-1:0] lanes);
+        integer j;
+        begin
+            count_lanes = 0;
+            for (j = 0; j < W; j = j + 1)
+                count_lanes = count_lanes + lanes[j];
+        end
+    endfunction
+    
+    wire is_data = a_address == UART_ADDRESS;
+    
+    // BEGIN bursts
+    parameter WORD_BITS = $clog2(W);
+    
+    wire burst = a_size > WORD_BITS;
+    reg [A-1:0]     burst_left; // beats after the current one
+    // END
+    
+    wire is_register = a_address > UART_ADDRESS && a_address <= UART_ADDRESS + REG_DIVISOR + 1;
+    
+    reg [15:0]      divisor;
+    reg [15:0]      divisor_at;
+    
+    assign INFO_CLKS_PER_BIT = {16'b0, divisor};
+    
+    // BEGIN TX FIFO
+    
+    // PutFullData queues its bytes here, the transmitter below drains
+    // them independently of the bus. A PutFullData is not accepted
+    // (a_ready stays low) until there is room for all of its bytes.
+    parameter [TX_FIFO_SZ_LOG2:0] TX_FIFO_SZ = 1 << TX_FIFO_SZ_LOG2;
+    
+    reg [7:0]                   tx_fifo [0:TX_FIFO_SZ-1];
+    reg [TX_FIFO_SZ_LOG2:0]     tx_wr;      // written by the bus side
+    reg [TX_FIFO_SZ_LOG2:0]     tx_rd;      // written by the transmitter
+    reg [TX_FIFO_SZ_LOG2:0]     tx_at;
+    integer                     i;
+    
+    wire [TX_FIFO_SZ_LOG2:0] tx_rd_next = tx_rd + 1'b1;
+    wire [TX_FIFO_SZ_LOG2:0] tx_free = TX_FIFO_SZ - (tx_wr - tx_rd);
+    wire [TX_FIFO_SZ_LOG2:0] tx_beat = burst ? W : ({{TX_FIFO_SZ_LOG2{1'b0}}, 1'b1} << a_size);
+    wire tx_fits = tx_free >= tx_beat;
+    
+    // END
+    
+    // BEGIN RX FIFO
+    
+    // the receiver below captures every incoming byte here, whatever the
+    // bus is doing; a Get takes its bytes from here (at once, if they are
+    // already buffered). Bytes arriving while it is full are lost.
+    parameter [RX_FIFO_SZ_LOG2:0] RX_FIFO_SZ = 1 << RX_FIFO_SZ_LOG2;
+    
+    reg [7:0]                   rx_fifo [0:RX_FIFO_SZ-1];
+    reg [RX_FIFO_SZ_LOG2:0]     rx_wr;      // written by the receiver
+    reg [RX_FIFO_SZ_LOG2:0]     rx_rd;      // written by the bus side
+    reg [RX_FIFO_SZ_LOG2:0]     rx_at;
+    
+    wire [RX_FIFO_SZ_LOG2:0] rx_count = rx_wr - rx_rd;
+    wire rx_full = rx_count == RX_FIFO_SZ;
+    
+    // a byte was lost since the last read of the flags, written by the
+    // receiver (the bus side only reads the flags, see flags_read)
+    reg                         rx_overrun;
+    
+    // END
+    
+    wire [7:0] flags;
+    assign flags[FLAG_RX_AVAIL] = rx_count != 0;
+    assign flags[FLAG_TX_IDLE] = tx_rd == tx_wr && !tx_dv;
+    assign flags[FLAG_TX_FULL] = tx_free == 0;
+    assign flags[FLAG_RX_OVERRUN] = rx_overrun;
+    assign flags[7:4] = 4'b0;
+    
+    // the levels zero-extended to a byte (the FIFOs hold at most 128 bytes)
+    wire [15:0] tx_free_reg = {{(15-TX_FIFO_SZ_LOG2){1'b0}}, tx_free};
+    wire [15:0] rx_count_reg = {{(15-RX_FIFO_SZ_LOG2){1'b0}}, rx_count};
+    
+    // the register map from UART_ADDRESS + 1, lowest address first, at
+    // least 8 bytes wide whatever W is; a Get takes W bytes of it from
+    // its offset
+    localparam REG_BITS = 8*W > 64 ? 8*W : 64;
+    
+    wire [REG_BITS-1:0] register_file = {
+        {(REG_BITS-48){1'b0}},
+        divisor,
+        8'b0,
+        flags,
+        tx_free_reg[7:0],
+        rx_count_reg[7:0] };
+    wire [REG_BITS-1:0] register_window = register_file >> ((offset - REG_RX_LEVEL) << 3);
+    
+    // BEGIN parameter checks
+    generate
+        if (TX_FIFO_SZ_LOG2 < 1 || TX_FIFO_SZ_LOG2 > 7) begin
+            $error("sv-error: TX_FIFO_SZ_LOG2 must be in 1..7");
+        end
+        if (RX_FIFO_SZ_LOG2 < 1 || RX_FIFO_SZ_LOG2 > 7) begin
+            $error("sv-error: RX_FIFO_SZ_LOG2 must be in 1..7");
+        end
+        if (W < 2) begin
+            $error("sv-error: W must be at least 2, the divisor is written in one beat");
+        end
+        if (W > (1 << TX_FIFO_SZ_LOG2) || W > (1 << RX_FIFO_SZ_LOG2)) begin
+            $error("sv-error: W must be at most the size of each FIFO");
+        end
+    endgenerate
+    // END
     
-    uart_rx#(.CLKS_PER_BIT(CLKS_PER_BIT)) uart_rx1(
+`ifndef UART_BYPASS
+    uart_rx uart_rx1(
         .i_Clock(CLK),
+        .i_Clks_Per_Bit(divisor),
         .i_Rx_Serial(rx),
         .o_Rx_DV(rx_dv),
         .o_Rx_Byte(rx_byte));
     
-    uart_tx#(.CLKS_PER_BIT(CLKS_PER_BIT)) uart_tx1(
+    uart_tx uart_tx1(
         .i_Clock(CLK),
+        .i_Clks_Per_Bit(divisor),
         .i_Tx_DV(tx_dv),
         .i_Tx_Byte(tx_byte),
         .o_Tx_Active(tx_active),
         .o_Tx_Serial(tx),
         .o_Tx_Done(tx_done));
+`endif
     
     // Here comes the non-trivial parts
     
@@ -159,6 +368,10 @@ module tlul_uart
     reg [8*W-1:0] storage;
     integer index;
     
+`ifdef UART_BYPASS
+    assign rx_ready = !rx_full;
+`endif
+    
     
     wire [8*W-1:0] masked_d_data;
     masked_m2l_connector
@@ -182,10 +395,19 @@ module tlul_uart
         state = st_IDLE;
         tx_dv = 0;
         tx_byte = 0;
+        tx_wr = 0;
+        tx_rd = 0;
+        rx_wr = 0;
+        rx_rd = 0;
+        rx_overrun = 0;
+        divisor = CLKS_PER_BIT;
         
         source = 0;
         size = 0;
         mask = 0;
+        burst_left = 0;
+        partial = 0;
+        error = 0;
         
         storage = 0;
         index = 0;
@@ -194,10 +416,21 @@ module tlul_uart
     always @(posedge CLK) begin
         case (state)
         st_IDLE: begin
-            if (a_valid && a_address == UART_ADDRESS) begin
+            // a Put{Full,Partial}Data waits (on a_valid) for room in the
+            // TX FIFO
+            if (a_valid && ((is_register && !burst) ||
+                    (is_data && (a_opcode == OP_Get || tx_fits)))) begin
+                registers <= is_register;
+                offset <= a_address - UART_ADDRESS;
                 source <= a_source;
                 size <= a_size;
-                sz <= (1 << a_size);
+                partial <= a_opcode == OP_PutPartialData;
+                error <= is_register && a_opcode == OP_PutPartialData;
+                // a burst moves W bytes per beat, a PutPartialData those
+                // of its lanes
+                sz <= a_opcode == OP_PutPartialData ? count_lanes(a_mask) :
+                    burst ? W : (1 << a_size);
+                burst_left <= burst ? (1 << (a_size - WORD_BITS)) - 1 : 0;
                 
                 a_ready <= 1'b1;
                 
@@ -213,8 +446,9 @@ module tlul_uart
                     state <= st_W1;
                 end
                 OP_PutPartialData: begin
-                    // TODO implement later
-                    $display("sv-error: not implemented yet");
+                    storage <= intermediate_memory;
+                    
+                    state <= st_W1;
                 end
                 default: begin
                     // TODO Not implemented in TL-UL
@@ -226,16 +460,45 @@ module tlul_uart
         st_W1: begin
             a_ready <= 1'b0;
             
-            index <= 0;
-            tx_dv <= 1'b1;
-            tx_byte <= storage[7:0];
+            // queue the bytes
+            for (i = 0; i < W; i = i + 1) begin
+                if (i < sz && !registers) begin
+                    tx_at = tx_wr + i[TX_FIFO_SZ_LOG2:0];
+                    tx_fifo[tx_at[TX_FIFO_SZ_LOG2-1:0]] <= storage[(i << 3) +: 8];
+                end
+            end
+            if (!registers)
+                tx_wr <= tx_wr + sz[TX_FIFO_SZ_LOG2:0];
             
-            state <= st_WTX;
+            // or the divisor, a byte at a time
+            divisor_at = divisor;
+            for (i = 0; i < W; i = i + 1) begin
+                if (i < sz && registers && !error) begin
+                    if (offset + i == REG_DIVISOR)
+                        divisor_at[7:0] = storage[(i << 3) +: 8];
+                    if (offset + i == REG_DIVISOR + 1)
+                        divisor_at[15:8] = storage[(i << 3) +: 8];
+                end
+            end
+            if (divisor_at != 0)
+                divisor <= divisor_at;
+            
+            state <= burst_left != 0 ? st_WBEAT : st_WTX;
+        end
+        st_WBEAT: begin
+            // the next beat, as in st_IDLE
+            if (a_valid && tx_fits) begin
+                burst_left <= burst_left - 1;
+                a_ready <= 1'b1;
+                storage <= intermediate_memory;
+                if (partial)
+                    sz <= count_lanes(a_mask);
+                
+                state <= st_W1;
+            end
         end
         st_WTX: begin
-            // sequentially transmit bytes
-            
-            if (index == sz) begin
+            if (POSTED_WRITES || registers || tx_rd == tx_wr) begin
                 // send AccessAck
                 d_opcode <= OP_AccessAck;
                 d_param <= 0;
@@ -244,17 +507,9 @@ module tlul_uart
                 d_source <= source;
                 d_sink <= 0;
                 d_data <= 0;
-                d_error <= 0;
+                d_error <= error;
                 
                 state <= st_WRDY;
-            end else if (tx_done) begin
-                if (index + 1 == sz) begin
-                    // change dv ASAP
-                    tx_dv <= 1'b0;
-                end
-                index <= index + 1;
-                tx_byte <= storage[((index+1) << 3) +: 8];
-                
             end
         end
         st_W2: begin
@@ -265,11 +520,10 @@ module tlul_uart
             state <= st_WRX;
         end
         st_WRX: begin
-            // sequentially receive bytes
-            
             if (index == sz) begin
                 // send AccessAckData
-                a_ready <= 1'b1;
+                // (a_ready stays low, otherwise the next request on
+                // channel A would be seen as accepted in st_WRDY)
                 d_opcode <= OP_AccessAckData;
                 d_param <= 0;
                 d_size <= size;
@@ -280,13 +534,33 @@ module tlul_uart
                 d_error <= 0;
                 
                 state <= st_WRDY;
-            end else if (rx_dv) begin
-                storage[(index << 3) +: 8] <= rx_byte;
-                index <= index + 1;
+            end else if (registers) begin
+                // a snapshot, AccessAckData follows
+                // (the flags are read, see flags_read)
+                storage <= register_window[8*W-1:0];
+                index <= sz;
+            end else if (rx_count >= sz[RX_FIFO_SZ_LOG2:0]) begin
+                // take the bytes, AccessAckData follows
+                for (i = 0; i < W; i = i + 1) begin
+                    if (i < sz) begin
+                        rx_at = rx_rd + i[RX_FIFO_SZ_LOG2:0];
+                        storage[(i << 3) +: 8] <= rx_fifo[rx_at[RX_FIFO_SZ_LOG2-1:0]];
+                    end
+                end
+                rx_rd <= rx_rd + sz[RX_FIFO_SZ_LOG2:0];
+                index <= sz;
             end
         end
         st_WRDY: begin
-            if (d_ready == 1'b1) begin
+            if (d_ready == 1'b1 && burst_left != 0) begin
+                // the next beat of a burst AccessAckData
+                d_valid <= 1'b0;
+                burst_left <= burst_left - 1;
+                index <= 0;
+                
+                state <= st_WRX;
+            end
+            else if (d_ready == 1'b1) begin
                 d_valid <= 1'b0;
                 
                 // the followings are optional
@@ -304,4 +578,40 @@ module tlul_uart
         end
         endcase
     end
+    
+    // the transmitter, sends the TX FIFO byte by byte
+    always @(posedge CLK) begin
+        if (tx_dv) begin
+            if (tx_done) begin
+                tx_rd <= tx_rd_next;
+                if (tx_rd_next == tx_wr) begin
+                    // change dv ASAP
+                    tx_dv <= 1'b0;
+                end else begin
+                    tx_byte <= tx_fifo[tx_rd_next[TX_FIFO_SZ_LOG2-1:0]];
+                end
+            end
+        end else if (tx_rd != tx_wr) begin
+            tx_dv <= 1'b1;
+            tx_byte <= tx_fifo[tx_rd[TX_FIFO_SZ_LOG2-1:0]];
+        end
+    end
+    
+    // the snapshot of the registers in st_WRX covers the flags
+    wire flags_read = state == st_WRX && index != sz && registers &&
+        offset <= REG_FLAGS && offset + sz > REG_FLAGS;
+    
+    // the receiver, fills the RX FIFO byte by byte; a byte lost in the
+    // cycle the flags are read is flagged for the next read
+    always @(posedge CLK) begin
+        if (rx_dv && rx_full)
+            rx_overrun <= 1'b1;
+        else if (flags_read)
+            rx_overrun <= 1'b0;
+        
+        if (rx_dv && !rx_full) begin
+            rx_fifo[rx_wr[RX_FIFO_SZ_LOG2-1:0]] <= rx_byte;
+            rx_wr <= rx_wr + 1'b1;
+        end
+    end
 endmodule
@@ -7,18 +7,38 @@ module tlul_uart_echo
         A = 32,
         Z = 4,
         O = 5,
-        I = 5
+        I = 5,
+        // see tlul_master_echo
+        POLL = 0
     )
     (
         CLK,
         RX,
         TX
+`ifdef UART_BYPASS
+        , RX_DV,
+        RX_BYTE,
+        RX_READY,
+        TX_DV,
+        TX_BYTE,
+        TX_DONE
+`endif
     );
     
     input CLK;
     input RX;
     output wire TX;
     
+`ifdef UART_BYPASS
+    // see tlul_uart
+    input RX_DV;
+    input [7:0] RX_BYTE;
+    output wire RX_READY;
+    output wire TX_DV;
+    output wire [7:0] TX_BYTE;
+    input TX_DONE;
+`endif
+    
     wire [2:0]          a_opcode;
     wire [2:0]          a_param;
     wire [Z-1:0]        a_size;
@@ -70,6 +90,14 @@ module tlul_uart_echo
             .d_ready(d_ready),
             .rx(RX),
             .tx(TX), 
+`ifdef UART_BYPASS
+            .rx_dv(RX_DV),
+            .rx_byte(RX_BYTE),
+            .rx_ready(RX_READY),
+            .tx_dv(TX_DV),
+            .tx_byte(TX_BYTE),
+            .tx_done(TX_DONE),
+`endif
             .INFO_CLKS_PER_BIT(dummy) );
     
     tlul_master_echo#(
@@ -78,7 +106,8 @@ module tlul_uart_echo
         .A(A),
         .Z(Z),
         .O(O),
-        .I(I) ) m2(
+        .I(I),
+        .POLL(POLL) ) m2(
             .CLK(CLK),
             .a_opcode(a_opcode),
             .a_param(a_param),
@@ -0,0 +1,282 @@
+/**
+ * @author Canberk Sönmez
+ * @file tlul_uart_xbar.sv
+ * @brief A small system: one master, the ports of this module, and two slaves behind a
+ * tlul_xbar (of tlul_mem): a tlul_slave_memory_pipelined of RAM_SIZE bytes from 0 on, and a
+ * tlul_uart at UART_ADDRESS, which takes the 8 bytes of its data register and register map.
+ * 
+ * The ports are those of tlul_uart, so a tlul_testbench drives the master as it would drive
+ * tlul_uart alone. tlul_xbar, rr_arbiter and the memory come from ../tlul_mem (verilog and
+ * tests/tlul_slave_memory), see CMakeLists.txt.
+ */
+
+// tlul_uart_xbar module
+module tlul_uart_xbar
+    #(
+        // BEGIN Parameters
+        parameter
+        CLKS_PER_BIT = 2,
+        RAM_SIZE = 1024,        // bytes, of the memory
+        UART_ADDRESS = 1024,    // aligned to W, after the memory
+        W = 8,
+        A = 32,
+        Z = 4,
+        O = 5,
+        I = 5
+        // END
+    )
+    (
+        // BEGIN Port Declarations
+        
+        // the clock signal
+        CLK,
+        
+        // Channel A ports
+        a_opcode,
+        a_param,
+        a_size,
+        a_source,
+        a_address,
+        a_mask,
+        a_data,
+        a_valid,
+        a_ready,
+        
+        // Channel D ports
+        d_opcode,
+        d_param,
+        d_size,
+        d_source,
+        d_sink,
+        d_data,
+        d_error,
+        d_valid,
+        d_ready,
+        
+        // UART ports
+        rx,
+        tx
+        
+        // END
+    );
+    
+    // BEGIN Port Definitions
+    
+    input CLK;
+    
+    // Channel A definitions (for SLAVE interfaces)
+    input [2:0]             a_opcode;
+    input [2:0]             a_param;
+    input [Z-1:0]           a_size;
+    input [O-1:0]           a_source;
+    input [A-1:0]           a_address;
+    input [W-1:0]           a_mask;
+    input [8*W-1:0]         a_data;
+    input                   a_valid;
+    output wire             a_ready;
+    
+    // Channel D definitions (for SLAVE interfaces)
+    output wire [2:0]       d_opcode;
+    output wire [1:0]       d_param;
+    output wire [Z-1:0]     d_size;
+    output wire [O-1:0]     d_source;
+    output wire [I-1:0]     d_sink;
+    output wire [8*W-1:0]   d_data;
+    output wire             d_error;
+    output wire             d_valid;
+    input                   d_ready;
+    
+    // UART definitions
+    input                   rx;
+    output wire             tx;
+    
+    // END
+    
+    // a_source of the slaves, {master, a_source}
+    localparam MB = 1;
+    
+    // the fields of A bits of the two slaves, slave 0 in the lowest bits
+    function [2*A-1:0] fields(input integer first, input integer second);
+        begin
+            fields = 0;
+            fields[0 +: A] = first;
+            fields[A +: A] = second;
+        end
+    endfunction
+    
+    // BEGIN the master side of the crossbar, a single master
+    wire [2:0]              m_a_opcode  [0:0];
+    wire [2:0]              m_a_param   [0:0];
+    wire [Z-1:0]            m_a_size    [0:0];
+    wire [O-1:0]            m_a_source  [0:0];
+    wire [A-1:0]            m_a_address [0:0];
+    wire [W-1:0]            m_a_mask    [0:0];
+    wire [8*W-1:0]          m_a_data    [0:0];
+    wire                    m_a_valid   [0:0];
+    wire                    m_a_ready   [0:0];
+    
+    wire [2:0]              m_d_opcode  [0:0];
+    wire [1:0]              m_d_param   [0:0];
+    wire [Z-1:0]            m_d_size    [0:0];
+    wire [O-1:0]            m_d_source  [0:0];
+    wire [I-1:0]            m_d_sink    [0:0];
+    wire [8*W-1:0]          m_d_data    [0:0];
+    wire                    m_d_error   [0:0];
+    wire                    m_d_valid   [0:0];
+    wire                    m_d_ready   [0:0];
+    
+    assign m_a_opcode[0] = a_opcode;
+    assign m_a_param[0] = a_param;
+    assign m_a_size[0] = a_size;
+    assign m_a_source[0] = a_source;
+    assign m_a_address[0] = a_address;
+    assign m_a_mask[0] = a_mask;
+    assign m_a_data[0] = a_data;
+    assign m_a_valid[0] = a_valid;
+    assign a_ready = m_a_ready[0];
+    
+    assign d_opcode = m_d_opcode[0];
+    assign d_param = m_d_param[0];
+    assign d_size = m_d_size[0];
+    assign d_source = m_d_source[0];
+    assign d_sink = m_d_sink[0];
+    assign d_data = m_d_data[0];
+    assign d_error = m_d_error[0];
+    assign d_valid = m_d_valid[0];
+    assign m_d_ready[0] = d_ready;
+    // END
+    
+    // BEGIN the slave side of the crossbar, 0: the memory, 1: the UART
+    wire [2:0]              s_a_opcode  [0:1];
+    wire [2:0]              s_a_param   [0:1];
+    wire [Z-1:0]            s_a_size    [0:1];
+    wire [O+MB-1:0]         s_a_source  [0:1];
+    wire [A-1:0]            s_a_address [0:1];
+    wire [W-1:0]            s_a_mask    [0:1];
+    wire [8*W-1:0]          s_a_data    [0:1];
+    wire                    s_a_valid   [0:1];
+    wire                    s_a_ready   [0:1];
+    
+    wire [2:0]              s_d_opcode  [0:1];
+    wire [1:0]              s_d_param   [0:1];
+    wire [Z-1:0]            s_d_size    [0:1];
+    wire [O+MB-1:0]         s_d_source  [0:1];
+    wire [I-1:0]            s_d_sink    [0:1];
+    wire [8*W-1:0]          s_d_data    [0:1];
+    wire                    s_d_error   [0:1];
+    wire                    s_d_valid   [0:1];
+    wire                    s_d_ready   [0:1];
+    // END
+    
+    tlul_xbar
+        #(
+            .M(1), .S(2), .W(W), .A(A), .Z(Z), .O(O), .I(I),
+            .BASE(fields(0, UART_ADDRESS)),
+            .SIZE(fields(RAM_SIZE, 8))
+        )
+        xbar(
+            .CLK(CLK),
+            
+            .m_a_opcode(m_a_opcode),
+            .m_a_param(m_a_param),
+            .m_a_size(m_a_size),
+            .m_a_source(m_a_source),
+            .m_a_address(m_a_address),
+            .m_a_mask(m_a_mask),
+            .m_a_data(m_a_data),
+            .m_a_valid(m_a_valid),
+            .m_a_ready(m_a_ready),
+            
+            .m_d_opcode(m_d_opcode),
+            .m_d_param(m_d_param),
+            .m_d_size(m_d_size),
+            .m_d_source(m_d_source),
+            .m_d_sink(m_d_sink),
+            .m_d_data(m_d_data),
+            .m_d_error(m_d_error),
+            .m_d_valid(m_d_valid),
+            .m_d_ready(m_d_ready),
+            
+            .s_a_opcode(s_a_opcode),
+            .s_a_param(s_a_param),
+            .s_a_size(s_a_size),
+            .s_a_source(s_a_source),
+            .s_a_address(s_a_address),
+            .s_a_mask(s_a_mask),
+            .s_a_data(s_a_data),
+            .s_a_valid(s_a_valid),
+            .s_a_ready(s_a_ready),
+            
+            .s_d_opcode(s_d_opcode),
+            .s_d_param(s_d_param),
+            .s_d_size(s_d_size),
+            .s_d_source(s_d_source),
+            .s_d_sink(s_d_sink),
+            .s_d_data(s_d_data),
+            .s_d_error(s_d_error),
+            .s_d_valid(s_d_valid),
+            .s_d_ready(s_d_ready));
+    
+    tlul_slave_memory_pipelined
+        #( .RAM_SIZE(RAM_SIZE), .W(W), .A(A), .Z(Z), .O(O + MB), .I(I) )
+        memory(
+            .CLK(CLK),
+            .RESET(1'b0),
+            
+            .a_opcode(s_a_opcode[0]),
+            .a_param(s_a_param[0]),
+            .a_size(s_a_size[0]),
+            .a_source(s_a_source[0]),
+            .a_address(s_a_address[0]),
+            .a_mask(s_a_mask[0]),
+            .a_data(s_a_data[0]),
+            .a_valid(s_a_valid[0]),
+            .a_ready(s_a_ready[0]),
+            
+            .d_opcode(s_d_opcode[0]),
+            .d_param(s_d_param[0]),
+            .d_size(s_d_size[0]),
+            .d_source(s_d_source[0]),
+            .d_sink(s_d_sink[0]),
+            .d_data(s_d_data[0]),
+            .d_error(s_d_error[0]),
+            .d_valid(s_d_valid[0]),
+            .d_ready(s_d_ready[0]));
+    
+    integer dummy;
+    
+    tlul_uart
+        #(
+            .CLKS_PER_BIT(CLKS_PER_BIT),
+            .UART_ADDRESS(UART_ADDRESS),
+            .W(W), .A(A), .Z(Z), .O(O + MB), .I(I)
+        )
+        uart(
+            .CLK(CLK),
+            
+            .a_opcode(s_a_opcode[1]),
+            .a_param(s_a_param[1]),
+            .a_size(s_a_size[1]),
+            .a_source(s_a_source[1]),
+            .a_address(s_a_address[1]),
+            .a_mask(s_a_mask[1]),
+            .a_data(s_a_data[1]),
+            .a_valid(s_a_valid[1]),
+            .a_ready(s_a_ready[1]),
+            
+            .d_opcode(s_d_opcode[1]),
+            .d_param(s_d_param[1]),
+            .d_size(s_d_size[1]),
+            .d_source(s_d_source[1]),
+            .d_sink(s_d_sink[1]),
+            .d_data(s_d_data[1]),
+            .d_error(s_d_error[1]),
+            .d_valid(s_d_valid[1]),
+            .d_ready(s_d_ready[1]),
+            
+            .rx(rx),
+            .tx(tx),
+            
+            .INFO_CLKS_PER_BIT(dummy));
+
+endmodule
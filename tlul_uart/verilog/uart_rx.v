@@ -6,15 +6,17 @@
 // and no parity bit.  When receive is complete o_rx_dv will be
 // driven high for one clock cycle.
 // 
-// Set Parameter CLKS_PER_BIT as follows:
-// CLKS_PER_BIT = (Frequency of i_Clock)/(Frequency of UART)
+// Drive i_Clks_Per_Bit as follows:
+// i_Clks_Per_Bit = (Frequency of i_Clock)/(Frequency of UART)
 // Example: 10 MHz Clock, 115200 baud UART
 // (10000000)/(115200) = 87
+// It is taken at the start of each byte, so it may change at any
+// time without garbling the byte in progress. It must not be 0.
   
 module uart_rx 
-  #(parameter CLKS_PER_BIT = 87)
   (
    input        i_Clock,
+   input [15:0] i_Clks_Per_Bit,
    input        i_Rx_Serial,
    output       o_Rx_DV,
    output [7:0] o_Rx_Byte
@@ -34,6 +36,7 @@ module uart_rx
   reg [7:0]     r_Rx_Byte     = 0;
   reg           r_Rx_DV       = 0;
   reg [2:0]     r_SM_Main     = 0;
+  reg [15:0]    r_Clks_Per_Bit = 1;
    
   // Purpose: Double-register the incoming data.
   // This allows it to be used in the UART RX Clock Domain.
@@ -57,7 +60,10 @@ module uart_rx
             r_Bit_Index   <= 0;
              
             if (r_Rx_Data == 1'b0)          // Start bit detected
-              r_SM_Main <= s_RX_START_BIT;
+              begin
+                r_Clks_Per_Bit <= i_Clks_Per_Bit;
+                r_SM_Main      <= s_RX_START_BIT;
+              end
             else
               r_SM_Main <= s_IDLE;
           end
@@ -65,7 +71,7 @@ module uart_rx
         // Check middle of start bit to make sure it's still low
         s_RX_START_BIT :
           begin
-            if (r_Clock_Count == (CLKS_PER_BIT-1)/2)
+            if (r_Clock_Count == (r_Clks_Per_Bit-1)/2)
               begin
                 if (r_Rx_Data == 1'b0)
                   begin
@@ -83,10 +89,10 @@ module uart_rx
           end // case: s_RX_START_BIT
          
          
-        // Wait CLKS_PER_BIT-1 clock cycles to sample serial data
+        // Wait r_Clks_Per_Bit-1 clock cycles to sample serial data
         s_RX_DATA_BITS :
           begin
-            if (r_Clock_Count < CLKS_PER_BIT-1)
+            if (r_Clock_Count < r_Clks_Per_Bit-1)
               begin
                 r_Clock_Count <= r_Clock_Count + 1;
                 r_SM_Main     <= s_RX_DATA_BITS;
@@ -114,8 +120,8 @@ module uart_rx
         // Receive Stop bit.  Stop bit = 1
         s_RX_STOP_BIT :
           begin
-            // Wait CLKS_PER_BIT-1 clock cycles for Stop bit to finish
-            if (r_Clock_Count < CLKS_PER_BIT-1)
+            // Wait r_Clks_Per_Bit-1 clock cycles for Stop bit to finish
+            if (r_Clock_Count < r_Clks_Per_Bit-1)
               begin
                 r_Clock_Count <= r_Clock_Count + 1;
                 r_SM_Main     <= s_RX_STOP_BIT;
@@ -6,15 +6,17 @@
 // and no parity bit.  When transmit is complete o_Tx_done will be
 // driven high for one clock cycle.
 //
-// Set Parameter CLKS_PER_BIT as follows:
-// CLKS_PER_BIT = (Frequency of i_Clock)/(Frequency of UART)
+// Drive i_Clks_Per_Bit as follows:
+// i_Clks_Per_Bit = (Frequency of i_Clock)/(Frequency of UART)
 // Example: 10 MHz Clock, 115200 baud UART
 // (10000000)/(115200) = 87
+// It is taken at the start of each byte, so it may change at any
+// time without garbling the byte in progress. It must not be 0.
   
 module uart_tx 
-  #(parameter CLKS_PER_BIT = 87)
   (
    input       i_Clock,
+   input [15:0] i_Clks_Per_Bit,
    input       i_Tx_DV,
    input [7:0] i_Tx_Byte, 
    output      o_Tx_Active,
@@ -34,6 +36,7 @@ module uart_tx
   reg [7:0]    r_Tx_Data     = 0;
   reg          r_Tx_Done     = 0;
   reg          r_Tx_Active   = 0;
+  reg [15:0]   r_Clks_Per_Bit = 1;
      
   always @(posedge i_Clock)
     begin
@@ -50,6 +53,7 @@ module uart_tx
               begin
                 r_Tx_Active <= 1'b1;
                 r_Tx_Data   <= i_Tx_Byte;
+                r_Clks_Per_Bit <= i_Clks_Per_Bit;
                 r_SM_Main   <= s_TX_START_BIT;
               end
             else
@@ -62,8 +66,8 @@ module uart_tx
           begin
             o_Tx_Serial <= 1'b0;
              
-            // Wait CLKS_PER_BIT-1 clock cycles for start bit to finish
-            if (r_Clock_Count < CLKS_PER_BIT-1)
+            // Wait r_Clks_Per_Bit-1 clock cycles for start bit to finish
+            if (r_Clock_Count < r_Clks_Per_Bit-1)
               begin
                 r_Clock_Count <= r_Clock_Count + 1;
                 r_SM_Main     <= s_TX_START_BIT;
@@ -76,12 +80,12 @@ module uart_tx
           end // case: s_TX_START_BIT
          
          
-        // Wait CLKS_PER_BIT-1 clock cycles for data bits to finish         
+        // Wait r_Clks_Per_Bit-1 clock cycles for data bits to finish         
         s_TX_DATA_BITS :
           begin
             o_Tx_Serial <= r_Tx_Data[r_Bit_Index];
              
-            if (r_Clock_Count < CLKS_PER_BIT-1)
+            if (r_Clock_Count < r_Clks_Per_Bit-1)
               begin
                 r_Clock_Count <= r_Clock_Count + 1;
                 r_SM_Main     <= s_TX_DATA_BITS;
@@ -110,8 +114,8 @@ module uart_tx
           begin
             o_Tx_Serial <= 1'b1;
              
-            // Wait CLKS_PER_BIT-1 clock cycles for Stop bit to finish
-            if (r_Clock_Count < CLKS_PER_BIT-1)
+            // Wait r_Clks_Per_Bit-1 clock cycles for Stop bit to finish
+            if (r_Clock_Count < r_Clks_Per_Bit-1)
               begin
                 r_Clock_Count <= r_Clock_Count + 1;
                 r_SM_Main     <= s_TX_STOP_BIT;